@@ -0,0 +1,1066 @@
+/* Eye Of GNOME -- Imaging Benchmarks
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Times the imaging hot paths and writes the results as JSON, so runs
+ * on different revisions can be compared:
+ *
+ *   eog-benchmark [--output=FILE] [--quick] [GROUP…]
+ *
+ * The input images are generated from a fixed seed into a temporary
+ * directory, which also holds the thumbnail cache, and is removed
+ * afterwards. Every benchmark reports the median of its iterations,
+ * which is what items_per_second is based on.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "eog-config-keys.h"
+#include "eog-image.h"
+#include "eog-image-jpeg.h"
+#include "eog-image-save-info.h"
+#include "eog-list-store.h"
+#include "eog-metadata-reader.h"
+#include "eog-pixbuf-util.h"
+#include "eog-thumbnail.h"
+#include "eog-transform.h"
+
+#ifdef HAVE_EXIF
+#include <libexif/exif-data.h>
+#include <libexif/exif-utils.h>
+#endif
+
+#define EOG_BENCHMARK_SEED         4242
+#define EOG_BENCHMARK_READ_SIZE    65535
+#define EOG_BENCHMARK_METADATA_RUNS 100
+
+typedef struct {
+	gchar    *tmp_dir;
+	gboolean  quick;
+	gboolean  have_display;
+
+	GString  *results;
+	guint     n_results;
+
+	/* generated input */
+	gchar    *large_jpeg;    /* with EXIF */
+	gchar    *medium_jpeg;   /* with EXIF */
+	gchar    *png;
+	gchar    *small_jpeg;
+} EogBenchmark;
+
+typedef void (*EogBenchmarkFunc) (gpointer data);
+
+typedef struct {
+	const gchar *name;
+	void (*run) (EogBenchmark *bench);
+} EogBenchmarkGroup;
+
+static gchar *output = NULL;
+static gboolean quick = FALSE;
+
+static const GOptionEntry options[] =
+{
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output, "Write the results to FILE instead of the standard output", "FILE" },
+	{ "quick", 'q', 0, G_OPTION_ARG_NONE, &quick, "Fewer iterations and smaller inputs, for a quick check", NULL },
+	{ NULL }
+};
+
+/* ------------------------------- Results -------------------------------- */
+
+static void
+json_append_string (GString *str, const gchar *value)
+{
+	const gchar *p;
+
+	g_string_append_c (str, '"');
+
+	for (p = value; *p != '\0'; p++) {
+		if (*p == '"' || *p == '\\')
+			g_string_append_printf (str, "\\%c", *p);
+		else if ((guchar) *p < 0x20)
+			g_string_append_printf (str, "\\u%04x", (guchar) *p);
+		else
+			g_string_append_c (str, *p);
+	}
+
+	g_string_append_c (str, '"');
+}
+
+static void
+eog_benchmark_begin_record (EogBenchmark *bench, const gchar *name)
+{
+	g_string_append (bench->results,
+			 bench->n_results++ > 0 ? ",\n    { " : "\n    { ");
+	g_string_append (bench->results, "\"name\": ");
+	json_append_string (bench->results, name);
+}
+
+static void
+eog_benchmark_skip (EogBenchmark *bench,
+		    const gchar  *name,
+		    const gchar  *reason)
+{
+	eog_benchmark_begin_record (bench, name);
+	g_string_append (bench->results, ", \"skipped\": ");
+	json_append_string (bench->results, reason);
+	g_string_append (bench->results, " }");
+
+	g_printerr ("%-48s skipped: %s\n", name, reason);
+}
+
+static int
+compare_samples (const void *a, const void *b)
+{
+	gint64 x = *(const gint64 *) a;
+	gint64 y = *(const gint64 *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Runs @func @iterations times, after a first untimed run if @warmup.
+ * @teardown, if any, runs after each iteration and isn't timed.
+ * @items is how many things a single run processes. */
+static void
+eog_benchmark_measure (EogBenchmark     *bench,
+		       const gchar      *name,
+		       guint             iterations,
+		       gboolean          warmup,
+		       guint             items,
+		       EogBenchmarkFunc  func,
+		       EogBenchmarkFunc  teardown,
+		       gpointer          data)
+{
+	gint64 *samples;
+	gint64 total = 0;
+	gint64 median;
+	guint i;
+
+	if (warmup) {
+		func (data);
+
+		if (teardown != NULL)
+			teardown (data);
+	}
+
+	samples = g_new (gint64, iterations);
+
+	for (i = 0; i < iterations; i++) {
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		func (data);
+		samples[i] = g_get_monotonic_time () - start;
+		total += samples[i];
+
+		if (teardown != NULL)
+			teardown (data);
+	}
+
+	qsort (samples, iterations, sizeof (gint64), compare_samples);
+	median = samples[iterations / 2];
+
+	eog_benchmark_begin_record (bench, name);
+	g_string_append_printf (bench->results,
+				", \"iterations\": %u"
+				", \"min_us\": %" G_GINT64_FORMAT
+				", \"median_us\": %" G_GINT64_FORMAT
+				", \"mean_us\": %" G_GINT64_FORMAT
+				", \"max_us\": %" G_GINT64_FORMAT
+				", \"items\": %u"
+				", \"items_per_second\": %.1f }",
+				iterations,
+				samples[0],
+				median,
+				total / iterations,
+				samples[iterations - 1],
+				items,
+				items * (gdouble) G_USEC_PER_SEC / MAX (median, 1));
+
+	g_printerr ("%-48s %10.3f ms\n", name, median / 1000.0);
+
+	g_free (samples);
+}
+
+/* -------------------------------- Input --------------------------------- */
+
+/* A gradient with noise on top, so it compresses like a photo */
+static GdkPixbuf *
+eog_benchmark_generate_pixbuf (gint width, gint height, gboolean has_alpha)
+{
+	GdkPixbuf *pixbuf;
+	GRand *rand;
+	guchar *pixels;
+	gint rowstride, n_channels;
+	gint x, y;
+
+	rand = g_rand_new_with_seed (EOG_BENCHMARK_SEED);
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, has_alpha, 8,
+				 width, height);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+
+	for (y = 0; y < height; y++) {
+		guchar *p = pixels + y * rowstride;
+
+		for (x = 0; x < width; x++, p += n_channels) {
+			gint noise = g_rand_int_range (rand, 0, 32);
+
+			p[0] = x * 223 / width + noise;
+			p[1] = y * 223 / height + noise;
+			p[2] = (x + y) * 223 / (width + height) + noise;
+
+			if (has_alpha)
+				p[3] = 0xff;
+		}
+	}
+
+	g_rand_free (rand);
+
+	return pixbuf;
+}
+
+#ifdef HAVE_EXIF
+/* Puts an APP1 segment with an orientation and a capture date right
+ * after the SOI marker of @jpeg, where cameras put theirs */
+static GBytes *
+eog_benchmark_add_exif (GBytes *jpeg)
+{
+	static const gchar date[] = "2026:01:01 12:00:00";
+	ExifData *exif;
+	ExifEntry *entry;
+	GByteArray *out;
+	const guchar *data;
+	guchar *exif_data = NULL;
+	guint exif_len = 0;
+	guchar marker[4];
+	gsize len;
+
+	exif = exif_data_new ();
+	exif_data_set_byte_order (exif, EXIF_BYTE_ORDER_INTEL);
+
+	entry = exif_entry_new ();
+	exif_content_add_entry (exif->ifd[EXIF_IFD_0], entry);
+	exif_entry_initialize (entry, EXIF_TAG_ORIENTATION);
+	exif_set_short (entry->data, EXIF_BYTE_ORDER_INTEL, 6);
+	exif_entry_unref (entry);
+
+	entry = exif_entry_new ();
+	exif_content_add_entry (exif->ifd[EXIF_IFD_EXIF], entry);
+	exif_entry_initialize (entry, EXIF_TAG_DATE_TIME_ORIGINAL);
+	if (entry->data != NULL && entry->size >= sizeof (date))
+		memcpy (entry->data, date, sizeof (date));
+	exif_entry_unref (entry);
+
+	exif_data_save_data (exif, &exif_data, &exif_len);
+	exif_data_unref (exif);
+
+	data = g_bytes_get_data (jpeg, &len);
+
+	marker[0] = 0xff;
+	marker[1] = 0xe1;
+	marker[2] = (exif_len + 2) >> 8;
+	marker[3] = (exif_len + 2) & 0xff;
+
+	out = g_byte_array_sized_new (len + sizeof (marker) + exif_len);
+	g_byte_array_append (out, data, 2);
+	g_byte_array_append (out, marker, sizeof (marker));
+	g_byte_array_append (out, exif_data, exif_len);
+	g_byte_array_append (out, data + 2, len - 2);
+
+	free (exif_data);
+
+	return g_byte_array_free_to_bytes (out);
+}
+#endif
+
+static gchar *
+eog_benchmark_write_input (EogBenchmark *bench,
+			   const gchar  *name,
+			   gint          width,
+			   gint          height,
+			   const gchar  *type,
+			   gboolean      add_exif)
+{
+	static gchar *jpeg_keys[] = { "quality", NULL };
+	static gchar *jpeg_values[] = { "90", NULL };
+	GdkPixbuf *pixbuf;
+	GBytes *bytes;
+	GError *error = NULL;
+	gboolean is_jpeg;
+	gchar *buffer;
+	gchar *path;
+	gsize len;
+
+	is_jpeg = (strcmp (type, "jpeg") == 0);
+
+	pixbuf = eog_benchmark_generate_pixbuf (width, height, !is_jpeg);
+
+	if (!gdk_pixbuf_save_to_bufferv (pixbuf, &buffer, &len, type,
+					 is_jpeg ? jpeg_keys : NULL,
+					 is_jpeg ? jpeg_values : NULL,
+					 &error)) {
+		g_error ("Couldn't generate %s: %s", name, error->message);
+	}
+
+	g_object_unref (pixbuf);
+
+	bytes = g_bytes_new_take (buffer, len);
+
+#ifdef HAVE_EXIF
+	if (add_exif) {
+		GBytes *with_exif = eog_benchmark_add_exif (bytes);
+
+		g_bytes_unref (bytes);
+		bytes = with_exif;
+	}
+#endif
+
+	path = g_build_filename (bench->tmp_dir, name, NULL);
+
+	if (!g_file_set_contents (path,
+				  g_bytes_get_data (bytes, NULL),
+				  g_bytes_get_size (bytes),
+				  &error)) {
+		g_error ("Couldn't write %s: %s", path, error->message);
+	}
+
+	g_bytes_unref (bytes);
+
+	return path;
+}
+
+static void
+eog_benchmark_prepare (EogBenchmark *bench)
+{
+	g_printerr ("Generating input in %s\n", bench->tmp_dir);
+
+	bench->large_jpeg = eog_benchmark_write_input (bench, "large.jpg",
+						       bench->quick ? 2000 : 4000,
+						       bench->quick ? 1500 : 3000,
+						       "jpeg", TRUE);
+	bench->medium_jpeg = eog_benchmark_write_input (bench, "medium.jpg",
+							1920, 1080,
+							"jpeg", TRUE);
+	bench->png = eog_benchmark_write_input (bench, "image.png",
+						1920, 1080,
+						"png", FALSE);
+	bench->small_jpeg = eog_benchmark_write_input (bench, "small.jpg",
+						       64, 48,
+						       "jpeg", FALSE);
+}
+
+static void
+eog_benchmark_remove_tree (const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+
+	if (dir != NULL) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *child = g_build_filename (path, name, NULL);
+
+			if (g_file_test (child, G_FILE_TEST_IS_DIR) &&
+			    !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+				eog_benchmark_remove_tree (child);
+			else
+				g_unlink (child);
+
+			g_free (child);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_rmdir (path);
+}
+
+/* ------------------------------ Transform ------------------------------- */
+
+typedef struct {
+	EogTransform *transform;
+	GdkPixbuf    *pixbuf;
+} TransformData;
+
+static void
+run_transform (gpointer user_data)
+{
+	TransformData *data = user_data;
+	GdkPixbuf *transformed;
+
+	transformed = eog_transform_apply (data->transform, data->pixbuf, NULL);
+	g_object_unref (transformed);
+}
+
+static void
+eog_benchmark_transform (EogBenchmark *bench)
+{
+	static const struct {
+		EogTransformType type;
+		const gchar *name;
+	} transforms[] = {
+		{ EOG_TRANSFORM_NONE,            "none" },
+		{ EOG_TRANSFORM_ROT_90,          "rot-90" },
+		{ EOG_TRANSFORM_ROT_180,         "rot-180" },
+		{ EOG_TRANSFORM_ROT_270,         "rot-270" },
+		{ EOG_TRANSFORM_FLIP_HORIZONTAL, "flip-horizontal" },
+		{ EOG_TRANSFORM_FLIP_VERTICAL,   "flip-vertical" },
+		{ EOG_TRANSFORM_TRANSPOSE,       "transpose" },
+		{ EOG_TRANSFORM_TRANSVERSE,      "transverse" }
+	};
+	static const struct {
+		gint width;
+		gint height;
+	} sizes[] = {
+		{  640,  480 },
+		{ 1920, 1080 },
+		{ 4000, 3000 }
+	};
+	guint n_sizes;
+	guint i, j;
+
+	n_sizes = bench->quick ? G_N_ELEMENTS (sizes) - 1 : G_N_ELEMENTS (sizes);
+
+	for (i = 0; i < n_sizes; i++) {
+		TransformData data;
+
+		data.pixbuf = eog_benchmark_generate_pixbuf (sizes[i].width,
+							     sizes[i].height,
+							     FALSE);
+
+		for (j = 0; j < G_N_ELEMENTS (transforms); j++) {
+			gchar *name;
+
+			name = g_strdup_printf ("transform/%s/%dx%d",
+						transforms[j].name,
+						sizes[i].width,
+						sizes[i].height);
+			data.transform = eog_transform_new (transforms[j].type);
+
+			eog_benchmark_measure (bench, name,
+					       bench->quick ? 3 : 10, TRUE, 1,
+					       run_transform, NULL, &data);
+
+			g_object_unref (data.transform);
+			g_free (name);
+		}
+
+		g_object_unref (data.pixbuf);
+	}
+}
+
+/* -------------------------------- Load ---------------------------------- */
+
+typedef struct {
+	GFile        *file;
+	EogImageData  data;
+} LoadData;
+
+static void
+run_load (gpointer user_data)
+{
+	LoadData *data = user_data;
+	EogImage *image;
+	GError *error = NULL;
+
+	image = eog_image_new_file (data->file, NULL);
+
+	if (!eog_image_load (image, data->data, NULL, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+	}
+
+	g_object_unref (image);
+}
+
+static void
+eog_benchmark_load (EogBenchmark *bench)
+{
+	static const struct {
+		EogImageData data;
+		const gchar *name;
+	} levels[] = {
+		{ EOG_IMAGE_DATA_DIMENSION, "dimension" },
+		{ EOG_IMAGE_DATA_EXIF,      "exif" },
+		{ EOG_IMAGE_DATA_XMP,       "xmp" },
+		{ EOG_IMAGE_DATA_IMAGE,     "image" },
+		{ EOG_IMAGE_DATA_ALL,       "all" }
+	};
+	const struct {
+		const gchar *path;
+		const gchar *name;
+	} inputs[] = {
+		{ bench->large_jpeg, "jpeg" },
+		{ bench->png,        "png" }
+	};
+	guint i, j;
+
+	for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+		LoadData data;
+
+		data.file = g_file_new_for_path (inputs[i].path);
+
+		for (j = 0; j < G_N_ELEMENTS (levels); j++) {
+			gchar *name;
+
+			name = g_strdup_printf ("load/%s/%s",
+						inputs[i].name,
+						levels[j].name);
+			data.data = levels[j].data;
+
+			eog_benchmark_measure (bench, name,
+					       bench->quick ? 3 : 10, TRUE, 1,
+					       run_load, NULL, &data);
+
+			g_free (name);
+		}
+
+		g_object_unref (data.file);
+	}
+}
+
+/* ------------------------------ Thumbnail ------------------------------- */
+
+typedef struct {
+	GFile  **files;
+	guint    next;
+	gboolean framed;   /* go through the gallery's in-memory cache */
+} ThumbnailData;
+
+static void
+run_thumbnail (gpointer user_data)
+{
+	ThumbnailData *data = user_data;
+	EogImage *image;
+	GdkPixbuf *thumbnail;
+	GError *error = NULL;
+
+	image = eog_image_new_file (data->files[data->next], NULL);
+
+	if (data->framed)
+		thumbnail = eog_thumbnail_load_framed (image, FALSE, &error);
+	else
+		thumbnail = eog_thumbnail_load (image, &error);
+
+	if (thumbnail != NULL) {
+		g_object_unref (thumbnail);
+	} else {
+		g_printerr ("%s\n", error ? error->message : "No thumbnail");
+		g_clear_error (&error);
+	}
+
+	g_object_unref (image);
+}
+
+static void
+next_thumbnail (gpointer user_data)
+{
+	ThumbnailData *data = user_data;
+
+	data->next++;
+}
+
+static void
+eog_benchmark_thumbnail (EogBenchmark *bench)
+{
+	ThumbnailData data;
+	GFile *file;
+	gchar *contents;
+	gsize len;
+	guint iterations;
+	guint i;
+
+	iterations = bench->quick ? 3 : 10;
+
+	/* Every cold run gets a file of its own, nothing is cached for it */
+	if (!g_file_get_contents (bench->medium_jpeg, &contents, &len, NULL))
+		g_error ("Couldn't read %s", bench->medium_jpeg);
+
+	data.files = g_new0 (GFile *, iterations);
+	data.next = 0;
+	data.framed = TRUE;
+
+	for (i = 0; i < iterations; i++) {
+		gchar *basename, *path;
+
+		basename = g_strdup_printf ("cold-%03u.jpg", i);
+		path = g_build_filename (bench->tmp_dir, basename, NULL);
+
+		if (!g_file_set_contents (path, contents, len, NULL))
+			g_error ("Couldn't write %s", path);
+
+		data.files[i] = g_file_new_for_path (path);
+
+		g_free (basename);
+		g_free (path);
+	}
+
+	g_free (contents);
+
+	eog_benchmark_measure (bench, "thumbnail/cold/1920x1080",
+			       iterations, FALSE, 1,
+			       run_thumbnail, next_thumbnail, &data);
+
+	for (i = 0; i < iterations; i++)
+		g_object_unref (data.files[i]);
+
+	g_free (data.files);
+
+	/* The warm-up runs put it in the thumbnail directory, then in
+	 * the in-memory cache of framed thumbnails used by the gallery */
+	file = g_file_new_for_path (bench->medium_jpeg);
+	data.files = &file;
+	data.next = 0;
+	data.framed = FALSE;
+
+	eog_benchmark_measure (bench, "thumbnail/disk/1920x1080",
+			       bench->quick ? 10 : 50, TRUE, 1,
+			       run_thumbnail, NULL, &data);
+
+	data.framed = TRUE;
+
+	eog_benchmark_measure (bench, "thumbnail/warm/1920x1080",
+			       bench->quick ? 10 : 50, TRUE, 1,
+			       run_thumbnail, NULL, &data);
+
+	g_object_unref (file);
+}
+
+/* ------------------------------- Metadata ------------------------------- */
+
+typedef struct {
+	GBytes              *bytes;
+	EogMetadataFileType  type;
+} MetadataData;
+
+/* Feeds the file to a reader like eog_image_load() does */
+static void
+run_metadata (gpointer user_data)
+{
+	MetadataData *data = user_data;
+	guchar *buffer;
+	guint i;
+
+	buffer = g_malloc (EOG_BENCHMARK_READ_SIZE);
+
+	for (i = 0; i < EOG_BENCHMARK_METADATA_RUNS; i++) {
+		EogMetadataReader *reader;
+		GInputStream *stream;
+		gssize bytes_read;
+
+		stream = g_memory_input_stream_new_from_bytes (data->bytes);
+		reader = eog_metadata_reader_new (data->type);
+
+		while ((bytes_read = g_input_stream_read (stream, buffer,
+							  EOG_BENCHMARK_READ_SIZE,
+							  NULL, NULL)) > 0) {
+			eog_metadata_reader_consume (reader, buffer, bytes_read);
+
+			if (eog_metadata_reader_finished (reader))
+				break;
+
+			eog_metadata_reader_seek_ahead (reader, stream, NULL);
+		}
+
+#ifdef HAVE_EXIF
+		{
+			ExifData *exif;
+
+			exif = eog_metadata_reader_get_exif_data (reader);
+			if (exif != NULL)
+				exif_data_unref (exif);
+		}
+#endif
+
+		g_object_unref (reader);
+		g_object_unref (stream);
+	}
+
+	g_free (buffer);
+}
+
+static void
+eog_benchmark_metadata (EogBenchmark *bench)
+{
+	const struct {
+		const gchar *path;
+		EogMetadataFileType type;
+		const gchar *name;
+	} inputs[] = {
+		{ bench->large_jpeg, EOG_METADATA_JPEG, "metadata/jpeg" },
+		{ bench->png,        EOG_METADATA_PNG,  "metadata/png" }
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+		MetadataData data;
+		gchar *contents;
+		gsize len;
+
+		if (!g_file_get_contents (inputs[i].path, &contents, &len, NULL))
+			g_error ("Couldn't read %s", inputs[i].path);
+
+		data.bytes = g_bytes_new_take (contents, len);
+		data.type = inputs[i].type;
+
+		eog_benchmark_measure (bench, inputs[i].name,
+				       bench->quick ? 3 : 10, TRUE,
+				       EOG_BENCHMARK_METADATA_RUNS,
+				       run_metadata, NULL, &data);
+
+		g_bytes_unref (data.bytes);
+	}
+}
+
+/* ------------------------------ List store ------------------------------ */
+
+typedef struct {
+	GFile        *dir;
+	GtkListStore *store;
+} ListStoreData;
+
+static void
+run_list_store (gpointer user_data)
+{
+	ListStoreData *data = user_data;
+	GList *files;
+
+	data->store = eog_list_store_new ();
+
+	files = g_list_prepend (NULL, data->dir);
+	eog_list_store_add_files (EOG_LIST_STORE (data->store), files);
+	g_list_free (files);
+}
+
+static void
+free_list_store (gpointer user_data)
+{
+	ListStoreData *data = user_data;
+
+	/* Let whatever the store started in the background finish */
+	while (g_main_context_iteration (NULL, FALSE));
+
+	g_clear_object (&data->store);
+}
+
+/* Fills a directory with hard links to @source, which is much quicker
+ * to set up than as many copies */
+static gchar *
+eog_benchmark_make_directory (EogBenchmark *bench,
+			      const gchar  *source,
+			      guint         n_files)
+{
+	gchar *basename, *path;
+	guint i;
+
+	basename = g_strdup_printf ("dir-%u", n_files);
+	path = g_build_filename (bench->tmp_dir, basename, NULL);
+	g_free (basename);
+
+	if (g_mkdir (path, 0700) != 0)
+		g_error ("Couldn't create %s: %s", path, g_strerror (errno));
+
+	for (i = 0; i < n_files; i++) {
+		gchar *file;
+
+		basename = g_strdup_printf ("image-%06u.jpg", i);
+		file = g_build_filename (path, basename, NULL);
+
+		if (link (source, file) != 0)
+			g_error ("Couldn't create %s: %s", file, g_strerror (errno));
+
+		g_free (file);
+		g_free (basename);
+	}
+
+	return path;
+}
+
+static void
+eog_benchmark_list_store (EogBenchmark *bench)
+{
+	static const guint sizes[] = { 10000, 100000 };
+	GSettingsSchemaSource *source;
+	GSettingsSchema *schema = NULL;
+	guint n_sizes;
+	guint i;
+
+	if (!bench->have_display) {
+		eog_benchmark_skip (bench, "list-store", "no display");
+		return;
+	}
+
+	/* EogListStore reads its settings */
+	source = g_settings_schema_source_get_default ();
+	if (source != NULL)
+		schema = g_settings_schema_source_lookup (source, EOG_CONF_UI, TRUE);
+
+	if (schema == NULL) {
+		eog_benchmark_skip (bench, "list-store",
+				    "the " EOG_CONF_UI " schema isn't installed");
+		return;
+	}
+
+	g_settings_schema_unref (schema);
+
+	n_sizes = bench->quick ? 1 : G_N_ELEMENTS (sizes);
+
+	for (i = 0; i < n_sizes; i++) {
+		ListStoreData data;
+		gchar *path, *name;
+
+		path = eog_benchmark_make_directory (bench, bench->small_jpeg,
+						     sizes[i]);
+		name = g_strdup_printf ("list-store/add-files/%u", sizes[i]);
+
+		data.dir = g_file_new_for_path (path);
+		data.store = NULL;
+
+		eog_benchmark_measure (bench, name,
+				       sizes[i] > 10000 ? 3 : 5, TRUE,
+				       sizes[i],
+				       run_list_store, free_list_store, &data);
+
+		g_object_unref (data.dir);
+		g_free (name);
+		g_free (path);
+	}
+}
+
+/* ------------------------------- JPEG save ------------------------------ */
+
+#ifdef HAVE_JPEG
+typedef struct {
+	EogImage         *image;
+	EogImageSaveInfo *source;
+	EogImageSaveInfo *target;
+} JpegSaveData;
+
+static void
+run_jpeg_save (gpointer user_data)
+{
+	JpegSaveData *data = user_data;
+	GOutputStream *stream;
+	GError *error = NULL;
+
+	stream = g_memory_output_stream_new_resizable ();
+
+	if (!eog_image_jpeg_save_file (data->image, NULL, stream,
+				       data->source, data->target,
+				       &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+	}
+
+	g_object_unref (stream);
+}
+#endif
+
+static void
+eog_benchmark_jpeg_save (EogBenchmark *bench)
+{
+#ifdef HAVE_JPEG
+	const struct {
+		const gchar *path;
+		const gchar *name;
+	} inputs[] = {
+		{ bench->png,        "jpeg-save/from-png" },
+		{ bench->large_jpeg, "jpeg-save/from-jpeg" }
+	};
+	GdkPixbufFormat *format;
+	GFile *target_file;
+	guint i;
+
+	format = eog_pixbuf_get_format_by_suffix ("jpg");
+	target_file = g_file_new_build_filename (bench->tmp_dir, "saved.jpg", NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (inputs); i++) {
+		JpegSaveData data;
+		GFile *file;
+		GError *error = NULL;
+
+		file = g_file_new_for_path (inputs[i].path);
+		data.image = eog_image_new_file (file, NULL);
+		g_object_unref (file);
+
+		if (!eog_image_load (data.image, EOG_IMAGE_DATA_ALL, NULL, &error)) {
+			eog_benchmark_skip (bench, inputs[i].name, error->message);
+			g_error_free (error);
+			g_object_unref (data.image);
+			continue;
+		}
+
+		/* A quality forces re-encoding, also for a JPEG source */
+		data.source = eog_image_save_info_new_from_image (data.image);
+		data.target = eog_image_save_info_new_from_file (target_file, format);
+		data.target->jpeg_quality = 0.9;
+
+		eog_benchmark_measure (bench, inputs[i].name,
+				       bench->quick ? 3 : 10, TRUE, 1,
+				       run_jpeg_save, NULL, &data);
+
+		g_object_unref (data.target);
+		g_object_unref (data.source);
+		g_object_unref (data.image);
+	}
+
+	g_object_unref (target_file);
+#else
+	eog_benchmark_skip (bench, "jpeg-save", "built without libjpeg");
+#endif
+}
+
+/* --------------------------------- Main --------------------------------- */
+
+static const EogBenchmarkGroup groups[] = {
+	{ "transform",  eog_benchmark_transform },
+	{ "load",       eog_benchmark_load },
+	{ "thumbnail",  eog_benchmark_thumbnail },
+	{ "metadata",   eog_benchmark_metadata },
+	{ "list-store", eog_benchmark_list_store },
+	{ "jpeg-save",  eog_benchmark_jpeg_save }
+};
+
+static gboolean
+is_group_selected (const gchar *name, gint argc, gchar **argv)
+{
+	gint i;
+
+	if (argc < 2)
+		return TRUE;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp (argv[i], name) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+	EogBenchmark bench = { 0, };
+	GOptionContext *ctx;
+	GError *error = NULL;
+	gchar *cache_dir;
+	gboolean failed = FALSE;
+	gint i;
+	guint j;
+
+	ctx = g_option_context_new ("[GROUP…]");
+	g_option_context_set_summary (ctx,
+				      "Groups: transform, load, thumbnail, "
+				      "metadata, list-store, jpeg-save");
+	g_option_context_add_main_entries (ctx, options, NULL);
+
+	if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (ctx);
+		return 1;
+	}
+
+	g_option_context_free (ctx);
+
+	for (i = 1; i < argc; i++) {
+		gboolean known = FALSE;
+
+		for (j = 0; j < G_N_ELEMENTS (groups); j++)
+			known |= (strcmp (argv[i], groups[j].name) == 0);
+
+		if (!known) {
+			g_printerr ("Unknown benchmark group “%s”\n", argv[i]);
+			return 1;
+		}
+	}
+
+	bench.tmp_dir = g_dir_make_tmp ("eog-benchmark-XXXXXX", &error);
+
+	if (bench.tmp_dir == NULL) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		return 1;
+	}
+
+	/* Neither the user's thumbnails nor their settings are touched,
+	 * this has to happen before anything looks them up */
+	cache_dir = g_build_filename (bench.tmp_dir, "cache", NULL);
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+	g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+	g_free (cache_dir);
+
+	/* Keeps the decimal point of the results a point */
+	gtk_disable_setlocale ();
+	bench.have_display = gtk_init_check (NULL, NULL);
+
+	bench.quick = quick;
+	bench.results = g_string_new (NULL);
+
+	g_string_append_printf (bench.results,
+				"{\n  \"version\": \"%s\",\n"
+				"  \"quick\": %s,\n"
+				"  \"benchmarks\": [",
+				VERSION,
+				bench.quick ? "true" : "false");
+
+	eog_benchmark_prepare (&bench);
+
+	for (j = 0; j < G_N_ELEMENTS (groups); j++) {
+		if (is_group_selected (groups[j].name, argc, argv))
+			groups[j].run (&bench);
+	}
+
+	g_string_append (bench.results, "\n  ]\n}\n");
+
+	if (output != NULL) {
+		if (!g_file_set_contents (output, bench.results->str,
+					  bench.results->len, &error)) {
+			g_printerr ("%s\n", error->message);
+			g_error_free (error);
+			failed = TRUE;
+		}
+	} else {
+		g_print ("%s", bench.results->str);
+	}
+
+	eog_benchmark_remove_tree (bench.tmp_dir);
+
+	g_string_free (bench.results, TRUE);
+	g_free (bench.large_jpeg);
+	g_free (bench.medium_jpeg);
+	g_free (bench.png);
+	g_free (bench.small_jpeg);
+	g_free (bench.tmp_dir);
+
+	return failed ? 1 : 0;
+}
@@ -41,6 +41,9 @@ struct _EogApplicationPrivate {
 	GSettings        *ui_settings;
 
 	PeasExtensionSet *extensions;
+
+	/* startup work waiting for the first painted frame */
+	gboolean          deferred_init_scheduled;
 };
 
 G_END_DECLS
@@ -29,7 +29,10 @@
 #include "eog-config-keys.h"
 #include "eog-debug.h"
 #include "eog-image.h"
+#include "eog-image-private.h"
 #include "eog-job-scheduler.h"
+#include "eog-metadata-index.h"
+#include "eog-metadata-reader.h"
 #include "eog-session.h"
 #include "eog-thumbnail.h"
 #include "eog-window.h"
@@ -46,10 +49,6 @@
 #include <gtk/gtk.h>
 #include <handy.h>
 
-#ifdef HAVE_EXEMPI
-#include <exempi/xmp.h>
-#endif
-
 #define is_rtl (gtk_widget_get_default_direction () == GTK_TEXT_DIR_RTL)
 
 static void eog_application_load_accelerators (void);
@@ -123,6 +122,24 @@ action_quit (GSimpleAction *action,
 	g_list_foreach (windows, (GFunc) eog_window_close, NULL);
 }
 
+static void
+action_dump_trace (GSimpleAction *action,
+		   GVariant      *parameter,
+		   gpointer       user_data)
+{
+	const gchar *filename;
+	GError *error = NULL;
+
+	/* An empty file name stands for the one in EOG_TRACE */
+	filename = g_variant_get_string (parameter, NULL);
+
+	if (!eog_debug_trace_dump (*filename != '\0' ? filename : NULL,
+				   &error)) {
+		g_warning ("Couldn't write the trace: %s", error->message);
+		g_error_free (error);
+	}
+}
+
 static GActionEntry app_entries[] = {
 	{ "view-statusbar", action_toggle_state, NULL, "true", NULL },
 	{ "view-gallery", action_toggle_state, NULL, "true",  NULL },
@@ -167,6 +184,22 @@ eog_application_init_app_menu (EogApplication *application)
 					 app_entries, G_N_ELEMENTS (app_entries),
 					 application);
 
+	/* Exported on D-Bus like the other actions, so the trace can be
+	 * written while running:
+	 * gdbus call --session --dest org.gnome.eog --object-path /org/gnome/eog
+	 *   --method org.gtk.Actions.Activate dump-trace "[<'FILE'>]" {} */
+	if (eog_debug_trace_is_enabled ()) {
+		GSimpleAction *dump_trace;
+
+		dump_trace = g_simple_action_new ("dump-trace",
+						  G_VARIANT_TYPE_STRING);
+		g_signal_connect (dump_trace, "activate",
+				  G_CALLBACK (action_dump_trace), NULL);
+		g_action_map_add_action (G_ACTION_MAP (application),
+					 G_ACTION (dump_trace));
+		g_object_unref (dump_trace);
+	}
+
 	action = g_action_map_lookup_action (G_ACTION_MAP (application),
 	                                     "view-gallery");
 	g_settings_bind_with_mapping (priv->ui_settings,
@@ -293,6 +326,98 @@ on_extension_removed (PeasExtensionSet *set,
 	eog_application_activatable_deactivate (EOG_APPLICATION_ACTIVATABLE (exten));
 }
 
+/* Thumbnails, XMP and application plugins are not needed to show the
+ * first image, so they are set up once it has been painted. */
+static void
+eog_application_deferred_init (EogApplication *app)
+{
+	EogApplicationPrivate *priv = app->priv;
+
+	if (priv->extensions != NULL)
+		return;
+
+	eog_thumbnail_init ();
+	eog_debug_message (DEBUG_STARTUP, "Thumbnail factory initialized");
+
+#ifdef HAVE_EXEMPI
+	eog_metadata_reader_xmp_init ();
+	eog_debug_message (DEBUG_STARTUP, "Exempi initialized");
+#endif
+
+	priv->extensions = peas_extension_set_new (
+				   PEAS_ENGINE (priv->plugin_engine),
+				   EOG_TYPE_APPLICATION_ACTIVATABLE,
+				   "app", app, NULL);
+	g_signal_connect (priv->extensions, "extension-added",
+			  G_CALLBACK (on_extension_added), app);
+	g_signal_connect (priv->extensions, "extension-removed",
+			  G_CALLBACK (on_extension_removed), app);
+
+	peas_extension_set_call (priv->extensions, "activate");
+	eog_debug_message (DEBUG_STARTUP, "Application plugins activated");
+}
+
+static gboolean
+eog_application_deferred_init_idle (gpointer user_data)
+{
+	eog_application_deferred_init (EOG_APPLICATION (user_data));
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_first_frame_painted (GdkFrameClock  *clock,
+			EogApplication *app)
+{
+	g_signal_handlers_disconnect_by_func (clock,
+					      on_first_frame_painted,
+					      app);
+
+	eog_debug_message (DEBUG_STARTUP, "First frame painted");
+
+	g_idle_add_full (G_PRIORITY_LOW,
+			 eog_application_deferred_init_idle,
+			 g_object_ref (app),
+			 g_object_unref);
+}
+
+static void
+on_first_window_realized (GtkWidget      *window,
+			  EogApplication *app)
+{
+	g_signal_handlers_disconnect_by_func (window,
+					      on_first_window_realized,
+					      app);
+
+	g_signal_connect (gtk_widget_get_frame_clock (window),
+			  "after-paint",
+			  G_CALLBACK (on_first_frame_painted),
+			  app);
+}
+
+static void
+eog_application_window_added (GtkApplication *application,
+			      GtkWindow      *window)
+{
+	EogApplication *app = EOG_APPLICATION (application);
+
+	GTK_APPLICATION_CLASS (eog_application_parent_class)->window_added (application,
+									    window);
+
+	if (app->priv->deferred_init_scheduled)
+		return;
+
+	app->priv->deferred_init_scheduled = TRUE;
+
+	if (gtk_widget_get_realized (GTK_WIDGET (window))) {
+		on_first_window_realized (GTK_WIDGET (window), app);
+	} else {
+		g_signal_connect (window, "realize",
+				  G_CALLBACK (on_first_window_realized),
+				  app);
+	}
+}
+
 static void
 eog_application_startup (GApplication *application)
 {
@@ -302,15 +427,18 @@ eog_application_startup (GApplication *application)
 	GtkCssProvider *provider;
   HdyStyleManager *style_manager;
 
+	eog_debug_message (DEBUG_STARTUP, "Startup");
+
 	g_application_set_resource_base_path (application, "/org/gnome/eog");
 	G_APPLICATION_CLASS (eog_application_parent_class)->startup (application);
+	eog_debug_message (DEBUG_STARTUP, "GTK initialized");
 
   hdy_init ();
-#ifdef HAVE_EXEMPI
-	xmp_init();
-#endif
+	eog_debug_message (DEBUG_STARTUP, "Libhandy initialized");
+
 	eog_job_scheduler_init ();
-	eog_thumbnail_init ();
+	eog_metadata_index_init ();
+	eog_debug_message (DEBUG_STARTUP, "Job scheduler and metadata index initialized");
 
 	/* Load special style properties for EogThumbView's scrollbar */
 	css_file = g_file_new_for_uri ("resource:///org/gnome/eog/ui/eog.css");
@@ -329,6 +457,7 @@ eog_application_startup (GApplication *application)
 	}
 	g_object_unref (provider);
 	g_object_unref (css_file);
+	eog_debug_message (DEBUG_STARTUP, "CSS loaded");
 
 	/* Add application specific icons to search path */
 	gtk_icon_theme_append_search_path (gtk_icon_theme_get_default (),
@@ -341,27 +470,20 @@ eog_application_startup (GApplication *application)
 	style_manager = hdy_style_manager_get_default ();
 	hdy_style_manager_set_color_scheme (style_manager,
 	                                    HDY_COLOR_SCHEME_PREFER_DARK);
+	eog_debug_message (DEBUG_STARTUP, "Icon theme and style set up");
 
 	eog_application_init_app_menu (app);
 	eog_application_init_accelerators (GTK_APPLICATION (app));
-
-	app->priv->extensions = peas_extension_set_new (
-				   PEAS_ENGINE (app->priv->plugin_engine),
-				   EOG_TYPE_APPLICATION_ACTIVATABLE,
-				   "app", app, NULL);
-	g_signal_connect (app->priv->extensions, "extension-added",
-			  G_CALLBACK (on_extension_added), app);
-	g_signal_connect (app->priv->extensions, "extension-removed",
-			  G_CALLBACK (on_extension_removed), app);
-
-	peas_extension_set_call (app->priv->extensions, "activate");
+	eog_debug_message (DEBUG_STARTUP, "Menus and accelerators set up");
 }
 
 static void
 eog_application_shutdown (GApplication *application)
 {
+	eog_metadata_index_shutdown ();
+
 #ifdef HAVE_EXEMPI
-	xmp_terminate();
+	eog_metadata_reader_xmp_shutdown ();
 #endif
 
 	G_APPLICATION_CLASS (eog_application_parent_class)->shutdown (application);
@@ -451,9 +573,11 @@ static void
 eog_application_class_init (EogApplicationClass *eog_application_class)
 {
 	GApplicationClass *application_class;
+	GtkApplicationClass *gtk_application_class;
 	GObjectClass *object_class;
 
 	application_class = (GApplicationClass *) eog_application_class;
+	gtk_application_class = (GtkApplicationClass *) eog_application_class;
 	object_class = (GObjectClass *) eog_application_class;
 
 	object_class->finalize = eog_application_finalize;
@@ -464,6 +588,8 @@ eog_application_class_init (EogApplicationClass *eog_application_class)
 	application_class->open = eog_application_open;
 	application_class->add_platform_data = eog_application_add_platform_data;
 	application_class->before_emit = eog_application_before_emit;
+
+	gtk_application_class->window_added = eog_application_window_added;
 }
 
 static void
@@ -479,6 +605,7 @@ eog_application_init (EogApplication *eog_application)
 
 	priv->plugin_engine = eog_plugin_engine_new ();
 	priv->flags = 0;
+	priv->deferred_init_scheduled = FALSE;
 
 	priv->ui_settings = g_settings_new (EOG_CONF_UI);
 
@@ -635,6 +762,58 @@ eog_application_show_window (EogWindow *window, gpointer user_data)
 				      GPOINTER_TO_UINT (user_data));
 }
 
+static void
+eog_application_drop_preloaded (EogWindow *window, GFile *file)
+{
+	eog_debug_message (DEBUG_STARTUP, "Window prepared");
+
+	eog_image_remove_preloaded (file);
+
+	/* this drops the last reference to file */
+	g_signal_handlers_disconnect_by_func (window,
+					      eog_application_drop_preloaded,
+					      file);
+}
+
+static void
+eog_application_preload_finished (EogJob *job, gpointer user_data)
+{
+	eog_debug_message (DEBUG_STARTUP, "First image decoded");
+}
+
+/* Starts decoding the image a window is going to show first, so that
+ * it runs in parallel with building the window. The gallery picks up
+ * the same #EogImage once it is filled. */
+static void
+eog_application_preload_image (GFile *file)
+{
+	EogImage *image;
+	EogJob *job;
+#ifdef HAVE_EXIF
+	GSettings *view_settings;
+#endif
+
+	image = eog_image_new_file (file, NULL);
+
+#ifdef HAVE_EXIF
+	view_settings = g_settings_new (EOG_CONF_VIEW);
+	if (g_settings_get_boolean (view_settings, EOG_CONF_VIEW_AUTOROTATE))
+		eog_image_autorotate (image);
+	g_object_unref (view_settings);
+#endif
+
+	eog_image_add_preloaded (image);
+
+	job = eog_job_load_new (image, EOG_IMAGE_DATA_ALL);
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (eog_application_preload_finished), NULL);
+	eog_job_scheduler_add_job_with_priority (job, EOG_JOB_PRIORITY_HIGH);
+	eog_debug_message (DEBUG_STARTUP, "Preloading first image");
+
+	g_object_unref (job);
+	g_object_unref (image);
+}
+
 /**
  * eog_application_open_file_list:
  * @application: An #EogApplication.
@@ -678,10 +857,24 @@ eog_application_open_file_list (EogApplication  *application,
 		return TRUE;
 	}
 
+	if (file_list != NULL)
+		eog_application_preload_image ((GFile *) file_list->data);
+
 	new_window = eog_application_get_empty_window (application);
 
 	if (new_window == NULL) {
 		new_window = EOG_WINDOW (eog_window_new (flags));
+		eog_debug_message (DEBUG_STARTUP, "Window constructed");
+	}
+
+	if (file_list != NULL) {
+		/* Unused if the file turns out not to be an image */
+		g_signal_connect_data (new_window,
+				       "prepared",
+				       G_CALLBACK (eog_application_drop_preloaded),
+				       g_object_ref (file_list->data),
+				       (GClosureNotify) g_object_unref,
+				       0);
 	}
 
 	g_signal_connect (new_window,
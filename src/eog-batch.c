@@ -0,0 +1,747 @@
+/* Eye Of GNOME -- Headless Batch Processing
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Runs the images given on the command line through the same jobs the
+ * viewer uses, without opening a display: reading the metadata for
+ * automatic rotation, transforming, saving in place or converting,
+ * copying and generating thumbnails. The stages run one after another,
+ * the jobs of a stage are spread over one scheduler worker per core.
+ * The time spent in each stage is printed once it's done.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+
+#include "eog-batch.h"
+#include "eog-debug.h"
+#include "eog-image.h"
+#include "eog-image-private.h"
+#include "eog-jobs.h"
+#include "eog-job-scheduler.h"
+#include "eog-metadata-index.h"
+#include "eog-pixbuf-util.h"
+#include "eog-transform.h"
+#include "eog-uri-converter.h"
+#include "eog-util.h"
+
+#define EOG_BATCH_QUERY_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK "," \
+	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME
+
+typedef enum {
+	EOG_BATCH_STAGE_METADATA,
+	EOG_BATCH_STAGE_TRANSFORM,
+	EOG_BATCH_STAGE_SAVE,
+	EOG_BATCH_STAGE_COPY,
+	EOG_BATCH_STAGE_THUMBNAILS,
+	EOG_BATCH_N_STAGES
+} EogBatchStage;
+
+static const gchar *stage_names[EOG_BATCH_N_STAGES] = {
+	N_("Reading metadata"),
+	N_("Transforming"),
+	N_("Saving"),
+	N_("Copying"),
+	N_("Generating thumbnails")
+};
+
+typedef struct {
+	GMainLoop       *loop;
+
+	GList           *images;        /* EogImage, in command line order */
+	GList           *modified;      /* EogImage, transformed ones */
+
+	/* from the command line */
+	gboolean         autorotate;
+	EogTransform    *transform;
+	gboolean         save_as;
+	GdkPixbufFormat *format;
+	GFile           *output_dir;
+	gchar           *copy_dir;
+
+	EogBatchStage    stage;
+	guint            stage_n_images;
+	gint64           stage_start;
+	guint            n_pending;     /* jobs of the current stage */
+	guint            n_failed;
+} EogBatch;
+
+static gboolean batch_requested = FALSE;
+static gchar *rotate = NULL;
+static gchar *flip = NULL;
+static gchar *convert_format = NULL;
+static gchar *output_dir = NULL;
+static gchar *name_format = NULL;
+static gchar *copy_dir = NULL;
+static gboolean thumbnails = FALSE;
+static gint n_threads = 0;
+
+static const GOptionEntry batch_options[] =
+{
+	{ "batch", 0, 0, G_OPTION_ARG_NONE, &batch_requested, N_("Process the images without opening a window"), NULL },
+	{ "rotate", 0, 0, G_OPTION_ARG_STRING, &rotate, N_("Rotate by 90, 180 or 270 degrees, or “auto” to follow the EXIF orientation"), N_("ANGLE") },
+	{ "flip", 0, 0, G_OPTION_ARG_STRING, &flip, N_("Flip “horizontal” or “vertical”"), N_("DIRECTION") },
+	{ "convert", 0, 0, G_OPTION_ARG_STRING, &convert_format, N_("Save in another format instead of in place"), N_("FORMAT") },
+	{ "output-dir", 0, 0, G_OPTION_ARG_FILENAME, &output_dir, N_("Save into a directory instead of in place"), N_("DIRECTORY") },
+	{ "name-format", 0, 0, G_OPTION_ARG_STRING, &name_format, N_("File name format of saved images, as in the Save As dialog"), N_("FORMAT") },
+	{ "copy-to", 0, 0, G_OPTION_ARG_FILENAME, &copy_dir, N_("Copy the images to a directory"), N_("DIRECTORY") },
+	{ "thumbnails", 0, 0, G_OPTION_ARG_NONE, &thumbnails, N_("Generate thumbnails"), NULL },
+	{ "threads", 0, 0, G_OPTION_ARG_INT, &n_threads, N_("Number of worker threads, one per core by default"), N_("N") },
+	{ NULL }
+};
+
+GOptionGroup *
+eog_batch_get_option_group (void)
+{
+	GOptionGroup *group;
+
+	group = g_option_group_new ("batch",
+				    _("Batch Processing Options:"),
+				    _("Show batch processing options"),
+				    NULL, NULL);
+	g_option_group_set_translation_domain (group, PACKAGE);
+	g_option_group_add_entries (group, batch_options);
+
+	return group;
+}
+
+gboolean
+eog_batch_is_requested (void)
+{
+	return batch_requested;
+}
+
+static void
+eog_batch_print_timing (const gchar *name, guint n_images, gint64 start)
+{
+	gdouble seconds;
+
+	seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+	seconds = MAX (seconds, 1e-6);
+
+	g_print (ngettext ("%s: %u image in %.2f s (%.1f images/s)\n",
+			   "%s: %u images in %.2f s (%.1f images/s)\n",
+			   n_images),
+		 name, n_images, seconds, n_images / seconds);
+}
+
+static void
+eog_batch_print_file_error (GFile *file, const GError *error)
+{
+	gchar *name;
+
+	name = g_file_get_parse_name (file);
+	g_printerr ("%s: %s\n", name, error->message);
+	g_free (name);
+}
+
+static void
+eog_batch_print_image_error (EogImage *image, const GError *error)
+{
+	gchar *name;
+
+	name = eog_image_get_uri_for_display (image);
+	g_printerr ("%s: %s\n", name, error->message);
+	g_free (name);
+}
+
+static gboolean
+eog_batch_make_directory (GFile *dir, GError **error)
+{
+	GError *local_error = NULL;
+
+	if (!g_file_make_directory_with_parents (dir, NULL, &local_error) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	g_clear_error (&local_error);
+
+	return TRUE;
+}
+
+static gboolean
+eog_batch_parse_transform (EogBatch *batch, GError **error)
+{
+	EogTransformType rotation = EOG_TRANSFORM_NONE;
+	EogTransformType flipping = EOG_TRANSFORM_NONE;
+
+	if (rotate == NULL) {
+		/* nothing to do */
+	} else if (strcmp (rotate, "auto") == 0) {
+#ifdef HAVE_EXIF
+		batch->autorotate = TRUE;
+#else
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+			     _("Automatic rotation needs EXIF support"));
+		return FALSE;
+#endif
+	} else if (strcmp (rotate, "90") == 0) {
+		rotation = EOG_TRANSFORM_ROT_90;
+	} else if (strcmp (rotate, "180") == 0) {
+		rotation = EOG_TRANSFORM_ROT_180;
+	} else if (strcmp (rotate, "270") == 0) {
+		rotation = EOG_TRANSFORM_ROT_270;
+	} else {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+			     _("Invalid rotation “%s”, use 90, 180, 270 or auto"),
+			     rotate);
+		return FALSE;
+	}
+
+	if (flip == NULL) {
+		/* nothing to do */
+	} else if (strcmp (flip, "horizontal") == 0) {
+		flipping = EOG_TRANSFORM_FLIP_HORIZONTAL;
+	} else if (strcmp (flip, "vertical") == 0) {
+		flipping = EOG_TRANSFORM_FLIP_VERTICAL;
+	} else {
+		g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+			     _("Invalid flip “%s”, use horizontal or vertical"),
+			     flip);
+		return FALSE;
+	}
+
+	if (rotation != EOG_TRANSFORM_NONE && flipping != EOG_TRANSFORM_NONE) {
+		EogTransform *first, *second;
+
+		first = eog_transform_new (rotation);
+		second = eog_transform_new (flipping);
+		batch->transform = eog_transform_compose (first, second);
+		g_object_unref (first);
+		g_object_unref (second);
+	} else if (rotation != EOG_TRANSFORM_NONE) {
+		batch->transform = eog_transform_new (rotation);
+	} else if (flipping != EOG_TRANSFORM_NONE) {
+		batch->transform = eog_transform_new (flipping);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+eog_batch_parse_options (EogBatch *batch, GError **error)
+{
+	if (!eog_batch_parse_transform (batch, error))
+		return FALSE;
+
+	if (convert_format != NULL) {
+		batch->format = eog_pixbuf_get_format_by_suffix (convert_format);
+
+		if (batch->format == NULL ||
+		    !gdk_pixbuf_format_is_writable (batch->format)) {
+			g_set_error (error, G_OPTION_ERROR,
+				     G_OPTION_ERROR_BAD_VALUE,
+				     _("Images can’t be saved as “%s”"),
+				     convert_format);
+			return FALSE;
+		}
+	}
+
+	batch->save_as = (convert_format != NULL ||
+			  output_dir != NULL ||
+			  name_format != NULL);
+
+	if (output_dir != NULL) {
+		batch->output_dir = g_file_new_for_commandline_arg (output_dir);
+
+		if (!eog_batch_make_directory (batch->output_dir, error))
+			return FALSE;
+	}
+
+	if (copy_dir != NULL) {
+		GFile *dir;
+
+		dir = g_file_new_for_commandline_arg (copy_dir);
+		batch->copy_dir = g_file_get_path (dir);
+
+		if (batch->copy_dir == NULL) {
+			g_set_error (error, G_OPTION_ERROR,
+				     G_OPTION_ERROR_BAD_VALUE,
+				     _("Images can only be copied to a local directory"));
+		}
+
+		if (batch->copy_dir == NULL ||
+		    !eog_batch_make_directory (dir, error)) {
+			g_object_unref (dir);
+			return FALSE;
+		}
+
+		g_object_unref (dir);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+eog_batch_is_image (GFileInfo *info)
+{
+	gchar *mime_type;
+	gboolean is_image;
+
+	mime_type = eog_util_get_mime_type_with_fallback (info);
+	is_image = eog_image_is_supported_mime_type (mime_type);
+	g_free (mime_type);
+
+	return is_image;
+}
+
+static void
+eog_batch_add_image (EogBatch *batch, GFile *file, GFileInfo *info)
+{
+	EogImage *image;
+
+	image = eog_image_new_file (file, g_file_info_get_display_name (info));
+	batch->images = g_list_prepend (batch->images, image);
+}
+
+/* Adds the images in @dir and its subdirectories, in no particular order */
+static void
+eog_batch_add_directory (EogBatch *batch, GFile *dir)
+{
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	GError *error = NULL;
+
+	enumerator = g_file_enumerate_children (dir,
+						EOG_BATCH_QUERY_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NONE,
+						NULL, &error);
+
+	if (enumerator == NULL) {
+		eog_batch_print_file_error (dir, error);
+		g_error_free (error);
+		batch->n_failed++;
+		return;
+	}
+
+	while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL) {
+		GFile *child;
+
+		child = g_file_enumerator_get_child (enumerator, info);
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			if (!g_file_info_get_is_symlink (info))
+				eog_batch_add_directory (batch, child);
+		} else if (eog_batch_is_image (info)) {
+			eog_batch_add_image (batch, child, info);
+		}
+
+		g_object_unref (child);
+		g_object_unref (info);
+	}
+
+	if (error != NULL) {
+		eog_batch_print_file_error (dir, error);
+		g_error_free (error);
+		batch->n_failed++;
+	}
+
+	g_object_unref (enumerator);
+}
+
+static void
+eog_batch_add_file (EogBatch *batch, GFile *file)
+{
+	GFileInfo *info;
+	GError *error = NULL;
+
+	info = g_file_query_info (file,
+				  EOG_BATCH_QUERY_ATTRIBUTES,
+				  G_FILE_QUERY_INFO_NONE,
+				  NULL, &error);
+
+	if (info == NULL) {
+		eog_batch_print_file_error (file, error);
+		g_error_free (error);
+		batch->n_failed++;
+		return;
+	}
+
+	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+		eog_batch_add_directory (batch, file);
+	} else if (eog_batch_is_image (info)) {
+		eog_batch_add_image (batch, file, info);
+	} else {
+		gchar *name = g_file_get_parse_name (file);
+
+		g_printerr (_("%s: Not a supported image file\n"), name);
+		g_free (name);
+		batch->n_failed++;
+	}
+
+	g_object_unref (info);
+}
+
+static gboolean eog_batch_start_stage (EogBatch *batch, EogBatchStage stage);
+
+static void
+eog_batch_job_finished_cb (EogJob *job, gpointer user_data)
+{
+	EogBatch *batch = user_data;
+
+	if (job->error != NULL) {
+		EogImage *image = NULL;
+
+		/* The save and copy jobs are given a single file each */
+		if (EOG_IS_JOB_LOAD (job))
+			image = EOG_JOB_LOAD (job)->image;
+		else if (EOG_IS_JOB_THUMBNAIL (job))
+			image = EOG_JOB_THUMBNAIL (job)->image;
+		else if (EOG_IS_JOB_SAVE (job))
+			image = EOG_JOB_SAVE (job)->images->data;
+
+		if (image != NULL) {
+			eog_batch_print_image_error (image, job->error);
+		} else if (EOG_IS_JOB_COPY (job)) {
+			eog_batch_print_file_error (EOG_JOB_COPY (job)->images->data,
+						    job->error);
+		} else {
+			g_printerr ("%s\n", job->error->message);
+		}
+
+		batch->n_failed++;
+
+		/* Images that can't be read are left out of the later stages */
+		if (EOG_IS_JOB_LOAD (job)) {
+			batch->images = g_list_remove (batch->images, image);
+			g_object_unref (image);
+		}
+	}
+
+	g_assert (batch->n_pending > 0);
+
+	if (--batch->n_pending > 0)
+		return;
+
+	eog_batch_print_timing (_(stage_names[batch->stage]),
+				batch->stage_n_images,
+				batch->stage_start);
+
+	if (!eog_batch_start_stage (batch, batch->stage + 1))
+		g_main_loop_quit (batch->loop);
+}
+
+static void
+eog_batch_add_job (EogBatch *batch, EogJob *job)
+{
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (eog_batch_job_finished_cb),
+			  batch);
+
+	batch->n_pending++;
+
+	eog_job_scheduler_add_job (job);
+	g_object_unref (job);
+}
+
+static void
+eog_batch_read_metadata (EogBatch *batch)
+{
+	GList *it;
+
+	if (!batch->autorotate)
+		return;
+
+	for (it = batch->images; it != NULL; it = it->next) {
+		eog_batch_add_job (batch,
+				   eog_job_load_new (EOG_IMAGE (it->data),
+						     EOG_IMAGE_DATA_EXIF));
+	}
+}
+
+/* Images needing the same transformation share a job */
+static void
+eog_batch_transform (EogBatch *batch)
+{
+	GHashTable *groups;
+	GHashTableIter iter;
+	gpointer key, value;
+	GList *it;
+
+	if (batch->transform == NULL && !batch->autorotate)
+		return;
+
+	groups = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (it = batch->images; it != NULL; it = it->next) {
+		EogImage *image = EOG_IMAGE (it->data);
+		EogTransform *trans = NULL;
+		EogTransformType type;
+		GList *group;
+
+#ifdef HAVE_EXIF
+		if (batch->autorotate)
+			trans = eog_image_get_orientation_transform (image);
+#endif
+
+		if (trans != NULL && batch->transform != NULL) {
+			EogTransform *composition;
+
+			composition = eog_transform_compose (trans,
+							     batch->transform);
+			g_object_unref (trans);
+			trans = composition;
+		} else if (batch->transform != NULL) {
+			trans = g_object_ref (batch->transform);
+		}
+
+		if (trans == NULL)
+			continue;
+
+		type = eog_transform_get_transform_type (trans);
+		g_object_unref (trans);
+
+		if (type == EOG_TRANSFORM_NONE)
+			continue;
+
+		group = g_hash_table_lookup (groups, GINT_TO_POINTER (type));
+		group = g_list_prepend (group, g_object_ref (image));
+		g_hash_table_insert (groups, GINT_TO_POINTER (type), group);
+
+		batch->modified = g_list_prepend (batch->modified,
+						  g_object_ref (image));
+	}
+
+	batch->modified = g_list_reverse (batch->modified);
+
+	g_hash_table_iter_init (&iter, groups);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		EogTransform *trans;
+
+		trans = eog_transform_new (GPOINTER_TO_INT (key));
+		eog_batch_add_job (batch,
+				   eog_job_transform_new (g_list_reverse (value),
+							  trans));
+		g_object_unref (trans);
+	}
+
+	g_hash_table_destroy (groups);
+}
+
+/* Every image gets a job of its own, so that each failure is reported
+ * with the name of the file and doesn't keep the others from being saved */
+static void
+eog_batch_save (EogBatch *batch)
+{
+	EogURIConverter *converter;
+	GList *it;
+
+	if (!batch->save_as) {
+		for (it = batch->modified; it != NULL; it = it->next) {
+			GList *images;
+
+			images = g_list_prepend (NULL, g_object_ref (it->data));
+			eog_batch_add_job (batch, eog_job_save_new (images));
+		}
+
+		return;
+	}
+
+	if (batch->images == NULL)
+		return;
+
+	converter = eog_uri_converter_new (batch->output_dir,
+					   batch->format,
+					   name_format ? name_format : "%f");
+	g_object_set (converter, "n-images", g_list_length (batch->images), NULL);
+
+	/* The destinations are determined up front, in order, so the
+	 * converter's counter doesn't depend on which save ends first */
+	for (it = batch->images; it != NULL; it = it->next) {
+		EogImage *image = EOG_IMAGE (it->data);
+		GList *images;
+		GFile *file;
+		GError *error = NULL;
+
+		if (!eog_uri_converter_do (converter, image, &file, NULL, &error)) {
+			eog_batch_print_image_error (image, error);
+			g_error_free (error);
+			batch->n_failed++;
+			continue;
+		}
+
+		images = g_list_prepend (NULL, g_object_ref (image));
+		eog_batch_add_job (batch,
+				   eog_job_save_as_new (images, NULL, file));
+		g_object_unref (file);
+	}
+
+	g_object_unref (converter);
+}
+
+static void
+eog_batch_copy (EogBatch *batch)
+{
+	GList *it;
+
+	if (batch->copy_dir == NULL)
+		return;
+
+	for (it = batch->images; it != NULL; it = it->next) {
+		GList *files;
+
+		files = g_list_prepend (NULL,
+					eog_image_get_file (EOG_IMAGE (it->data)));
+		eog_batch_add_job (batch,
+				   eog_job_copy_new (files, batch->copy_dir));
+	}
+}
+
+static void
+eog_batch_generate_thumbnails (EogBatch *batch)
+{
+	GList *it;
+
+	if (!thumbnails)
+		return;
+
+	for (it = batch->images; it != NULL; it = it->next) {
+		eog_batch_add_job (batch,
+				   eog_job_thumbnail_new (EOG_IMAGE (it->data)));
+	}
+}
+
+/* Starts the first stage from @stage on that has anything to do.
+ * Returns FALSE when there is none left. */
+static gboolean
+eog_batch_start_stage (EogBatch *batch, EogBatchStage stage)
+{
+	for (; stage < EOG_BATCH_N_STAGES; stage++) {
+		batch->stage = stage;
+		batch->stage_n_images = g_list_length (batch->images);
+		batch->stage_start = g_get_monotonic_time ();
+
+		switch (stage) {
+		case EOG_BATCH_STAGE_METADATA:
+			eog_batch_read_metadata (batch);
+			break;
+		case EOG_BATCH_STAGE_TRANSFORM:
+			eog_batch_transform (batch);
+			batch->stage_n_images = g_list_length (batch->modified);
+			break;
+		case EOG_BATCH_STAGE_SAVE:
+			eog_batch_save (batch);
+			if (!batch->save_as)
+				batch->stage_n_images = g_list_length (batch->modified);
+			break;
+		case EOG_BATCH_STAGE_COPY:
+			eog_batch_copy (batch);
+			break;
+		case EOG_BATCH_STAGE_THUMBNAILS:
+			eog_batch_generate_thumbnails (batch);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+
+		if (batch->n_pending > 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * eog_batch_run:
+ * @files: %NULL-terminated list of files and directories, as given on
+ * the command line
+ *
+ * Processes @files as requested by the batch options, without a
+ * display. Must be called instead of running the application.
+ *
+ * Returns: the exit status.
+ */
+gint
+eog_batch_run (gchar **files)
+{
+	EogBatch batch = { 0, };
+	GError *error = NULL;
+	gint64 start;
+	guint n_images;
+	guint i;
+
+	if (!eog_batch_parse_options (&batch, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		batch.n_failed++;
+		goto out;
+	}
+
+	if (files == NULL || files[0] == NULL) {
+		g_printerr ("%s\n", _("No images given"));
+		batch.n_failed++;
+		goto out;
+	}
+
+	eog_debug_init ();
+	eog_metadata_index_init ();
+
+	for (i = 0; files[i] != NULL; i++) {
+		GFile *file;
+
+		file = g_file_new_for_commandline_arg (files[i]);
+		eog_batch_add_file (&batch, file);
+		g_object_unref (file);
+	}
+
+	batch.images = g_list_reverse (batch.images);
+	n_images = g_list_length (batch.images);
+
+	if (n_threads <= 0)
+		n_threads = g_get_num_processors ();
+
+	eog_job_scheduler_init_with_threads (n_threads);
+
+	g_print (ngettext ("Processing %u image\n",
+			   "Processing %u images\n",
+			   n_images),
+		 n_images);
+
+	batch.loop = g_main_loop_new (NULL, FALSE);
+	start = g_get_monotonic_time ();
+
+	if (eog_batch_start_stage (&batch, EOG_BATCH_STAGE_METADATA))
+		g_main_loop_run (batch.loop);
+
+	eog_batch_print_timing (_("Total"), n_images, start);
+
+	g_main_loop_unref (batch.loop);
+	eog_metadata_index_shutdown ();
+
+out:
+	g_list_free_full (batch.images, g_object_unref);
+	g_list_free_full (batch.modified, g_object_unref);
+	g_clear_object (&batch.transform);
+	g_clear_object (&batch.output_dir);
+	g_free (batch.copy_dir);
+
+	return batch.n_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+/* Eye Of GNOME -- Headless Batch Processing
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Used by main(), outside of the library */
+GOptionGroup *eog_batch_get_option_group (void);
+
+gboolean      eog_batch_is_requested     (void);
+
+gint          eog_batch_run              (gchar **files);
+
+G_END_DECLS
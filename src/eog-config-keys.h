@@ -63,5 +63,10 @@
 #define EOG_CONF_UI_DISABLE_CLOSE_CONFIRMATION  "disable-close-confirmation"
 #define EOG_CONF_UI_DISABLE_TRASH_CONFIRMATION	"disable-trash-confirmation"
 #define EOG_CONF_UI_FILECHOOSER_XDG_FALLBACK	"filechooser-xdg-fallback"
+#define EOG_CONF_UI_RECURSIVE_FOLDERS		"recursive-folders"
+#define EOG_CONF_UI_RECURSIVE_MAX_DEPTH		"recursive-max-depth"
+#define EOG_CONF_UI_SORT_KEY			"sort-key"
+#define EOG_CONF_UI_JPEG_PROGRESSIVE		"jpeg-progressive"
+#define EOG_CONF_UI_JPEG_OPTIMIZE		"jpeg-optimize"
 
 #define EOG_CONF_PLUGINS_ACTIVE_PLUGINS         "active-plugins"
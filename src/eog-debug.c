@@ -30,6 +30,8 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "eog-debug.h"
 
@@ -42,6 +44,123 @@ static gdouble last = 0.0;
 
 static EogDebug debug = EOG_DEBUG_NO_DEBUG;
 
+/*
+ * Span tracing
+ *
+ * With EOG_TRACE=FILE set, eog_debug_trace_begin() and
+ * eog_debug_trace_end() record spans with the thread and monotonic
+ * time, and they are written to FILE as Chrome trace JSON on exit, for
+ * chrome://tracing or Perfetto. The "dump-trace" application action
+ * writes them while running.
+ *
+ * Every thread records into a ring buffer of its own, so recording
+ * takes no lock, only the first span of a thread does. The oldest
+ * spans of a thread are overwritten once its buffer is full. The
+ * buffers of finished threads are reused by new ones.
+ */
+#define EOG_TRACE_BUFFER_SIZE 8192
+
+typedef struct {
+	const gchar *name;
+	gint64       begin;
+	gint64       duration;
+	guint        tid;
+} EogTraceSpan;
+
+typedef struct {
+	EogTraceSpan spans[EOG_TRACE_BUFFER_SIZE];
+	guint        tid;
+	gint         head;      /* next span to write */
+	gint         wrapped;
+} EogTraceBuffer;
+
+static void eog_trace_buffer_release (gpointer data);
+
+static gboolean trace_enabled = FALSE;
+static gchar *trace_filename = NULL;
+static gint64 trace_start = 0;
+static guint trace_main_tid = 0;
+
+static GPrivate trace_buffer_key = G_PRIVATE_INIT (eog_trace_buffer_release);
+static GMutex trace_mutex;
+static GSList *trace_buffers = NULL;        /* all of them */
+static GSList *trace_free_buffers = NULL;   /* of finished threads */
+static guint trace_n_threads = 0;
+
+static void
+eog_trace_buffer_release (gpointer data)
+{
+	/* --- enter critical section --- */
+	g_mutex_lock (&trace_mutex);
+
+	trace_free_buffers = g_slist_prepend (trace_free_buffers, data);
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&trace_mutex);
+}
+
+static EogTraceBuffer *
+eog_trace_get_buffer (void)
+{
+	EogTraceBuffer *buffer;
+
+	buffer = g_private_get (&trace_buffer_key);
+
+	if (G_LIKELY (buffer != NULL))
+		return buffer;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&trace_mutex);
+
+	if (trace_free_buffers != NULL) {
+		buffer = trace_free_buffers->data;
+		trace_free_buffers = g_slist_delete_link (trace_free_buffers,
+							  trace_free_buffers);
+	} else {
+		buffer = g_new0 (EogTraceBuffer, 1);
+		trace_buffers = g_slist_prepend (trace_buffers, buffer);
+	}
+
+	/* The spans keep the id of the thread that recorded them */
+	buffer->tid = ++trace_n_threads;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&trace_mutex);
+
+	g_private_set (&trace_buffer_key, buffer);
+
+	return buffer;
+}
+
+static void
+eog_debug_trace_dump_at_exit (void)
+{
+	GError *error = NULL;
+
+	if (!eog_debug_trace_dump (NULL, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+	}
+}
+
+static void
+eog_debug_trace_init (void)
+{
+	const gchar *filename;
+
+	filename = g_getenv ("EOG_TRACE");
+
+	if (filename == NULL || *filename == '\0' || trace_enabled)
+		return;
+
+	trace_filename = g_strdup (filename);
+	trace_start = g_get_monotonic_time ();
+	trace_main_tid = eog_trace_get_buffer ()->tid;
+	trace_enabled = TRUE;
+
+	atexit (eog_debug_trace_dump_at_exit);
+}
+
 void
 eog_debug_init (void)
 {
@@ -88,13 +207,17 @@ eog_debug_init (void)
 	if (g_getenv ("EOG_DEBUG_PLUGINS") != NULL)
 		debug = debug | EOG_DEBUG_PLUGINS;
 
+	if (g_getenv ("EOG_DEBUG_STARTUP") != NULL)
+		debug = debug | EOG_DEBUG_STARTUP;
+
 out:
 
 #ifdef ENABLE_PROFILING
 	if (debug != EOG_DEBUG_NO_DEBUG)
 		timer = g_timer_new ();
 #endif
-	return;
+
+	eog_debug_trace_init ();
 }
 
 void
@@ -158,3 +281,168 @@ void eog_debug (EogDebug  section,
 		fflush (stdout);
 	}
 }
+
+gboolean
+eog_debug_trace_is_enabled (void)
+{
+	return trace_enabled;
+}
+
+/**
+ * eog_debug_trace_begin:
+ *
+ * Starts a span, which is recorded by eog_debug_trace_end() on the
+ * same thread.
+ *
+ * Returns: the start of the span, or 0 if tracing is disabled.
+ **/
+gint64
+eog_debug_trace_begin (void)
+{
+	if (G_LIKELY (!trace_enabled))
+		return 0;
+
+	return g_get_monotonic_time ();
+}
+
+/**
+ * eog_debug_trace_end:
+ * @name: the name of the span, which must stay valid, e.g. a literal
+ * or a type name
+ * @begin: what eog_debug_trace_begin() returned
+ *
+ * Records a span from @begin until now.
+ **/
+void
+eog_debug_trace_end (const gchar *name, gint64 begin)
+{
+	EogTraceBuffer *buffer;
+	EogTraceSpan *span;
+	gint head;
+
+	if (G_LIKELY (begin == 0))
+		return;
+
+	buffer = eog_trace_get_buffer ();
+
+	/* Only this thread writes, readers only look at what the head
+	 * has been moved past */
+	head = buffer->head;
+	span = &buffer->spans[head];
+	span->name = name;
+	span->begin = begin;
+	span->duration = g_get_monotonic_time () - begin;
+	span->tid = buffer->tid;
+
+	head = (head + 1) % EOG_TRACE_BUFFER_SIZE;
+
+	if (head == 0)
+		g_atomic_int_set (&buffer->wrapped, TRUE);
+
+	g_atomic_int_set (&buffer->head, head);
+}
+
+/* Appends @str as a quoted JSON string. g_strescape() isn't used as it
+ * writes octal escapes, which JSON doesn't have. */
+static void
+append_json_string (GString *json, const gchar *str)
+{
+	const gchar *p;
+
+	g_string_append_c (json, '"');
+
+	for (p = str; *p != '\0'; p++) {
+		guchar c = *p;
+
+		if (c == '"' || c == '\\')
+			g_string_append_printf (json, "\\%c", c);
+		else if (c < 0x20)
+			g_string_append_printf (json, "\\u%04x", c);
+		else
+			g_string_append_c (json, c);
+	}
+
+	g_string_append_c (json, '"');
+}
+
+/**
+ * eog_debug_trace_dump:
+ * @filename: (allow-none): the file to write, or %NULL for the one
+ * given in EOG_TRACE
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes the recorded spans as Chrome trace JSON. Spans recorded
+ * while dumping may be missing or, once a buffer wraps around, mixed
+ * up with older ones.
+ *
+ * Returns: %TRUE on success.
+ **/
+gboolean
+eog_debug_trace_dump (const gchar *filename, GError **error)
+{
+	GString *json;
+	GSList *it;
+	gboolean success;
+	gint pid;
+
+	if (!trace_enabled)
+		return TRUE;
+
+	if (filename == NULL)
+		filename = trace_filename;
+
+	pid = getpid ();
+
+	json = g_string_new ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	g_string_append_printf (json,
+				"{\"name\":\"thread_name\",\"ph\":\"M\","
+				"\"pid\":%d,\"tid\":%u,"
+				"\"args\":{\"name\":\"main\"}}",
+				pid, trace_main_tid);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&trace_mutex);
+
+	for (it = trace_buffers; it != NULL; it = it->next) {
+		EogTraceBuffer *buffer = it->data;
+		gint head, first, n_spans, i;
+
+		head = g_atomic_int_get (&buffer->head);
+
+		if (g_atomic_int_get (&buffer->wrapped)) {
+			first = head;
+			n_spans = EOG_TRACE_BUFFER_SIZE;
+		} else {
+			first = 0;
+			n_spans = head;
+		}
+
+		for (i = 0; i < n_spans; i++) {
+			EogTraceSpan *span;
+
+			span = &buffer->spans[(first + i) % EOG_TRACE_BUFFER_SIZE];
+
+			g_string_append (json, ",\n{\"name\":");
+			append_json_string (json, span->name);
+			g_string_append_printf (json,
+						",\"cat\":\"eog\","
+						"\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+						"\"ts\":%" G_GINT64_FORMAT ","
+						"\"dur\":%" G_GINT64_FORMAT "}",
+						pid, span->tid,
+						span->begin - trace_start,
+						span->duration);
+		}
+	}
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&trace_mutex);
+
+	g_string_append (json, "\n]}\n");
+
+	success = g_file_set_contents (filename, json->str, json->len, error);
+
+	g_string_free (json, TRUE);
+
+	return success;
+}
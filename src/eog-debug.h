@@ -44,7 +44,8 @@ typedef enum {
 	EOG_DEBUG_PREFERENCES  = 1 << 8,
 	EOG_DEBUG_PRINTING     = 1 << 9,
 	EOG_DEBUG_LCMS         = 1 << 10,
-	EOG_DEBUG_PLUGINS      = 1 << 11
+	EOG_DEBUG_PLUGINS      = 1 << 11,
+	EOG_DEBUG_STARTUP      = 1 << 12
 } EogDebug;
 
 #define	DEBUG_WINDOW		EOG_DEBUG_WINDOW,      __FILE__, __LINE__, G_STRFUNC
@@ -59,6 +60,7 @@ typedef enum {
 #define	DEBUG_PRINTING		EOG_DEBUG_PRINTING,    __FILE__, __LINE__, G_STRFUNC
 #define	DEBUG_LCMS 		EOG_DEBUG_LCMS,        __FILE__, __LINE__, G_STRFUNC
 #define	DEBUG_PLUGINS 		EOG_DEBUG_PLUGINS,     __FILE__, __LINE__, G_STRFUNC
+#define	DEBUG_STARTUP 		EOG_DEBUG_STARTUP,     __FILE__, __LINE__, G_STRFUNC
 
 void   eog_debug_init        (void);
 
@@ -72,3 +74,13 @@ void   eog_debug_message     (EogDebug    section,
 			      gint               line,
 			      const gchar       *function,
 			      const gchar       *format, ...) G_GNUC_PRINTF(5, 6);
+
+gboolean eog_debug_trace_is_enabled (void);
+
+gint64   eog_debug_trace_begin      (void);
+
+void     eog_debug_trace_end        (const gchar *name,
+				     gint64       begin);
+
+gboolean eog_debug_trace_dump       (const gchar *filename,
+				     GError     **error);
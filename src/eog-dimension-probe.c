@@ -0,0 +1,349 @@
+/* Eye Of GNOME -- Image Dimension Probe
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Reads the image dimensions straight from the file headers, which is
+ * a lot cheaper than setting up a GdkPixbufLoader and feeding it until
+ * it emits size-prepared. Only the first bytes of the file are read,
+ * JPEG segments and TIFF directories are skipped over instead.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "eog-dimension-probe.h"
+#include "eog-debug.h"
+
+/* Enough for the PNG IHDR, GIF screen descriptor and WebP frame headers */
+#define EOG_PROBE_HEADER_SIZE 32
+
+/* Give up on JPEGs and TIFFs that look unreasonable */
+#define EOG_PROBE_MAX_JPEG_SEGMENTS 64
+#define EOG_PROBE_MAX_TIFF_ENTRIES  256
+
+typedef struct {
+	GInputStream *stream;
+	GCancellable *cancellable;
+	goffset       position;
+} EogProbe;
+
+static gboolean
+probe_read (EogProbe *probe, guchar *buf, gsize len)
+{
+	gsize bytes_read = 0;
+
+	if (!g_input_stream_read_all (probe->stream, buf, len, &bytes_read,
+				      probe->cancellable, NULL) ||
+	    bytes_read != len)
+		return FALSE;
+
+	probe->position += len;
+
+	return TRUE;
+}
+
+static gboolean
+probe_skip (EogProbe *probe, gsize len)
+{
+	gssize skipped;
+
+	while (len > 0) {
+		skipped = g_input_stream_skip (probe->stream, len,
+					       probe->cancellable, NULL);
+		if (skipped <= 0)
+			return FALSE;
+
+		len -= skipped;
+		probe->position += skipped;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+probe_seek (EogProbe *probe, goffset offset)
+{
+	if (offset >= probe->position)
+		return probe_skip (probe, offset - probe->position);
+
+	if (G_IS_SEEKABLE (probe->stream) &&
+	    g_seekable_can_seek (G_SEEKABLE (probe->stream)) &&
+	    g_seekable_seek (G_SEEKABLE (probe->stream), offset, G_SEEK_SET,
+			     probe->cancellable, NULL)) {
+		probe->position = offset;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static inline guint16
+get_u16 (const guchar *p, gboolean big_endian)
+{
+	return big_endian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+}
+
+static inline guint32
+get_u32 (const guchar *p, gboolean big_endian)
+{
+	return big_endian ?
+		((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3] :
+		((guint32) p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+/* Walks the marker segments up to the first SOFn, the 2 bytes
+ * of the SOI marker have already been consumed */
+static gboolean
+probe_jpeg (EogProbe *probe, gint *width, gint *height)
+{
+	guchar buf[5];
+	guchar marker;
+	guint16 length;
+	gint segments;
+
+	for (segments = 0; segments < EOG_PROBE_MAX_JPEG_SEGMENTS; segments++) {
+		if (!probe_read (probe, &marker, 1) || marker != 0xFF)
+			return FALSE;
+
+		/* Any number of 0xFF fill bytes may precede a marker */
+		do {
+			if (!probe_read (probe, &marker, 1))
+				return FALSE;
+		} while (marker == 0xFF);
+
+		/* Markers without a payload */
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			continue;
+
+		/* Start of scan or end of image before any frame header */
+		if (marker == 0xDA || marker == 0xD9)
+			return FALSE;
+
+		if (!probe_read (probe, buf, 2))
+			return FALSE;
+
+		length = get_u16 (buf, TRUE);
+		if (length < 2)
+			return FALSE;
+
+		/* SOF0-SOF15, except DHT, JPG and DAC */
+		if (marker >= 0xC0 && marker <= 0xCF &&
+		    marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (length < 7 || !probe_read (probe, buf, 5))
+				return FALSE;
+
+			*height = get_u16 (buf + 1, TRUE);
+			*width  = get_u16 (buf + 3, TRUE);
+
+			/* A zero height is defined later by a DNL marker */
+			return (*width > 0 && *height > 0);
+		}
+
+		if (!probe_skip (probe, length - 2))
+			return FALSE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+probe_tiff (EogProbe *probe, const guchar *header, gint *width, gint *height)
+{
+	gboolean big_endian = (header[0] == 'M');
+	guchar entry[12];
+	guint32 ifd_offset;
+	guint16 n_entries, tag, type;
+	guint32 value;
+	gint i;
+
+	*width = *height = 0;
+
+	ifd_offset = get_u32 (header + 4, big_endian);
+
+	if (ifd_offset < 8 || !probe_seek (probe, ifd_offset))
+		return FALSE;
+
+	if (!probe_read (probe, entry, 2))
+		return FALSE;
+
+	n_entries = get_u16 (entry, big_endian);
+
+	for (i = 0; i < MIN (n_entries, EOG_PROBE_MAX_TIFF_ENTRIES); i++) {
+		if (!probe_read (probe, entry, sizeof (entry)))
+			return FALSE;
+
+		tag  = get_u16 (entry, big_endian);
+		type = get_u16 (entry + 2, big_endian);
+
+		if (tag != 256 && tag != 257)
+			continue;
+
+		/* SHORT or LONG, stored left-aligned in the value field */
+		if (type == 3)
+			value = get_u16 (entry + 8, big_endian);
+		else if (type == 4)
+			value = get_u32 (entry + 8, big_endian);
+		else
+			return FALSE;
+
+		if (tag == 256)
+			*width = value;
+		else
+			*height = value;
+
+		if (*width > 0 && *height > 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+probe_webp (const guchar *header, gint *width, gint *height)
+{
+	if (memcmp (header + 12, "VP8 ", 4) == 0) {
+		/* Lossy, key frame start code followed by 14 bit sizes */
+		if (header[23] != 0x9d || header[24] != 0x01 || header[25] != 0x2a)
+			return FALSE;
+
+		*width  = get_u16 (header + 26, FALSE) & 0x3fff;
+		*height = get_u16 (header + 28, FALSE) & 0x3fff;
+	} else if (memcmp (header + 12, "VP8L", 4) == 0) {
+		guint32 bits;
+
+		/* Lossless, signature byte followed by packed 14 bit sizes */
+		if (header[20] != 0x2f)
+			return FALSE;
+
+		bits = get_u32 (header + 21, FALSE);
+		*width  = (bits & 0x3fff) + 1;
+		*height = ((bits >> 14) & 0x3fff) + 1;
+	} else if (memcmp (header + 12, "VP8X", 4) == 0) {
+		/* Extended, 24 bit canvas sizes */
+		*width  = (header[24] | (header[25] << 8) | (header[26] << 16)) + 1;
+		*height = (header[27] | (header[28] << 8) | (header[29] << 16)) + 1;
+	} else {
+		return FALSE;
+	}
+
+	return (*width > 0 && *height > 0);
+}
+
+/**
+ * eog_dimension_probe:
+ * @stream: a #GInputStream positioned at the start of the image
+ * @width: (out): return location for the image width
+ * @height: (out): return location for the image height
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ *
+ * Reads the dimensions of a JPEG, PNG, GIF, WebP or TIFF image from
+ * its headers. The stream is left at an unspecified position, so the
+ * caller needs to seek back if it wants to read the image afterwards.
+ *
+ * Returns: %TRUE if the dimensions could be determined.
+ **/
+gboolean
+eog_dimension_probe (GInputStream *stream,
+		     gint         *width,
+		     gint         *height,
+		     GCancellable *cancellable)
+{
+	EogProbe probe = { stream, cancellable, 0 };
+	guchar header[EOG_PROBE_HEADER_SIZE];
+	gsize header_len = 0;
+	gboolean found = FALSE;
+
+	g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (width != NULL && height != NULL, FALSE);
+
+	if (!probe_read (&probe, header, 2))
+		return FALSE;
+
+	if (header[0] == 0xFF && header[1] == 0xD8) {
+		found = probe_jpeg (&probe, width, height);
+		goto out;
+	}
+
+	if (!g_input_stream_read_all (stream, header + 2, sizeof (header) - 2,
+				      &header_len, cancellable, NULL))
+		return FALSE;
+
+	header_len += 2;
+	probe.position = header_len;
+
+	if (header_len >= 24 &&
+	    memcmp (header, "\x89PNG\x0D\x0A\x1a\x0A", 8) == 0 &&
+	    memcmp (header + 12, "IHDR", 4) == 0) {
+		*width  = get_u32 (header + 16, TRUE);
+		*height = get_u32 (header + 20, TRUE);
+		found = (*width > 0 && *height > 0);
+	} else if (header_len >= 10 &&
+		   (memcmp (header, "GIF87a", 6) == 0 ||
+		    memcmp (header, "GIF89a", 6) == 0)) {
+		*width  = get_u16 (header + 6, FALSE);
+		*height = get_u16 (header + 8, FALSE);
+		found = (*width > 0 && *height > 0);
+	} else if (header_len >= 30 &&
+		   memcmp (header, "RIFF", 4) == 0 &&
+		   memcmp (header + 8, "WEBP", 4) == 0) {
+		found = probe_webp (header, width, height);
+	} else if (header_len >= 8 &&
+		   (memcmp (header, "II*\0", 4) == 0 ||
+		    memcmp (header, "MM\0*", 4) == 0)) {
+		found = probe_tiff (&probe, header, width, height);
+	}
+
+out:
+	eog_debug_message (DEBUG_IMAGE_DATA, "Dimension probe %s: %ix%i",
+			   found ? "succeeded" : "failed",
+			   found ? *width : 0, found ? *height : 0);
+
+	return found;
+}
+
+/**
+ * eog_dimension_probe_supports_mime_type:
+ * @mime_type: a MIME type
+ *
+ * Whether eog_dimension_probe() knows the format of @mime_type. Other
+ * formats, e.g. camera raw files wrapped in TIFF containers, need to
+ * go through a #GdkPixbufLoader.
+ *
+ * Returns: %TRUE if the format can be probed.
+ **/
+gboolean
+eog_dimension_probe_supports_mime_type (const gchar *mime_type)
+{
+	static const gchar *supported[] = {
+		"image/jpeg",
+		"image/png",
+		"image/gif",
+		"image/webp",
+		"image/tiff",
+		NULL
+	};
+
+	if (mime_type == NULL)
+		return FALSE;
+
+	return g_strv_contains (supported, mime_type);
+}
@@ -0,0 +1,35 @@
+/* Eye Of GNOME -- Image Dimension Probe
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+G_GNUC_INTERNAL
+gboolean eog_dimension_probe (GInputStream *stream,
+			      gint         *width,
+			      gint         *height,
+			      GCancellable *cancellable);
+
+G_GNUC_INTERNAL
+gboolean eog_dimension_probe_supports_mime_type (const gchar *mime_type);
+
+G_END_DECLS
@@ -46,6 +46,7 @@
 #include <jerror.h>
 #include "transupp.h"
 #include <glib.h>
+#include <gio/gio.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib/gi18n.h>
 #ifdef HAVE_EXIF
@@ -109,6 +110,225 @@ output_message_handler (j_common_ptr cinfo)
 	/* do nothing */
 }
 
+/* libjpeg source and destination managers reading from a GInputStream
+ * and writing to a GOutputStream. I/O errors are stored in the GError
+ * of the error handler before bailing out through it. */
+#define EOG_JPEG_IO_BUFFER_SIZE 65536
+
+typedef struct {
+	struct jpeg_source_mgr pub;
+	GInputStream *stream;
+	GError      **error;
+	JOCTET       *buffer;
+} EogJpegGioSource;
+
+typedef struct {
+	struct jpeg_destination_mgr pub;
+	GOutputStream *stream;
+	GError       **error;
+	JOCTET        *buffer;
+} EogJpegGioDest;
+
+static void
+gio_set_error (GError **error, GError *ioerror)
+{
+	if (error != NULL && *error == NULL)
+		g_propagate_error (error, ioerror);
+	else
+		g_error_free (ioerror);
+}
+
+static void
+gio_src_init_source (j_decompress_ptr cinfo)
+{
+	EogJpegGioSource *src = (EogJpegGioSource *) cinfo->src;
+
+	src->pub.next_input_byte = NULL;
+	src->pub.bytes_in_buffer = 0;
+}
+
+static boolean
+gio_src_fill_input_buffer (j_decompress_ptr cinfo)
+{
+	EogJpegGioSource *src = (EogJpegGioSource *) cinfo->src;
+	GError *ioerror = NULL;
+	gssize n;
+
+	n = g_input_stream_read (src->stream, src->buffer,
+				 EOG_JPEG_IO_BUFFER_SIZE, NULL, &ioerror);
+
+	if (n < 0) {
+		gio_set_error (src->error, ioerror);
+		ERREXIT (cinfo, JERR_FILE_READ);
+	}
+
+	if (n == 0) {
+		/* Insert a fake EOI marker, as jpeg_stdio_src does */
+		WARNMS (cinfo, JWRN_JPEG_EOF);
+		src->buffer[0] = (JOCTET) 0xFF;
+		src->buffer[1] = (JOCTET) JPEG_EOI;
+		n = 2;
+	}
+
+	src->pub.next_input_byte = src->buffer;
+	src->pub.bytes_in_buffer = n;
+
+	return TRUE;
+}
+
+static void
+gio_src_skip_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+	EogJpegGioSource *src = (EogJpegGioSource *) cinfo->src;
+
+	if (num_bytes <= 0)
+		return;
+
+	if ((size_t) num_bytes <= src->pub.bytes_in_buffer) {
+		src->pub.next_input_byte += num_bytes;
+		src->pub.bytes_in_buffer -= num_bytes;
+		return;
+	}
+
+	/* Let the stream seek over what isn't buffered; a short skip
+	 * means end of file, which the refill takes care of */
+	num_bytes -= src->pub.bytes_in_buffer;
+	src->pub.bytes_in_buffer = 0;
+
+	g_input_stream_skip (src->stream, num_bytes, NULL, NULL);
+
+	(void) gio_src_fill_input_buffer (cinfo);
+}
+
+static void
+gio_src_term_source (j_decompress_ptr cinfo)
+{
+	/* The stream is owned by the caller */
+}
+
+static void
+eog_jpeg_gio_src (j_decompress_ptr cinfo, GInputStream *stream, GError **error)
+{
+	EogJpegGioSource *src;
+
+	/* The manager lives in the permanent pool, as with jpeg_stdio_src
+	 * it's only allocated the first time a decompressor is used */
+	if (cinfo->src == NULL) {
+		src = (EogJpegGioSource *)
+			(*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+						    sizeof (EogJpegGioSource));
+		src->buffer = (JOCTET *)
+			(*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+						    EOG_JPEG_IO_BUFFER_SIZE * sizeof (JOCTET));
+		cinfo->src = (struct jpeg_source_mgr *) src;
+	}
+
+	src = (EogJpegGioSource *) cinfo->src;
+
+	src->pub.init_source = gio_src_init_source;
+	src->pub.fill_input_buffer = gio_src_fill_input_buffer;
+	src->pub.skip_input_data = gio_src_skip_input_data;
+	src->pub.resync_to_restart = jpeg_resync_to_restart;
+	src->pub.term_source = gio_src_term_source;
+	src->pub.next_input_byte = NULL;
+	src->pub.bytes_in_buffer = 0;
+	src->stream = stream;
+	src->error = error;
+}
+
+static void
+gio_dest_write (j_compress_ptr cinfo, gsize count)
+{
+	EogJpegGioDest *dest = (EogJpegGioDest *) cinfo->dest;
+	GError *ioerror = NULL;
+
+	if (!g_output_stream_write_all (dest->stream, dest->buffer, count,
+					NULL, NULL, &ioerror)) {
+		gio_set_error (dest->error, ioerror);
+		ERREXIT (cinfo, JERR_FILE_WRITE);
+	}
+}
+
+static void
+gio_dest_init_destination (j_compress_ptr cinfo)
+{
+	EogJpegGioDest *dest = (EogJpegGioDest *) cinfo->dest;
+
+	dest->pub.next_output_byte = dest->buffer;
+	dest->pub.free_in_buffer = EOG_JPEG_IO_BUFFER_SIZE;
+}
+
+static boolean
+gio_dest_empty_output_buffer (j_compress_ptr cinfo)
+{
+	EogJpegGioDest *dest = (EogJpegGioDest *) cinfo->dest;
+
+	/* libjpeg ignores free_in_buffer here, the whole buffer is full */
+	gio_dest_write (cinfo, EOG_JPEG_IO_BUFFER_SIZE);
+
+	dest->pub.next_output_byte = dest->buffer;
+	dest->pub.free_in_buffer = EOG_JPEG_IO_BUFFER_SIZE;
+
+	return TRUE;
+}
+
+static void
+gio_dest_term_destination (j_compress_ptr cinfo)
+{
+	EogJpegGioDest *dest = (EogJpegGioDest *) cinfo->dest;
+	gsize count = EOG_JPEG_IO_BUFFER_SIZE - dest->pub.free_in_buffer;
+
+	if (count > 0)
+		gio_dest_write (cinfo, count);
+}
+
+static void
+eog_jpeg_gio_dest (j_compress_ptr cinfo, GOutputStream *stream, GError **error)
+{
+	EogJpegGioDest *dest;
+
+	/* Only allocated the first time, so that a reused compressor
+	 * doesn't pile up managers in its permanent pool */
+	if (cinfo->dest == NULL) {
+		dest = (EogJpegGioDest *)
+			(*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+						    sizeof (EogJpegGioDest));
+		dest->buffer = (JOCTET *)
+			(*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+						    EOG_JPEG_IO_BUFFER_SIZE * sizeof (JOCTET));
+		cinfo->dest = (struct jpeg_destination_mgr *) dest;
+	}
+
+	dest = (EogJpegGioDest *) cinfo->dest;
+
+	dest->pub.init_destination = gio_dest_init_destination;
+	dest->pub.empty_output_buffer = gio_dest_empty_output_buffer;
+	dest->pub.term_destination = gio_dest_term_destination;
+	dest->stream = stream;
+	dest->error = error;
+}
+
+/* Opens the JPEG file a lossless transformation reads from. It must be
+ * called before the output is opened: when the destination is the
+ * source file itself it's read into memory, as GIO falls back to
+ * rewriting a file in place when it can't replace it with a temporary
+ * file, and so do some GVFS backends. Opening the output truncates the
+ * file then. */
+GInputStream *
+eog_image_jpeg_open_source (GFile *file, gboolean in_place, GError **error)
+{
+	gchar *contents;
+	gsize length;
+
+	if (!in_place)
+		return G_INPUT_STREAM (g_file_read (file, NULL, error));
+
+	if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
+		return NULL;
+
+	return g_memory_input_stream_new_from_data (contents, length, g_free);
+}
+
 static void
 init_transform_info (EogImage *image, jpeg_transform_info *info)
 {
@@ -177,7 +397,8 @@ init_transform_info (EogImage *image, jpeg_transform_info *info)
 }
 
 static gboolean
-_save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
+_save_jpeg_as_jpeg (EogImage *image, GInputStream *input_stream,
+		    GOutputStream *stream, EogImageSaveInfo *source,
 		    EogImageSaveInfo *target, GError **error)
 {
 	struct jpeg_decompress_struct  srcinfo;
@@ -186,21 +407,23 @@ _save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 	jpeg_transform_info            transformoption;
 	jvirt_barray_ptr              *src_coef_arrays;
 	jvirt_barray_ptr              *dst_coef_arrays;
-	FILE                          *output_file;
-	FILE                          *input_file;
 	EogImagePrivate               *priv;
-	gchar                          *infile_uri;
+	EogImageSaveInfo              *options;
 
 	g_return_val_if_fail (EOG_IS_IMAGE (image), FALSE);
 	g_return_val_if_fail (EOG_IMAGE (image)->priv->file != NULL, FALSE);
+	g_return_val_if_fail (G_IS_INPUT_STREAM (input_stream), FALSE);
 
 	priv = image->priv;
 
+	/* In place saves have no target, the source carries the options */
+	options = target != NULL ? target : source;
+
 	init_transform_info (image, &transformoption);
 
 	/* Initialize the JPEG decompression object with default error
 	 * handling. */
-	jsrcerr.filename = g_file_get_path (priv->file);
+	jsrcerr.filename = g_file_get_basename (priv->file);
 	srcinfo.err = jpeg_std_error (&(jsrcerr.pub));
 	jsrcerr.pub.error_exit = fatal_error_handler;
 	jsrcerr.pub.output_message = output_message_handler;
@@ -210,7 +433,7 @@ _save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 
 	/* Initialize the JPEG compression object with default error
 	 * handling. */
-	jdsterr.filename = (char *) file;
+	jdsterr.filename = g_file_get_basename (target != NULL ? target->file : priv->file);
 	dstinfo.err = jpeg_std_error (&(jdsterr.pub));
 	jdsterr.pub.error_exit = fatal_error_handler;
 	jdsterr.pub.output_message = output_message_handler;
@@ -225,46 +448,24 @@ _save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 	jsrcerr.pub.trace_level = jdsterr.pub.trace_level;
 	srcinfo.mem->max_memory_to_use = dstinfo.mem->max_memory_to_use;
 
-	/* Open the output file. */
-	/* FIXME: Make this a GIO aware input manager */
-	infile_uri = g_file_get_path (priv->file);
-	input_file = fopen (infile_uri, "rb");
-	if (input_file == NULL) {
-		g_warning ("Input file not openable: %s\n", infile_uri);
-		g_free (jsrcerr.filename);
-		g_free (infile_uri);
-		return FALSE;
-	}
-	g_free (infile_uri);
-
-	output_file = fopen (file, "wb");
-	if (output_file == NULL) {
-		g_warning ("Output file not openable: %s\n", file);
-		fclose (input_file);
-		g_free (jsrcerr.filename);
-		return FALSE;
-	}
-
 	if (sigsetjmp (jsrcerr.setjmp_buffer, 1)) {
-		fclose (output_file);
-		fclose (input_file);
 		jpeg_destroy_compress (&dstinfo);
 		jpeg_destroy_decompress (&srcinfo);
 		g_free (jsrcerr.filename);
+		g_free (jdsterr.filename);
 		return FALSE;
 	}
 
 	if (sigsetjmp (jdsterr.setjmp_buffer, 1)) {
-		fclose (output_file);
-		fclose (input_file);
 		jpeg_destroy_compress (&dstinfo);
 		jpeg_destroy_decompress (&srcinfo);
 		g_free (jsrcerr.filename);
+		g_free (jdsterr.filename);
 		return FALSE;
 	}
 
 	/* Specify data source for decompression */
-	jpeg_stdio_src (&srcinfo, input_file);
+	eog_jpeg_gio_src (&srcinfo, input_stream, error);
 
 	/* Enable saving of extra markers that we want to copy */
 	jcopy_markers_setup (&srcinfo, JCOPYOPT_DEFAULT);
@@ -291,8 +492,25 @@ _save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 							src_coef_arrays,
 							&transformoption);
 
+	/* Both only change the entropy coding, they're still lossless */
+	if (options->jpeg_progressive)
+		jpeg_simple_progression (&dstinfo);
+
+	dstinfo.optimize_coding = options->jpeg_optimize;
+
+	/* Without decoded pixels nothing has updated the image size and the
+	 * EXIF orientation for the transformation yet */
+	if (priv->image == NULL && transformoption.transform != JXFORM_NONE) {
+		g_mutex_lock (&priv->status_mutex);
+		priv->width = dstinfo.image_width;
+		priv->height = dstinfo.image_height;
+		g_mutex_unlock (&priv->status_mutex);
+
+		eog_image_update_exif_data (image);
+	}
+
 	/* Specify data destination for compression */
-	jpeg_stdio_dest (&dstinfo, output_file);
+	eog_jpeg_gio_dest (&dstinfo, stream, error);
 
 	/* Start compressor (note no image data is actually written here) */
 	jpeg_write_coefficients (&dstinfo, dst_coef_arrays);
@@ -333,50 +551,105 @@ _save_jpeg_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 	(void) jpeg_finish_decompress (&srcinfo);
 	jpeg_destroy_decompress (&srcinfo);
 	g_free (jsrcerr.filename);
+	g_free (jdsterr.filename);
 
-	/* Close files */
-	fclose (input_file);
-	fclose (output_file);
-
+	/* Both streams are owned by the caller */
 	return TRUE;
 }
 
+/* Rows handed to libjpeg at once, the tallest MCU is 16 rows high */
+#define EOG_JPEG_BAND_ROWS 16
+
+/* Compressor state kept per thread, so that a batch save reuses the
+ * compressor object and its scanline buffer for all of its images */
+typedef struct {
+	struct jpeg_compress_struct cinfo;
+	struct error_handler_data   jerr;
+	guchar                     *buffer;
+	gsize                       buffer_size;
+} EogJpegEncoder;
+
+static void
+eog_jpeg_encoder_free (gpointer data)
+{
+	EogJpegEncoder *encoder = data;
+
+	jpeg_destroy_compress (&encoder->cinfo);
+	g_free (encoder->buffer);
+	g_free (encoder);
+}
+
+static GPrivate encoder_key = G_PRIVATE_INIT (eog_jpeg_encoder_free);
+
+static EogJpegEncoder *
+eog_jpeg_encoder_get (void)
+{
+	EogJpegEncoder *encoder;
+
+	encoder = g_private_get (&encoder_key);
+
+	if (encoder == NULL) {
+		encoder = g_new0 (EogJpegEncoder, 1);
+
+		encoder->cinfo.err = jpeg_std_error (&(encoder->jerr.pub));
+		encoder->jerr.pub.error_exit = fatal_error_handler;
+		encoder->jerr.pub.output_message = output_message_handler;
+
+		jpeg_create_compress (&encoder->cinfo);
+
+		g_private_set (&encoder_key, encoder);
+	}
+
+	return encoder;
+}
+
+/* Packs a row of RGBA pixels as RGB, four pixels per iteration */
+static void
+pack_rgba_to_rgb (guchar *dest, const guchar *src, gint width)
+{
+	gint x;
+
+	for (x = 0; x + 4 <= width; x += 4, src += 16, dest += 12) {
+		dest[0]  = src[0];  dest[1]  = src[1];  dest[2]  = src[2];
+		dest[3]  = src[4];  dest[4]  = src[5];  dest[5]  = src[6];
+		dest[6]  = src[8];  dest[7]  = src[9];  dest[8]  = src[10];
+		dest[9]  = src[12]; dest[10] = src[13]; dest[11] = src[14];
+	}
+
+	for (; x < width; x++, src += 4, dest += 3) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+	}
+}
+
 static gboolean
-_save_any_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
+_save_any_as_jpeg (EogImage *image, GOutputStream *stream, EogImageSaveInfo *source,
 		   EogImageSaveInfo *target, GError **error)
 {
 	EogImagePrivate *priv;
+	EogImageSaveInfo *options;
+	EogJpegEncoder *encoder;
+	struct jpeg_compress_struct *cinfo;
 	GdkPixbuf *pixbuf;
-	struct jpeg_compress_struct cinfo;
-	guchar *buf = NULL;
-	guchar *ptr;
+	JSAMPROW rows[EOG_JPEG_BAND_ROWS];
 	guchar *pixels = NULL;
-	JSAMPROW *jbuf;
-	int y = 0;
-	volatile int quality = 75; /* default; must be between 0 and 100 */
-	int i, j;
+	gboolean pack;
+	int quality = 75; /* default; must be between 0 and 100 */
+	int n_channels;
 	int w, h = 0;
 	int rowstride = 0;
-	FILE *outfile;
-	struct error_handler_data jerr;
+	guint i, n_rows;
 
 	g_return_val_if_fail (EOG_IS_IMAGE (image), FALSE);
 	g_return_val_if_fail (EOG_IMAGE (image)->priv->image != NULL, FALSE);
 
 	priv = image->priv;
 	pixbuf = priv->image;
-
-	outfile = fopen (file, "wb");
-	if (outfile == NULL) {
-		g_set_error (error,             /* FIXME: Better error message */
-			     GDK_PIXBUF_ERROR,
-			     GDK_PIXBUF_ERROR_INSUFFICIENT_MEMORY,
-			     _("Couldn’t create temporary file for saving: %s"),
-			     file);
-		return FALSE;
-	}
+	options = target != NULL ? target : source;
 
 	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
 	w = gdk_pixbuf_get_width (pixbuf);
 	h = gdk_pixbuf_get_height (pixbuf);
 
@@ -384,49 +657,72 @@ _save_any_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 	pixels = gdk_pixbuf_get_pixels (pixbuf);
 	g_return_val_if_fail (pixels != NULL, FALSE);
 
-	/* allocate a small buffer to convert image data */
-	buf = g_try_malloc (w * 3 * sizeof (guchar));
-	if (!buf) {
-		g_set_error (error,
-			     GDK_PIXBUF_ERROR,
-			     GDK_PIXBUF_ERROR_INSUFFICIENT_MEMORY,
-			     _("Couldn’t allocate memory for loading JPEG file"));
-		fclose (outfile);
-		return FALSE;
+	encoder = eog_jpeg_encoder_get ();
+	cinfo = &encoder->cinfo;
+
+	/* RGB rows are passed to libjpeg as they are */
+	cinfo->input_components = 3;
+	cinfo->in_color_space   = JCS_RGB;
+	pack = (n_channels != 3);
+
+#ifdef JCS_EXTENSIONS
+	/* libjpeg-turbo takes RGBA rows too, and its color conversion
+	 * skips the alpha channel with SIMD code where available */
+	if (n_channels == 4) {
+		cinfo->input_components = 4;
+		cinfo->in_color_space   = JCS_EXT_RGBX;
+		pack = FALSE;
+	}
+#endif
+
+	/* (re)allocate the buffer to pack a band of rows into */
+	if (pack && encoder->buffer_size < (gsize) w * 3 * EOG_JPEG_BAND_ROWS) {
+		g_free (encoder->buffer);
+		encoder->buffer_size = (gsize) w * 3 * EOG_JPEG_BAND_ROWS;
+		encoder->buffer = g_try_malloc (encoder->buffer_size);
+
+		if (encoder->buffer == NULL) {
+			encoder->buffer_size = 0;
+			g_set_error (error,
+				     GDK_PIXBUF_ERROR,
+				     GDK_PIXBUF_ERROR_INSUFFICIENT_MEMORY,
+				     _("Couldn’t allocate memory for loading JPEG file"));
+			return FALSE;
+		}
 	}
 
 	/* set up error handling */
-	jerr.filename = (char *) file;
-	cinfo.err = jpeg_std_error (&(jerr.pub));
-	jerr.pub.error_exit = fatal_error_handler;
-	jerr.pub.output_message = output_message_handler;
-	jerr.error = error;
+	encoder->jerr.filename = g_file_get_basename (target != NULL ? target->file : priv->file);
+	encoder->jerr.error = error;
 
 	/* setup compress params */
-	jpeg_create_compress (&cinfo);
-	jpeg_stdio_dest (&cinfo, outfile);
-	cinfo.image_width      = w;
-	cinfo.image_height     = h;
-	cinfo.input_components = 3;
-	cinfo.in_color_space   = JCS_RGB;
+	eog_jpeg_gio_dest (cinfo, stream, error);
+	cinfo->image_width      = w;
+	cinfo->image_height     = h;
 
 	/* error exit routine */
-	if (sigsetjmp (jerr.setjmp_buffer, 1)) {
-		g_free (buf);
-		fclose (outfile);
-		jpeg_destroy_compress (&cinfo);
+	if (sigsetjmp (encoder->jerr.setjmp_buffer, 1)) {
+		/* keep the compressor usable for the next image */
+		jpeg_abort_compress (cinfo);
+		g_clear_pointer (&encoder->jerr.filename, g_free);
 		return FALSE;
 	}
 
 	/* set desired jpeg quality if available */
 	if (target != NULL && target->jpeg_quality >= 0.0) {
-		quality = (int) MIN (target->jpeg_quality, 1.0) * 100;
+		quality = (int) (MIN (target->jpeg_quality, 1.0) * 100);
 	}
 
 	/* set up jepg compression parameters */
-	jpeg_set_defaults (&cinfo);
-	jpeg_set_quality (&cinfo, quality, TRUE);
-	jpeg_start_compress (&cinfo, TRUE);
+	jpeg_set_defaults (cinfo);
+	jpeg_set_quality (cinfo, quality, TRUE);
+
+	if (options->jpeg_progressive)
+		jpeg_simple_progression (cinfo);
+
+	cinfo->optimize_coding = options->jpeg_optimize;
+
+	jpeg_start_compress (cinfo, TRUE);
 
 	/* write EXIF/IPTC data explicitly */
 #ifdef HAVE_EXIF
@@ -438,45 +734,45 @@ _save_any_as_jpeg (EogImage *image, const char *file, EogImageSaveInfo *source,
 		unsigned int   exif_buf_len;
 
 		exif_data_save_data (priv->exif, &exif_buf, &exif_buf_len);
-		jpeg_write_marker (&cinfo, 0xe1, exif_buf, exif_buf_len);
+		jpeg_write_marker (cinfo, 0xe1, exif_buf, exif_buf_len);
 		g_free (exif_buf);
 	}
 #else
 	if (priv->exif_chunk != NULL) {
-		jpeg_write_marker (&cinfo, JPEG_APP0+1, priv->exif_chunk, priv->exif_chunk_len);
+		jpeg_write_marker (cinfo, JPEG_APP0+1, priv->exif_chunk, priv->exif_chunk_len);
 	}
 #endif
 	/* FIXME: Consider IPTC data too */
 
-	/* get the start pointer */
-	ptr = pixels;
-	/* go one scanline at a time... and save */
-	i = 0;
-	while (cinfo.next_scanline < cinfo.image_height) {
-		/* convert scanline from ARGB to RGB packed */
-		for (j = 0; j < w; j++)
-			memcpy (&(buf[j*3]), &(ptr[i*rowstride + j*(rowstride/w)]), 3);
-
-		/* write scanline */
-		jbuf = (JSAMPROW *)(&buf);
-		jpeg_write_scanlines (&cinfo, jbuf, 1);
-		i++;
-		y++;
+	/* go one band of rows at a time... and save */
+	while (cinfo->next_scanline < cinfo->image_height) {
+		n_rows = MIN (EOG_JPEG_BAND_ROWS,
+			      cinfo->image_height - cinfo->next_scanline);
 
-	}
+		for (i = 0; i < n_rows; i++) {
+			guchar *row = pixels + (gsize) (cinfo->next_scanline + i) * rowstride;
 
-	/* finish off */
-	jpeg_finish_compress (&cinfo);
-	jpeg_destroy_compress(&cinfo);
-	g_free (buf);
+			if (pack) {
+				rows[i] = encoder->buffer + (gsize) i * w * 3;
+				pack_rgba_to_rgb (rows[i], row, w);
+			} else {
+				rows[i] = row;
+			}
+		}
+
+		jpeg_write_scanlines (cinfo, rows, n_rows);
+	}
 
-	fclose (outfile);
+	/* finish off, the compressor is kept for the next image */
+	jpeg_finish_compress (cinfo);
+	g_clear_pointer (&encoder->jerr.filename, g_free);
 
 	return TRUE;
 }
 
 gboolean
-eog_image_jpeg_save_file (EogImage *image, const char *file,
+eog_image_jpeg_save_file (EogImage *image, GInputStream *source_stream,
+			  GOutputStream *stream,
 			  EogImageSaveInfo *source, EogImageSaveInfo *target,
 			  GError **error)
 {
@@ -491,7 +787,7 @@ eog_image_jpeg_save_file (EogImage *image, const char *file,
 
 	/* determine which method should be used for saving */
 	if (target == NULL) {
-		if (source_is_jpeg) {
+		if (source_is_jpeg && source_stream != NULL) {
 			method = EOG_SAVE_JPEG_AS_JPEG;
 		}
 	}
@@ -499,7 +795,7 @@ eog_image_jpeg_save_file (EogImage *image, const char *file,
 		target_is_jpeg = !g_ascii_strcasecmp (target->format, EOG_FILE_FORMAT_JPEG);
 
 		if (source_is_jpeg && target_is_jpeg) {
-			if (target->jpeg_quality < 0.0) {
+			if (target->jpeg_quality < 0.0 && source_stream != NULL) {
 				method = EOG_SAVE_JPEG_AS_JPEG;
 			}
 			else {
@@ -514,10 +810,11 @@ eog_image_jpeg_save_file (EogImage *image, const char *file,
 
 	switch (method) {
 	case EOG_SAVE_JPEG_AS_JPEG:
-		result = _save_jpeg_as_jpeg (image, file, source, target, error);
+		result = _save_jpeg_as_jpeg (image, source_stream, stream,
+					     source, target, error);
 		break;
 	case EOG_SAVE_ANY_AS_JPEG:
-		result = _save_any_as_jpeg (image, file, source, target, error);
+		result = _save_any_as_jpeg (image, stream, source, target, error);
 		break;
 	default:
 		result = FALSE;
@@ -3,17 +3,29 @@
 #ifdef HAVE_JPEG
 
 #include <glib.h>
+#include <gio/gio.h>
 #include "eog-image.h"
 #include "eog-image-save-info.h"
 
+/* Opens the source of a lossless save, see eog_image_jpeg_save_file().
+ * in_place tells whether it's also the destination, it must be opened
+ * before the output stream is.
+ */
+G_GNUC_INTERNAL
+GInputStream *eog_image_jpeg_open_source (GFile *file, gboolean in_place,
+					  GError **error);
+
 /* Saves a source jpeg file in an arbitrary format (as specified by
  * target). The target pointer may be NULL, in which case the output
  * file is saved as jpeg too.  This method tries to be as smart as
  * possible. It will save the image as lossless as possible (if the
- * target is a jpeg image too).
+ * target is a jpeg image too), reading the file from source_stream;
+ * without it the image is reencoded instead. The encoded image is written to
+ * stream. Both streams are left open.
  */
 G_GNUC_INTERNAL
-gboolean eog_image_jpeg_save_file (EogImage *image, const char *file,
+gboolean eog_image_jpeg_save_file (EogImage *image, GInputStream *source_stream,
+				   GOutputStream *stream,
 				   EogImageSaveInfo *source, EogImageSaveInfo *target,
 				   GError **error);
 #endif
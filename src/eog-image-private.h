@@ -53,6 +53,7 @@ struct _EogImagePrivate {
 	gint              height;
 
 	goffset           bytes;
+	guint64           mtime;
 	gchar            *file_type;
 
 	/* Holds EXIF raw data */
@@ -90,6 +91,28 @@ struct _EogImagePrivate {
 
 	EogTransform     *trans;
 	EogTransform     *trans_autorotate;
+
+	/* The loader's pixbuf while it is being decoded, the part of
+	 * it decoded so far and the region updated since the last
+	 * ::area-updated emission */
+	GdkPixbuf        *partial;
+	GdkRectangle      partial_decoded;
+	GdkRectangle      partial_area;
+	guint             partial_update_id;
 };
 
+G_GNUC_INTERNAL
+void eog_image_update_exif_data (EogImage *image);
+
+G_GNUC_INTERNAL
+void eog_image_add_preloaded (EogImage *img);
+
+G_GNUC_INTERNAL
+void eog_image_remove_preloaded (GFile *file);
+
+#ifdef HAVE_EXIF
+G_GNUC_INTERNAL
+EogTransform *eog_image_get_orientation_transform (EogImage *img);
+#endif
+
 G_END_DECLS
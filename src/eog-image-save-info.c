@@ -3,6 +3,8 @@
 #endif
 
 #include <string.h>
+#include <gio/gio.h>
+#include "eog-config-keys.h"
 #include "eog-image-save-info.h"
 #include "eog-image-private.h"
 #include "eog-pixbuf-util.h"
@@ -78,6 +80,31 @@ get_save_file_type_by_file (GFile *file)
 	return type;
 }
 
+/* Batch saves create a save info per image, share the settings
+ * object between them instead of setting one up each time. */
+static GSettings *
+get_ui_settings (void)
+{
+	static GSettings *settings = NULL;
+
+	if (g_once_init_enter (&settings)) {
+		g_once_init_leave (&settings, g_settings_new (EOG_CONF_UI));
+	}
+
+	return settings;
+}
+
+static void
+set_jpeg_options (EogImageSaveInfo *info)
+{
+	GSettings *settings = get_ui_settings ();
+
+	info->jpeg_progressive = g_settings_get_boolean (settings,
+							 EOG_CONF_UI_JPEG_PROGRESSIVE);
+	info->jpeg_optimize = g_settings_get_boolean (settings,
+						      EOG_CONF_UI_JPEG_OPTIMIZE);
+}
+
 EogImageSaveInfo*
 eog_image_save_info_new_from_image (EogImage *image)
 {
@@ -96,6 +123,7 @@ eog_image_save_info_new_from_image (EogImage *image)
 	info->overwrite    = FALSE;
 
 	info->jpeg_quality = -1.0;
+	set_jpeg_options (info);
 
 	return info;
 }
@@ -140,6 +168,7 @@ eog_image_save_info_new_from_file (GFile *file, GdkPixbufFormat *format)
 	info->overwrite    = FALSE;
 
 	info->jpeg_quality = -1.0;
+	set_jpeg_options (info);
 
 	g_assert (info->format != NULL);
 
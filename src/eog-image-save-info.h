@@ -33,6 +33,8 @@ struct _EogImageSaveInfo {
 	gboolean     overwrite;
 
 	float        jpeg_quality; /* valid range: [0.0 ... 1.0] */
+	gboolean     jpeg_progressive;
+	gboolean     jpeg_optimize;   /* optimized Huffman tables */
 };
 
 struct _EogImageSaveInfoClass {
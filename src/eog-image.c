@@ -36,6 +36,8 @@
 #include "eog-marshal.h"
 #include "eog-pixbuf-util.h"
 #include "eog-metadata-reader.h"
+#include "eog-dimension-probe.h"
+#include "eog-metadata-index.h"
 #include "eog-image-save-info.h"
 #include "eog-transform.h"
 #include "eog-util.h"
@@ -82,6 +84,7 @@ enum {
 	SIGNAL_SAVE_PROGRESS,
 	SIGNAL_NEXT_FRAME,
 	SIGNAL_FILE_CHANGED,
+	SIGNAL_AREA_UPDATED,
 	SIGNAL_LAST
 };
 
@@ -91,6 +94,13 @@ static GList *supported_mime_types = NULL;
 
 #define EOG_IMAGE_READ_BUFFER_SIZE 65535
 
+/* Metadata-only loads read in small steps, so the metadata reader
+ * gets the chance to seek over the data in between */
+#define EOG_IMAGE_METADATA_READ_SIZE 4096
+
+/* Minimum interval between two ::area-updated emissions while decoding */
+#define EOG_IMAGE_AREA_UPDATE_INTERVAL 100 /* ms */
+
 static void
 eog_image_free_mem_private (EogImage *image)
 {
@@ -294,6 +304,32 @@ eog_image_class_init (EogImageClass *klass)
 						     NULL, NULL,
 						     g_cclosure_marshal_VOID__VOID,
 						     G_TYPE_NONE, 0);
+
+	/**
+	 * EogImage::area-updated:
+	 * @img: the object which received the signal.
+	 * @x: X offset of the updated area.
+	 * @y: Y offset of the updated area.
+	 * @width: width of the updated area.
+	 * @height: height of the updated area.
+	 *
+	 * The ::area-updated signal is emitted in the main thread while the
+	 * image is still being decoded, whenever more of it is available
+	 * through eog_image_get_partial_pixbuf(). Updates are throttled, so
+	 * the area covers everything decoded since the previous emission.
+	 */
+	signals[SIGNAL_AREA_UPDATED] =
+		g_signal_new ("area-updated",
+			      EOG_TYPE_IMAGE,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EogImageClass, area_updated),
+			      NULL, NULL,
+			      eog_marshal_VOID__INT_INT_INT_INT,
+			      G_TYPE_NONE, 4,
+			      G_TYPE_INT,
+			      G_TYPE_INT,
+			      G_TYPE_INT,
+			      G_TYPE_INT);
 }
 
 static void
@@ -335,10 +371,40 @@ eog_image_init (EogImage *img)
 #endif
 }
 
+/* Images that started loading before the gallery was filled, see
+ * eog_image_add_preloaded(). GFile -> EogImage */
+static GMutex      preloaded_mutex;
+static GHashTable *preloaded_images = NULL;
+
 EogImage *
 eog_image_new_file (GFile *file, const gchar *caption)
 {
-	EogImage *img;
+	EogImage *img = NULL;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&preloaded_mutex);
+
+	if (preloaded_images != NULL) {
+		GFile *key = NULL;
+
+		if (g_hash_table_steal_extended (preloaded_images, file,
+						 (gpointer *) &key,
+						 (gpointer *) &img)) {
+			g_object_unref (key);
+		}
+	}
+
+	g_mutex_unlock (&preloaded_mutex);
+	/* --- leave critical section --- */
+
+	if (img != NULL) {
+		eog_debug_message (DEBUG_IMAGE_LOAD, "Using preloaded image");
+
+		if (img->priv->caption == NULL)
+			img->priv->caption = g_strdup (caption);
+
+		return img;
+	}
 
 	img = EOG_IMAGE (g_object_new (EOG_TYPE_IMAGE, NULL));
 
@@ -348,6 +414,60 @@ eog_image_new_file (GFile *file, const gchar *caption)
 	return img;
 }
 
+/*
+ * eog_image_add_preloaded:
+ * @img: an #EogImage
+ *
+ * Registers @img as being loaded ahead of the gallery, so that the next
+ * eog_image_new_file() call for the same file returns it instead of a
+ * new instance. This lets the first image of a window be decoded while
+ * the window is still being built.
+ */
+void
+eog_image_add_preloaded (EogImage *img)
+{
+	g_return_if_fail (EOG_IS_IMAGE (img));
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&preloaded_mutex);
+
+	if (preloaded_images == NULL) {
+		preloaded_images = g_hash_table_new_full (g_file_hash,
+							  (GEqualFunc) g_file_equal,
+							  g_object_unref,
+							  g_object_unref);
+	}
+
+	g_hash_table_replace (preloaded_images,
+			      g_object_ref (img->priv->file),
+			      g_object_ref (img));
+
+	g_mutex_unlock (&preloaded_mutex);
+	/* --- leave critical section --- */
+}
+
+/*
+ * eog_image_remove_preloaded:
+ * @file: a #GFile
+ *
+ * Drops the preloaded image for @file, if it wasn't picked up by the
+ * gallery.
+ */
+void
+eog_image_remove_preloaded (GFile *file)
+{
+	g_return_if_fail (G_IS_FILE (file));
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&preloaded_mutex);
+
+	if (preloaded_images != NULL)
+		g_hash_table_remove (preloaded_images, file);
+
+	g_mutex_unlock (&preloaded_mutex);
+	/* --- leave critical section --- */
+}
+
 GQuark
 eog_image_error_quark (void)
 {
@@ -360,7 +480,7 @@ eog_image_error_quark (void)
 	return q;
 }
 
-static void
+void
 eog_image_update_exif_data (EogImage *image)
 {
 #ifdef HAVE_EXIF
@@ -452,10 +572,13 @@ eog_image_real_transform (EogImage     *img,
 	}
 
 	if (modified) {
-		priv->modified = TRUE;
 		eog_image_update_exif_data (img);
 	}
 
+	/* The transformation of an image that isn't loaded is applied on
+	 * the next load, it still needs saving */
+	priv->modified = TRUE;
+
 	if (priv->trans == NULL) {
 		g_object_ref (trans);
 		priv->trans = trans;
@@ -518,6 +641,86 @@ eog_image_size_prepared (GdkPixbufLoader *loader,
 		eog_image_emit_size_prepared (img);
 }
 
+static gboolean
+do_emit_area_updated_signal (gpointer data)
+{
+	EogImage *img = EOG_IMAGE (data);
+	EogImagePrivate *priv = img->priv;
+	GdkRectangle area;
+	gboolean decoding;
+
+	g_mutex_lock (&priv->status_mutex);
+	area = priv->partial_area;
+	priv->partial_update_id = 0;
+	decoding = (priv->partial != NULL);
+	g_mutex_unlock (&priv->status_mutex);
+
+	/* Images which get rotated or flipped once loaded would
+	 * jump at the end, so they are only shown when complete */
+	if (decoding && priv->trans == NULL && priv->trans_autorotate == NULL)
+		g_signal_emit (img, signals[SIGNAL_AREA_UPDATED], 0,
+			       area.x, area.y, area.width, area.height);
+
+	return FALSE;
+}
+
+static void
+eog_image_area_prepared (GdkPixbufLoader *loader,
+			 gpointer         data)
+{
+	EogImage *img = EOG_IMAGE (data);
+	GdkPixbuf *pixbuf;
+
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+
+	g_mutex_lock (&img->priv->status_mutex);
+	g_clear_object (&img->priv->partial);
+	if (img->priv->status == EOG_IMAGE_STATUS_LOADING && pixbuf != NULL)
+		img->priv->partial = g_object_ref (pixbuf);
+	img->priv->partial_decoded.width = 0;
+	img->priv->partial_decoded.height = 0;
+	g_mutex_unlock (&img->priv->status_mutex);
+}
+
+/* Runs in the loading thread, so only collect the updated area
+ * here and let the main loop pick it up every now and then */
+static void
+eog_image_area_updated (GdkPixbufLoader *loader,
+			gint             x,
+			gint             y,
+			gint             width,
+			gint             height,
+			gpointer         data)
+{
+	EogImagePrivate *priv = EOG_IMAGE (data)->priv;
+	GdkRectangle area = { x, y, width, height };
+
+	g_mutex_lock (&priv->status_mutex);
+
+	if (priv->partial_decoded.width == 0)
+		priv->partial_decoded = area;
+	else
+		gdk_rectangle_union (&priv->partial_decoded, &area,
+				     &priv->partial_decoded);
+
+	if (priv->partial == NULL) {
+		/* Nobody can see it anyway */
+	} else if (priv->partial_update_id != 0) {
+		gdk_rectangle_union (&priv->partial_area, &area,
+				     &priv->partial_area);
+	} else {
+		priv->partial_area = area;
+		priv->partial_update_id =
+			g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE,
+					    EOG_IMAGE_AREA_UPDATE_INTERVAL,
+					    do_emit_area_updated_signal,
+					    g_object_ref (data),
+					    g_object_unref);
+	}
+
+	g_mutex_unlock (&priv->status_mutex);
+}
+
 static EogMetadataReader*
 check_for_metadata_img_format (EogImage *img, guchar *buffer, guint bytes_read)
 {
@@ -591,6 +794,10 @@ eog_image_apply_transformations (EogImage *img, GError **error)
 	if (transformed != NULL) {
 		priv->width = gdk_pixbuf_get_width (priv->image);
 		priv->height = gdk_pixbuf_get_height (priv->image);
+
+		/* The pixels are upright now, the EXIF orientation
+		 * must not be applied a second time when saving */
+		eog_image_update_exif_data (img);
 	} else {
 		g_set_error (error,
 			     EOG_IMAGE_ERROR,
@@ -606,6 +813,7 @@ eog_image_apply_transformations (EogImage *img, GError **error)
 static void
 eog_image_get_file_info (EogImage *img,
 			 goffset *bytes,
+			 guint64 *mtime,
 			 gchar **mime_type,
 			 GError **error)
 {
@@ -613,6 +821,7 @@ eog_image_get_file_info (EogImage *img,
 
 	file_info = g_file_query_info (img->priv->file,
 				       G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				       G_FILE_ATTRIBUTE_TIME_MODIFIED ","
 				       G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
 				       G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
 				       G_FILE_QUERY_INFO_NONE, NULL, error);
@@ -621,12 +830,19 @@ eog_image_get_file_info (EogImage *img,
 		if (bytes)
 			*bytes = 0;
 
+		if (mtime)
+			*mtime = 0;
+
 		if (mime_type)
 			*mime_type = NULL;
 	} else {
 		if (bytes)
 			*bytes = g_file_info_get_size (file_info);
 
+		if (mtime)
+			*mtime = g_file_info_get_attribute_uint64 (file_info,
+								   G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
 		if (mime_type) {
 			*mime_type = eog_util_get_mime_type_with_fallback (file_info);
 		}
@@ -635,13 +851,55 @@ eog_image_get_file_info (EogImage *img,
 }
 
 #ifdef HAVE_LCMS
+/* Creates the transformation from @profile to @screen for pixels laid
+ * out like those of @pixbuf, or returns %NULL if it isn't supported */
+static cmsHTRANSFORM
+eog_image_create_display_transform (cmsHPROFILE profile,
+				    cmsHPROFILE screen,
+				    GdkPixbuf  *pixbuf)
+{
+	/* TODO: support other colorspaces than RGB */
+	if (cmsGetColorSpace (profile) != cmsSigRgbData ||
+	    cmsGetColorSpace (screen) != cmsSigRgbData) {
+		eog_debug_message (DEBUG_LCMS, "One or both ICC profiles not in RGB colorspace; not correcting");
+		return NULL;
+	}
+
+	cmsUInt32Number color_type = TYPE_RGB_8;
+
+	if (gdk_pixbuf_get_has_alpha (pixbuf))
+		color_type = TYPE_RGBA_8;
+
+	return cmsCreateTransform (profile,
+	                           color_type,
+	                           screen,
+	                           color_type,
+	                           INTENT_PERCEPTUAL,
+	                           0);
+}
+
+static void
+eog_image_transform_pixbuf (cmsHTRANSFORM transform, GdkPixbuf *pixbuf)
+{
+	gint row, width, rows, stride;
+	guchar *p;
+
+	rows = gdk_pixbuf_get_height (pixbuf);
+	width = gdk_pixbuf_get_width (pixbuf);
+	stride = gdk_pixbuf_get_rowstride (pixbuf);
+	p = gdk_pixbuf_get_pixels (pixbuf);
+
+	for (row = 0; row < rows; ++row) {
+		cmsDoTransform (transform, p, p, width);
+		p += stride;
+	}
+}
+
 void
 eog_image_apply_display_profile (EogImage *img, cmsHPROFILE screen)
 {
 	EogImagePrivate *priv;
 	cmsHTRANSFORM transform;
-	gint row, width, rows, stride;
-	guchar *p;
 
 	g_return_if_fail (img != NULL);
 
@@ -678,35 +936,65 @@ eog_image_apply_display_profile (EogImage *img, cmsHPROFILE screen)
 		}
 	}
 
-	/* TODO: support other colorspaces than RGB */
-	if (cmsGetColorSpace (priv->profile) != cmsSigRgbData ||
-	    cmsGetColorSpace (screen) != cmsSigRgbData) {
-		eog_debug_message (DEBUG_LCMS, "One or both ICC profiles not in RGB colorspace; not correcting");
-		return;
+	transform = eog_image_create_display_transform (priv->profile, screen,
+							priv->image);
+
+	if (G_LIKELY (transform != NULL)) {
+		gint64 span = eog_debug_trace_begin ();
+
+		eog_image_transform_pixbuf (transform, priv->image);
+		cmsDeleteTransform (transform);
+
+		eog_debug_trace_end ("Colour transform", span);
 	}
+}
 
-	cmsUInt32Number color_type = TYPE_RGB_8;
+/**
+ * eog_image_apply_display_profile_to_area:
+ * @img: a #EogImage which is being loaded
+ * @area: a copy of a decoded area of the pixbuf returned by
+ *   eog_image_get_partial_pixbuf()
+ * @screen: the display profile
+ *
+ * Converts @area to @screen like eog_image_apply_display_profile() does
+ * with the complete image, so parts of the image can be shown while it
+ * is being loaded. Only the profile found in the image metadata is
+ * known at this point, images without one are taken to be sRGB.
+ **/
+void
+eog_image_apply_display_profile_to_area (EogImage    *img,
+					 GdkPixbuf   *area,
+					 cmsHPROFILE  screen)
+{
+	EogImagePrivate *priv;
+	cmsHPROFILE profile;
+	cmsHTRANSFORM transform;
 
-	if (gdk_pixbuf_get_has_alpha (priv->image))
-		color_type = TYPE_RGBA_8;
+	g_return_if_fail (EOG_IS_IMAGE (img));
+	g_return_if_fail (GDK_IS_PIXBUF (area));
+
+	priv = img->priv;
 
-	transform = cmsCreateTransform (priv->profile,
-	                                color_type,
-	                                screen,
-	                                color_type,
-	                                INTENT_PERCEPTUAL,
-	                                0);
+	if (screen == NULL)
+		return;
 
-	if (G_LIKELY (transform != NULL)) {
-		rows = gdk_pixbuf_get_height (priv->image);
-		width = gdk_pixbuf_get_width (priv->image);
-		stride = gdk_pixbuf_get_rowstride (priv->image);
-		p = gdk_pixbuf_get_pixels (priv->image);
-
-		for (row = 0; row < rows; ++row) {
-			cmsDoTransform (transform, p, p, width);
-			p += stride;
-		}
+	/* The profile is read by the loading thread */
+	g_mutex_lock (&priv->status_mutex);
+
+	if (priv->profile != NULL) {
+		transform = eog_image_create_display_transform (priv->profile,
+								screen, area);
+	} else {
+		profile = cmsCreate_sRGBProfile ();
+		transform = eog_image_create_display_transform (profile,
+								screen, area);
+		cmsCloseProfile (profile);
+	}
+
+	g_mutex_unlock (&priv->status_mutex);
+
+	if (transform != NULL) {
+		eog_image_transform_pixbuf (transform, area);
 		cmsDeleteTransform (transform);
 	}
 }
@@ -715,8 +1003,13 @@ static void
 eog_image_set_icc_data (EogImage *img, EogMetadataReader *md_reader)
 {
 	EogImagePrivate *priv = img->priv;
+	cmsHPROFILE profile;
 
-	priv->profile = eog_metadata_reader_get_icc_profile (md_reader);
+	profile = eog_metadata_reader_get_icc_profile (md_reader);
+
+	g_mutex_lock (&priv->status_mutex);
+	priv->profile = profile;
+	g_mutex_unlock (&priv->status_mutex);
 
 
 }
@@ -779,29 +1072,82 @@ eog_image_set_orientation (EogImage *img)
 	}
 }
 
+/* Transformations turning an image upright, by EXIF orientation */
+static const EogTransformType orientation_transforms[8] = {
+	EOG_TRANSFORM_NONE,
+	EOG_TRANSFORM_FLIP_HORIZONTAL,
+	EOG_TRANSFORM_ROT_180,
+	EOG_TRANSFORM_FLIP_VERTICAL,
+	EOG_TRANSFORM_TRANSPOSE,
+	EOG_TRANSFORM_ROT_90,
+	EOG_TRANSFORM_TRANSVERSE,
+	EOG_TRANSFORM_ROT_270
+};
+
+static EogTransform *
+eog_image_transform_for_orientation (gint orientation)
+{
+	EogTransformType type;
+
+	type = (orientation >= 1 && orientation <= 8 ?
+		orientation_transforms[orientation - 1] : EOG_TRANSFORM_NONE);
+
+	if (type == EOG_TRANSFORM_NONE)
+		return NULL;
+
+	return eog_transform_new (type);
+}
+
+#ifdef HAVE_EXIF
+/*
+ * eog_image_get_orientation_transform:
+ * @img: an #EogImage with its EXIF data loaded
+ *
+ * Returns the transformation that turns @img upright according to its
+ * EXIF orientation, without scheduling it like eog_image_autorotate().
+ *
+ * Returns: a new #EogTransform, or %NULL if none is needed.
+ */
+EogTransform *
+eog_image_get_orientation_transform (EogImage *img)
+{
+	ExifData *exif;
+	gint orientation = 0;
+
+	g_return_val_if_fail (EOG_IS_IMAGE (img), NULL);
+
+	exif = (ExifData*) eog_image_get_exif_info (img);
+
+	if (exif != NULL) {
+		ExifByteOrder o = exif_data_get_byte_order (exif);
+		ExifEntry *entry = exif_data_get_entry (exif,
+							EXIF_TAG_ORIENTATION);
+
+		if (entry && entry->data != NULL) {
+			orientation = exif_get_short (entry->data, o);
+		}
+
+		exif_data_unref (exif);
+	}
+
+	return eog_image_transform_for_orientation (orientation);
+}
+#endif
+
 static void
 eog_image_real_autorotate (EogImage *img)
 {
-	static const EogTransformType lookup[8] = {EOG_TRANSFORM_NONE,
-					     EOG_TRANSFORM_FLIP_HORIZONTAL,
-					     EOG_TRANSFORM_ROT_180,
-					     EOG_TRANSFORM_FLIP_VERTICAL,
-					     EOG_TRANSFORM_TRANSPOSE,
-					     EOG_TRANSFORM_ROT_90,
-					     EOG_TRANSFORM_TRANSVERSE,
-					     EOG_TRANSFORM_ROT_270};
 	EogImagePrivate *priv;
-	EogTransformType type;
+	EogTransform *trans;
 
 	g_return_if_fail (EOG_IS_IMAGE (img));
 
 	priv = img->priv;
 
-	type = (priv->orientation >= 1 && priv->orientation <= 8 ?
-		lookup[priv->orientation - 1] : EOG_TRANSFORM_NONE);
+	trans = eog_image_transform_for_orientation (priv->orientation);
 
-	if (type != EOG_TRANSFORM_NONE) {
-		img->priv->trans_autorotate = eog_transform_new (type);
+	if (trans != NULL) {
+		img->priv->trans_autorotate = trans;
 	}
 
 	/* Disable auto orientation for next loads */
@@ -813,6 +1159,10 @@ eog_image_autorotate (EogImage *img)
 {
 	g_return_if_fail (EOG_IS_IMAGE (img));
 
+	/* Preloaded images may have been oriented already */
+	if (img->priv->trans_autorotate != NULL)
+		return;
+
 	/* Schedule auto orientation */
 	img->priv->autorotate = TRUE;
 }
@@ -939,6 +1289,16 @@ eog_image_new_pixbuf_loader (EogImage 	*img,
 				G_CALLBACK (eog_image_size_prepared),
 				img,
 				0);
+		g_signal_connect_object (G_OBJECT (loader),
+				"area-prepared",
+				G_CALLBACK (eog_image_area_prepared),
+				img,
+				0);
+		g_signal_connect_object (G_OBJECT (loader),
+				"area-updated",
+				G_CALLBACK (eog_image_area_updated),
+				img,
+				0);
 	}
 	return loader;
 }
@@ -958,6 +1318,69 @@ eog_image_update_stream (EogImage	   *img,
 	return success;
 }
 
+static gboolean
+eog_image_get_dimension_from_index (EogImage *img)
+{
+	EogImagePrivate *priv = img->priv;
+	EogMetadataRecord record;
+	gboolean found;
+
+	if (priv->mtime == 0)
+		return FALSE;
+
+	if (!eog_metadata_index_lookup (priv->file, priv->mtime,
+					priv->bytes, &record))
+		return FALSE;
+
+	found = (record.fields & EOG_METADATA_RECORD_DIMENSION) &&
+		record.width > 0 && record.height > 0;
+
+	if (found) {
+		g_mutex_lock (&priv->status_mutex);
+		priv->width = record.width;
+		priv->height = record.height;
+		g_mutex_unlock (&priv->status_mutex);
+	}
+
+	eog_metadata_record_clear (&record);
+
+	return found;
+}
+
+static void
+eog_image_update_metadata_index (EogImage *img,
+				 EogMetadataRecordFields fields)
+{
+	EogImagePrivate *priv = img->priv;
+	EogMetadataRecord record = { 0, };
+
+	if (priv->mtime == 0)
+		return;
+
+	if ((fields & EOG_METADATA_RECORD_DIMENSION) &&
+	    priv->width > 0 && priv->height > 0) {
+		record.fields |= EOG_METADATA_RECORD_DIMENSION;
+		record.width = priv->width;
+		record.height = priv->height;
+	}
+
+#ifdef HAVE_EXIF
+	if ((fields & EOG_METADATA_RECORD_EXIF) && priv->exif != NULL) {
+		eog_metadata_record_set_exif (&record, priv->exif);
+
+#ifdef HAVE_LCMS
+		record.has_icc_profile = (priv->profile != NULL);
+#endif
+	}
+#endif
+
+	if (record.fields != 0)
+		eog_metadata_index_store (priv->file, priv->mtime,
+					  priv->bytes, &record);
+
+	eog_metadata_record_clear (&record);
+}
+
 static gboolean
 eog_image_real_load (EogImage     *img,
 		     EogImageData  data2read,
@@ -979,6 +1402,7 @@ eog_image_real_load (EogImage     *img,
 	gboolean read_image_data = (data2read & EOG_IMAGE_DATA_IMAGE);
 	gboolean read_only_dimension = (data2read & EOG_IMAGE_DATA_DIMENSION) &&
 				  ((data2read ^ EOG_IMAGE_DATA_DIMENSION) == 0);
+	gsize read_size;
 
 
 	priv = img->priv;
@@ -990,13 +1414,25 @@ eog_image_real_load (EogImage     *img,
 		priv->file_type = NULL;
 	}
 
-	eog_image_get_file_info (img, &priv->bytes, &mime_type, error);
+	eog_image_get_file_info (img, &priv->bytes, &priv->mtime,
+				 &mime_type, error);
 
 	if (error && *error) {
 		g_free (mime_type);
 		return FALSE;
 	}
 
+	/* Dimensions remembered from a previous session */
+	if ((data2read & EOG_IMAGE_DATA_DIMENSION) && !read_image_data &&
+	    eog_image_get_dimension_from_index (img)) {
+		if (read_only_dimension) {
+			g_free (mime_type);
+			return TRUE;
+		}
+
+		data2read &= ~EOG_IMAGE_DATA_DIMENSION;
+	}
+
 	if (read_only_dimension) {
 		gint width, height;
 		gboolean done;
@@ -1029,10 +1465,56 @@ eog_image_real_load (EogImage     *img,
 		return FALSE;
 	}
 
+	/* Parse the headers directly when only the dimensions are
+	 * needed, the pixbuf loader is the fallback for other formats */
+	if ((data2read & EOG_IMAGE_DATA_DIMENSION) && !read_image_data &&
+	    eog_dimension_probe_supports_mime_type (mime_type)) {
+		gint width, height;
+
+		if (eog_dimension_probe (G_INPUT_STREAM (input_stream),
+					 &width, &height, NULL)) {
+			g_mutex_lock (&priv->status_mutex);
+			priv->width = width;
+			priv->height = height;
+			g_mutex_unlock (&priv->status_mutex);
+
+			eog_image_update_metadata_index (img,
+							 EOG_METADATA_RECORD_DIMENSION);
+
+			if (read_only_dimension) {
+				g_free (mime_type);
+				g_object_unref (input_stream);
+				return TRUE;
+			}
+
+			/* Don't fall back to the loader below */
+			data2read &= ~EOG_IMAGE_DATA_DIMENSION;
+		}
+
+		if (!g_seekable_seek (G_SEEKABLE (input_stream),
+				      0, G_SEEK_SET, NULL, NULL)) {
+			g_object_unref (input_stream);
+			input_stream = g_file_read (priv->file, NULL, NULL);
+
+			if (input_stream == NULL) {
+				g_free (mime_type);
+				g_set_error (error,
+					     EOG_IMAGE_ERROR,
+					     EOG_IMAGE_ERROR_VFS,
+					     "Failed to open input stream for file");
+				return FALSE;
+			}
+		}
+	}
+
 	buffer = g_new0 (guchar, EOG_IMAGE_READ_BUFFER_SIZE);
 
-	if (read_image_data || read_only_dimension)
+	if (read_image_data || read_only_dimension) {
 		loader = eog_image_new_pixbuf_loader (img, &use_rsvg, mime_type, error);
+		read_size = EOG_IMAGE_READ_BUFFER_SIZE;
+	} else {
+		read_size = EOG_IMAGE_METADATA_READ_SIZE;
+	}
 
 	while (!priv->cancel_loading) {
 #ifdef HAVE_RSVG
@@ -1072,7 +1554,7 @@ eog_image_real_load (EogImage     *img,
 			/* FIXME: make this async */
 			bytes_read = g_input_stream_read (G_INPUT_STREAM (input_stream),
 							  buffer,
-							  EOG_IMAGE_READ_BUFFER_SIZE,
+							  read_size,
 							  NULL, error);
 
 			if (bytes_read == 0) {
@@ -1143,6 +1625,10 @@ eog_image_real_load (EogImage     *img,
 				}
 
 				priv->metadata_status = EOG_IMAGE_METADATA_NOT_AVAILABLE;
+
+				/* Nobody is interested in the rest */
+				if (!read_image_data && !read_only_dimension)
+					break;
 			}
 
 			first_run = FALSE;
@@ -1166,8 +1652,18 @@ eog_image_real_load (EogImage     *img,
 					priv->metadata_status = EOG_IMAGE_METADATA_READY;
 				}
 
-				if (data2read == EOG_IMAGE_DATA_EXIF)
+				/* The rest of the file is only
+				 * of interest to the loader */
+				if (!read_image_data && !read_only_dimension)
 					break;
+			} else if (!read_image_data && !read_only_dimension) {
+				/* Nothing else looks at the data, so jump over
+				 * what the reader would discard, e.g. the IDAT
+				 * chunks of a PNG. */
+				bytes_read_total +=
+					eog_metadata_reader_seek_ahead (md_reader,
+									G_INPUT_STREAM (input_stream),
+									NULL);
 			}
 		}
 
@@ -1191,6 +1687,11 @@ eog_image_real_load (EogImage     *img,
 		}
 	}
 
+	/* Partial updates end here, the final image replaces them */
+	g_mutex_lock (&priv->status_mutex);
+	g_clear_object (&priv->partial);
+	g_mutex_unlock (&priv->status_mutex);
+
 	g_free (mime_type);
 	g_free (buffer);
 
@@ -1276,6 +1777,18 @@ eog_image_real_load (EogImage     *img,
 		md_reader = NULL;
 	}
 
+	if (!failed) {
+		EogMetadataRecordFields fields = 0;
+
+		if (eog_image_has_data (img, EOG_IMAGE_DATA_DIMENSION))
+			fields |= EOG_METADATA_RECORD_DIMENSION;
+
+		if (!set_metadata)
+			fields |= EOG_METADATA_RECORD_EXIF;
+
+		eog_image_update_metadata_index (img, fields);
+	}
+
 	/* Catch-all in case of poor-error reporting */
 	if (failed && error && *error == NULL) {
 		g_set_error (error,
@@ -1337,6 +1850,7 @@ eog_image_load (EogImage *img, EogImageData data2read, EogJob *job, GError **err
 {
 	EogImagePrivate *priv;
 	gboolean success = FALSE;
+	gint64 span;
 
 	eog_debug (DEBUG_IMAGE_LOAD);
 
@@ -1354,8 +1868,10 @@ eog_image_load (EogImage *img, EogImageData data2read, EogJob *job, GError **err
 
 	priv->status = EOG_IMAGE_STATUS_LOADING;
 
+	span = eog_debug_trace_begin ();
 	success = eog_image_real_load (img, data2read, job, error);
-
+	eog_debug_trace_end (data2read & EOG_IMAGE_DATA_IMAGE ?
+			     "Image decode" : "Image metadata", span);
 
 	/* Check that the metadata was loaded at least once before
 	 * trying to autorotate. Also only an image load job should try to
@@ -1445,6 +1961,37 @@ eog_image_get_pixbuf (EogImage *img)
 	return image;
 }
 
+/**
+ * eog_image_get_partial_pixbuf:
+ * @img: a #EogImage
+ * @decoded: (out) (optional): return location for the part of the pixbuf
+ *   which has been decoded so far
+ *
+ * Gets the pixbuf the loader is decoding the image into, while it is
+ * still incomplete. The pixbuf keeps being written to from the loading
+ * thread, see #EogImage::area-updated for when new parts are available.
+ * Anything outside of @decoded is undefined.
+ *
+ * Returns: (transfer full) (nullable): a #GdkPixbuf, or %NULL if @img is
+ * not being loaded
+ **/
+GdkPixbuf *
+eog_image_get_partial_pixbuf (EogImage *img, GdkRectangle *decoded)
+{
+	GdkPixbuf *partial = NULL;
+
+	g_return_val_if_fail (EOG_IS_IMAGE (img), NULL);
+
+	g_mutex_lock (&img->priv->status_mutex);
+	if (img->priv->partial != NULL)
+		partial = g_object_ref (img->priv->partial);
+	if (decoded != NULL)
+		*decoded = img->priv->partial_decoded;
+	g_mutex_unlock (&img->priv->status_mutex);
+
+	return partial;
+}
+
 #ifdef HAVE_LCMS
 cmsHPROFILE
 eog_image_get_profile (EogImage *img)
@@ -1526,26 +2073,6 @@ eog_image_undo (EogImage *img)
 	priv->modified = (priv->undo_stack != NULL);
 }
 
-static GFile *
-tmp_file_get (void)
-{
-	GFile *tmp_file;
-	char *tmp_file_path;
-	gint fd;
-
-	tmp_file_path = g_build_filename (g_get_tmp_dir (), "eog-save-XXXXXX", NULL);
-	fd = g_mkstemp (tmp_file_path);
-	if (fd == -1) {
-		g_free (tmp_file_path);
-		return NULL;
-	}
-	else {
-		tmp_file = g_file_new_for_path (tmp_file_path);
-		g_free (tmp_file_path);
-		return tmp_file;
-	}
-}
-
 static void
 transfer_progress_cb (goffset cur_bytes,
 		      goffset total_bytes,
@@ -1561,134 +2088,25 @@ transfer_progress_cb (goffset cur_bytes,
 	}
 }
 
-static void
-tmp_file_restore_unix_attributes (GFile *temp_file,
-				  GFile *target_file)
+/* Opens @file for writing the saved image. An existing local file is
+ * replaced atomically: GIO writes to a temporary file in the same
+ * directory, with the original owner and mode, and renames it over
+ * @file once the stream is closed. Remote locations are streamed to
+ * directly. */
+static GOutputStream *
+eog_image_open_output (GFile *file, gboolean overwrite, GError **error)
 {
-	GFileInfo *file_info;
-	guint      uid;
-	guint      gid;
-	guint      mode;
-	guint      mode_mask = 00600;
-
-	GError    *error = NULL;
-
-	g_return_if_fail (G_IS_FILE (temp_file));
-	g_return_if_fail (G_IS_FILE (target_file));
-
-	/* check if file exists */
-	if (!g_file_query_exists (target_file, NULL)) {
-		eog_debug_message (DEBUG_IMAGE_SAVE,
-				   "Target file doesn't exist. Setting default attributes.");
-		return;
-	}
-
-	/* retrieve UID, GID, and MODE of the original file info */
-	file_info = g_file_query_info (target_file,
-				       "unix::uid,unix::gid,unix::mode",
-				       G_FILE_QUERY_INFO_NONE,
-				       NULL,
-				       &error);
-
-	/* check that there aren't any error */
-	if (error != NULL) {
-		eog_debug_message (DEBUG_IMAGE_SAVE,
-				   "File information not available. Setting default attributes.");
-
-		/* free objects */
-		g_object_unref (file_info);
-		g_clear_error (&error);
-
-		return;
-	}
-
-	/* save UID, GID and MODE values */
-	uid = g_file_info_get_attribute_uint32 (file_info,
-						G_FILE_ATTRIBUTE_UNIX_UID);
-
-	gid = g_file_info_get_attribute_uint32 (file_info,
-						G_FILE_ATTRIBUTE_UNIX_GID);
-
-	mode = g_file_info_get_attribute_uint32 (file_info,
-						 G_FILE_ATTRIBUTE_UNIX_MODE);
-
-	/* apply default mode mask to file mode */
-	mode |= mode_mask;
-
-	/* restore original UID, GID, and MODE into the temporal file */
-	g_file_set_attribute_uint32 (temp_file,
-				     G_FILE_ATTRIBUTE_UNIX_UID,
-				     uid,
-				     G_FILE_QUERY_INFO_NONE,
-				     NULL,
-				     &error);
-
-	/* check that there aren't any error */
-	if (error != NULL) {
-		eog_debug_message (DEBUG_IMAGE_SAVE,
-				   "You do not have the permissions necessary to change the file UID.");
-
-		g_clear_error (&error);
-	}
-
-	g_file_set_attribute_uint32 (temp_file,
-				     G_FILE_ATTRIBUTE_UNIX_GID,
-				     gid,
-				     G_FILE_QUERY_INFO_NONE,
-				     NULL,
-				     &error);
-
-	/* check that there aren't any error */
-	if (error != NULL) {
-		eog_debug_message (DEBUG_IMAGE_SAVE,
-				   "You do not have the permissions necessary to change the file GID. Setting user default GID.");
-
-		g_clear_error (&error);
-	}
-
-	g_file_set_attribute_uint32 (temp_file,
-				     G_FILE_ATTRIBUTE_UNIX_MODE,
-				     mode,
-				     G_FILE_QUERY_INFO_NONE,
-				     NULL,
-				     &error);
-
-	/* check that there aren't any error */
-	if (error != NULL) {
-		eog_debug_message (DEBUG_IMAGE_SAVE,
-				   "You do not have the permissions necessary to change the file MODE.");
-
-		g_clear_error (&error);
-	}
-
-	/* free objects */
-	g_object_unref (file_info);
-}
-
-static gboolean
-tmp_file_move_to_uri (EogImage *image,
-		      GFile *tmpfile,
-		      GFile *file,
-		      gboolean overwrite,
-		      GError **error)
-{
-	gboolean result;
+	GFileOutputStream *stream;
 	GError *ioerror = NULL;
 
-	/* try to restore target file unix attributes */
-	tmp_file_restore_unix_attributes (tmpfile, file);
-
-	/* replace target file with temporal file */
-	result = g_file_move (tmpfile,
-			      file,
-			      (overwrite ? G_FILE_COPY_OVERWRITE : 0) |
-			      G_FILE_COPY_ALL_METADATA,
-			      NULL,
-			      (GFileProgressCallback) transfer_progress_cb,
-			      image,
-			      &ioerror);
+	if (overwrite) {
+		stream = g_file_replace (file, NULL, FALSE,
+					 G_FILE_CREATE_NONE, NULL, &ioerror);
+	} else {
+		stream = g_file_create (file, G_FILE_CREATE_NONE, NULL, &ioerror);
+	}
 
-	if (result == FALSE) {
+	if (stream == NULL) {
 		if (g_error_matches (ioerror, G_IO_ERROR,
 				     G_IO_ERROR_EXISTS)) {
 			g_set_error (error, EOG_IMAGE_ERROR,
@@ -1697,38 +2115,66 @@ tmp_file_move_to_uri (EogImage *image,
 		} else {
 			g_set_error (error, EOG_IMAGE_ERROR,
 				     EOG_IMAGE_ERROR_VFS,
-				     "VFS error moving the temp file");
+				     "%s", ioerror->message);
 		}
 		g_clear_error (&ioerror);
 	}
 
-	return result;
+	return G_OUTPUT_STREAM (stream);
 }
 
+/* Closes @stream, committing the saved image on @success. Otherwise the
+ * close is cancelled, which leaves a replaced file untouched, and a file
+ * that didn't exist before is removed again. */
 static gboolean
-tmp_file_delete (GFile *tmpfile)
+eog_image_close_output (GOutputStream *stream,
+			GFile         *file,
+			gboolean       existed,
+			gboolean       success,
+			GError       **error)
 {
-	gboolean result;
-	GError *err = NULL;
+	GError *ioerror = NULL;
 
-	if (tmpfile == NULL) return FALSE;
+	if (success) {
+		success = g_output_stream_close (stream, NULL, &ioerror);
 
-	result = g_file_delete (tmpfile, NULL, &err);
-	if (result == FALSE) {
-		char *tmpfile_path;
-		if (err != NULL) {
-			if (err->code == G_IO_ERROR_NOT_FOUND) {
-				g_error_free (err);
-				return TRUE;
-			}
-			g_error_free (err);
+		if (!success) {
+			g_set_error (error, EOG_IMAGE_ERROR,
+				     EOG_IMAGE_ERROR_VFS,
+				     "%s", ioerror->message);
+			g_clear_error (&ioerror);
 		}
-		tmpfile_path = g_file_get_path (tmpfile);
-		g_warning ("Couldn't delete temporary file: %s", tmpfile_path);
-		g_free (tmpfile_path);
+	} else {
+		GCancellable *cancellable = g_cancellable_new ();
+
+		g_cancellable_cancel (cancellable);
+		g_output_stream_close (stream, cancellable, NULL);
+		g_object_unref (cancellable);
 	}
 
-	return result;
+	if (!success && !existed) {
+		g_file_delete (file, NULL, NULL);
+	}
+
+	g_object_unref (stream);
+
+	return success;
+}
+
+/* Throws away what a failed attempt wrote to *@stream and replaces it
+ * with a new stream, so the next attempt starts from an empty file */
+static gboolean
+eog_image_restart_output (GOutputStream **stream,
+			  GFile          *file,
+			  gboolean        overwrite,
+			  gboolean        existed,
+			  GError        **error)
+{
+	eog_image_close_output (*stream, file, existed, FALSE, NULL);
+
+	*stream = eog_image_open_output (file, overwrite, error);
+
+	return *stream != NULL;
 }
 
 static void
@@ -1850,14 +2296,128 @@ check_if_file_is_writable (GFile *file)
 	return is_writable;
 }
 
+/**
+ * eog_image_detect_file_type:
+ * @img: a #EogImage
+ *
+ * Only a full load sets the file type of @img. Without one, this tells
+ * JPEG files from their content, which eog_image_can_save_lossless() and
+ * the lossless save itself rely on. It may read from the file.
+ **/
+void
+eog_image_detect_file_type (EogImage *img)
+{
+	EogImagePrivate *priv;
+	gchar *mime_type = NULL;
+
+	g_return_if_fail (EOG_IS_IMAGE (img));
+
+	priv = img->priv;
+
+	if (priv->file_type != NULL)
+		return;
+
+	eog_image_get_file_info (img, NULL, NULL, &mime_type, NULL);
+
+	if (mime_type != NULL &&
+	    g_content_type_equals (mime_type, "image/jpeg"))
+		priv->file_type = g_strdup (EOG_FILE_FORMAT_JPEG);
+
+	g_free (mime_type);
+}
+
+/**
+ * eog_image_can_save_lossless:
+ * @img: a #EogImage
+ * @target: (allow-none): the #EogImageSaveInfo to save to, or %NULL to save
+ * @img in place
+ *
+ * Checks whether saving @img only requires a lossless transformation of its
+ * JPEG file. In that case the image is saved from its DCT coefficients and
+ * its pixel data doesn't need to be loaded, only its metadata.
+ *
+ * Images whose pixels weren't loaded need eog_image_detect_file_type()
+ * first.
+ *
+ * Returns: %TRUE if @img can be saved without decoding it
+ **/
+gboolean
+eog_image_can_save_lossless (EogImage *img, EogImageSaveInfo *target)
+{
+#ifdef HAVE_JPEG
+	EogImagePrivate *priv;
+
+	g_return_val_if_fail (EOG_IS_IMAGE (img), FALSE);
+
+	priv = img->priv;
+
+	if (priv->file_type == NULL ||
+	    g_ascii_strcasecmp (priv->file_type, EOG_FILE_FORMAT_JPEG) != 0)
+		return FALSE;
+
+#ifndef HAVE_EXIF
+	/* The automatic orientation is only known after a full load */
+	if (priv->autorotate)
+		return FALSE;
+#endif
+
+	/* Re-encoding with a given quality needs the pixels */
+	if (target != NULL &&
+	    (target->format == NULL ||
+	     g_ascii_strcasecmp (target->format, EOG_FILE_FORMAT_JPEG) != 0 ||
+	     target->jpeg_quality >= 0.0))
+		return FALSE;
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/* Without decoded pixels the automatic orientation hasn't been applied
+ * yet, it becomes part of the lossless transformation instead. The
+ * orientation comes from the EXIF data loaded for the save. */
+static void
+eog_image_autorotate_lossless (EogImage *img)
+{
+#ifdef HAVE_EXIF
+	EogImagePrivate *priv = img->priv;
+
+	if (priv->image != NULL || !priv->autorotate)
+		return;
+
+	if (priv->trans_autorotate == NULL)
+		priv->trans_autorotate = eog_image_get_orientation_transform (img);
+
+	/* Disable auto orientation for next loads */
+	priv->autorotate = FALSE;
+#endif
+}
+
+static gboolean
+eog_image_save_pixbuf (EogImage *img, GOutputStream *stream, const char *format, GError **error)
+{
+	/* Only a lossless JPEG save is possible without the pixel data */
+	if (img->priv->image == NULL) {
+		g_set_error (error, EOG_IMAGE_ERROR,
+			     EOG_IMAGE_ERROR_NOT_LOADED,
+			     _("No image loaded."));
+		return FALSE;
+	}
+
+	return gdk_pixbuf_save_to_stream (img->priv->image, stream, format,
+					  NULL, error, NULL);
+}
+
 gboolean
 eog_image_save_by_info (EogImage *img, EogImageSaveInfo *source, GError **error)
 {
 	EogImagePrivate *priv;
 	EogImageStatus prev_status;
 	gboolean success = FALSE;
-	GFile *tmp_file;
-	char *tmp_file_path;
+	gboolean save_jpeg = FALSE;
+	GInputStream *source_stream = NULL;
+	GOutputStream *stream;
 
 	g_return_val_if_fail (EOG_IS_IMAGE (img), FALSE);
 	g_return_val_if_fail (EOG_IS_IMAGE_SAVE_INFO (source), FALSE);
@@ -1875,7 +2435,7 @@ eog_image_save_by_info (EogImage *img, EogImageSaveInfo *source, GError **error)
 	}
 
 	/* fail if there is no image to save */
-	if (priv->image == NULL) {
+	if (priv->image == NULL && !eog_image_can_save_lossless (img, NULL)) {
 		g_set_error (error, EOG_IMAGE_ERROR,
 			     EOG_IMAGE_ERROR_NOT_LOADED,
 			     _("No image loaded."));
@@ -1890,45 +2450,61 @@ eog_image_save_by_info (EogImage *img, EogImageSaveInfo *source, GError **error)
 		return FALSE;
 	}
 
-	/* generate temporary file */
-	tmp_file = tmp_file_get ();
+#ifdef HAVE_JPEG
+	/* determine kind of saving */
+	save_jpeg = (g_ascii_strcasecmp (source->format, EOG_FILE_FORMAT_JPEG) == 0 &&
+		     source->exists && source->modified);
 
-	if (tmp_file == NULL) {
-		g_set_error (error, EOG_IMAGE_ERROR,
-			     EOG_IMAGE_ERROR_TMP_FILE_FAILED,
-			     _("Temporary file creation failed."));
+	/* Opening the output may already truncate the file */
+	if (save_jpeg) {
+		source_stream = eog_image_jpeg_open_source (priv->file, TRUE, error);
+
+		if (source_stream == NULL) {
+			priv->status = prev_status;
+			return FALSE;
+		}
+	}
+#endif
+
+	stream = eog_image_open_output (priv->file, TRUE, error);
+
+	if (stream == NULL) {
+		g_clear_object (&source_stream);
+		priv->status = prev_status;
 		return FALSE;
 	}
 
-	tmp_file_path = g_file_get_path (tmp_file);
+	eog_image_autorotate_lossless (img);
 
 #ifdef HAVE_JPEG
-	/* determine kind of saving */
-	if ((g_ascii_strcasecmp (source->format, EOG_FILE_FORMAT_JPEG) == 0) &&
-	    source->exists && source->modified)
-	{
-		success = eog_image_jpeg_save_file (img, tmp_file_path, source, NULL, error);
+	if (save_jpeg) {
+		success = eog_image_jpeg_save_file (img, source_stream, stream,
+						    source, NULL, error);
+
+		/* Only start over if there are pixels to save instead */
+		if (!success && (*error == NULL) && priv->image != NULL &&
+		    !eog_image_restart_output (&stream, priv->file, TRUE,
+					       source->exists, error)) {
+			g_clear_object (&source_stream);
+			priv->status = prev_status;
+			return FALSE;
+		}
 	}
 #endif
 
+	g_clear_object (&source_stream);
+
 	if (!success && (*error == NULL)) {
-		success = gdk_pixbuf_save (priv->image, tmp_file_path, source->format, error, NULL);
+		success = eog_image_save_pixbuf (img, stream, source->format, error);
 	}
 
-	if (success) {
-		/* try to move result file to target uri */
-		success = tmp_file_move_to_uri (img, tmp_file, priv->file, TRUE /*overwrite*/, error);
-	}
+	success = eog_image_close_output (stream, priv->file,
+					  source->exists, success, error);
 
 	if (success) {
 		eog_image_reset_modifications (img);
 	}
 
-	tmp_file_delete (tmp_file);
-
-	g_free (tmp_file_path);
-	g_object_unref (tmp_file);
-
 	priv->status = prev_status;
 
 	return success;
@@ -1983,9 +2559,8 @@ eog_image_save_as_by_info (EogImage *img, EogImageSaveInfo *source, EogImageSave
 {
 	EogImagePrivate *priv;
 	gboolean success = FALSE;
-	char *tmp_file_path;
-	GFile *tmp_file;
-	gboolean direct_copy = FALSE;
+	GInputStream *source_stream = NULL;
+	GOutputStream *stream = NULL;
 
 	g_return_val_if_fail (EOG_IS_IMAGE (img), FALSE);
 	g_return_val_if_fail (EOG_IS_IMAGE_SAVE_INFO (source), FALSE);
@@ -1994,7 +2569,7 @@ eog_image_save_as_by_info (EogImage *img, EogImageSaveInfo *source, EogImageSave
 	priv = img->priv;
 
 	/* fail if there is no image to save */
-	if (priv->image == NULL) {
+	if (priv->image == NULL && !eog_image_can_save_lossless (img, target)) {
 		g_set_error (error,
 			     EOG_IMAGE_ERROR,
 			     EOG_IMAGE_ERROR_NOT_LOADED,
@@ -2011,40 +2586,62 @@ eog_image_save_as_by_info (EogImage *img, EogImageSaveInfo *source, EogImageSave
 		return FALSE;
 	}
 
-	/* generate temporary file name */
-	tmp_file = tmp_file_get ();
-
-	if (tmp_file == NULL) {
-		g_set_error (error,
-			     EOG_IMAGE_ERROR,
-			     EOG_IMAGE_ERROR_TMP_FILE_FAILED,
-			     _("Temporary file creation failed."));
-
-		return FALSE;
-	}
-	tmp_file_path = g_file_get_path (tmp_file);
-
 	/* determine kind of saving */
 	if (g_ascii_strcasecmp (source->format, target->format) == 0 && !source->modified) {
 		success = eog_image_copy_file (img, source, target, error);
-		direct_copy = success;
-	}
+	} else {
+#ifdef HAVE_JPEG
+		/* A lossless transformation reads the source file, which
+		 * opening the output truncates if both are the same */
+		if (g_ascii_strcasecmp (source->format, EOG_FILE_FORMAT_JPEG) == 0 &&
+		    g_ascii_strcasecmp (target->format, EOG_FILE_FORMAT_JPEG) == 0 &&
+		    source->exists && target->jpeg_quality < 0.0) {
+			source_stream = eog_image_jpeg_open_source (priv->file,
+								    g_file_equal (target->file,
+										  priv->file),
+								    error);
+		}
+
+		if (source_stream != NULL || *error == NULL)
+#endif
+			stream = eog_image_open_output (target->file,
+							target->overwrite,
+							error);
+
+		if (stream != NULL) {
+			eog_image_autorotate_lossless (img);
 
 #ifdef HAVE_JPEG
-	else if ((g_ascii_strcasecmp (source->format, EOG_FILE_FORMAT_JPEG) == 0 && source->exists) ||
-		 (g_ascii_strcasecmp (target->format, EOG_FILE_FORMAT_JPEG) == 0))
-	{
-		success = eog_image_jpeg_save_file (img, tmp_file_path, source, target, error);
-	}
+			if ((g_ascii_strcasecmp (source->format, EOG_FILE_FORMAT_JPEG) == 0 && source->exists) ||
+			    (g_ascii_strcasecmp (target->format, EOG_FILE_FORMAT_JPEG) == 0))
+			{
+				success = eog_image_jpeg_save_file (img, source_stream,
+								    stream, source,
+								    target, error);
+
+				/* Only start over if there are pixels to save instead */
+				if (!success && (*error == NULL) && priv->image != NULL)
+					eog_image_restart_output (&stream, target->file,
+								  target->overwrite,
+								  target->exists, error);
+			}
 #endif
 
-	if (!success && (*error == NULL)) {
-		success = gdk_pixbuf_save (priv->image, tmp_file_path, target->format, error, NULL);
-	}
+			/* NULL if restarting the output failed */
+			if (stream != NULL) {
+				if (!success && (*error == NULL)) {
+					success = eog_image_save_pixbuf (img, stream,
+									 target->format,
+									 error);
+				}
 
-	if (success && !direct_copy) { /* not required if we already copied the file directly */
-		/* try to move result file to target uri */
-		success = tmp_file_move_to_uri (img, tmp_file, target->file, target->overwrite, error);
+				success = eog_image_close_output (stream, target->file,
+								  target->exists,
+								  success, error);
+			}
+		}
+
+		g_clear_object (&source_stream);
 	}
 
 	if (success) {
@@ -2053,10 +2650,6 @@ eog_image_save_as_by_info (EogImage *img, EogImageSaveInfo *source, EogImageSave
 		eog_image_link_with_target (img, target);
 	}
 
-	tmp_file_delete (tmp_file);
-	g_object_unref (tmp_file);
-	g_free (tmp_file_path);
-
 	priv->status = EOG_IMAGE_STATUS_UNKNOWN;
 
 	return success;
@@ -111,6 +111,12 @@ struct _EogImageClass {
 				    gint delay);
 
 	void (* file_changed)      (EogImage *img);
+
+	void (* area_updated)      (EogImage *img,
+				    gint      x,
+				    gint      y,
+				    gint      width,
+				    gint      height);
 };
 
 GType	          eog_image_get_type	             (void) G_GNUC_CONST;
@@ -145,8 +151,18 @@ gboolean          eog_image_save_by_info             (EogImage   *img,
 					              EogImageSaveInfo *source,
 					              GError    **error);
 
+G_GNUC_INTERNAL
+void              eog_image_detect_file_type         (EogImage   *img);
+
+G_GNUC_INTERNAL
+gboolean          eog_image_can_save_lossless        (EogImage   *img,
+					              EogImageSaveInfo *target);
+
 GdkPixbuf*        eog_image_get_pixbuf               (EogImage   *img);
 
+GdkPixbuf*        eog_image_get_partial_pixbuf       (EogImage   *img,
+						      GdkRectangle *decoded);
+
 GdkPixbuf*        eog_image_get_thumbnail            (EogImage   *img);
 
 void              eog_image_get_size                 (EogImage   *img,
@@ -192,6 +208,10 @@ cmsHPROFILE       eog_image_get_profile              (EogImage    *img);
 
 void              eog_image_apply_display_profile    (EogImage    *img,
 						      cmsHPROFILE  display_profile);
+
+void              eog_image_apply_display_profile_to_area (EogImage    *img,
+							   GdkPixbuf   *area,
+							   cmsHPROFILE  display_profile);
 #endif
 
 void              eog_image_undo                     (EogImage   *img);
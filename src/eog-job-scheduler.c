@@ -35,11 +35,13 @@ static GMutex job_queue_mutex;
 static GQueue queue_high   = G_QUEUE_INIT;
 static GQueue queue_medium = G_QUEUE_INIT;
 static GQueue queue_low    = G_QUEUE_INIT;
+static GQueue queue_idle   = G_QUEUE_INIT;
 
 static GQueue *job_queue[EOG_JOB_N_PRIORITIES] = {
 	&queue_high,
 	&queue_medium,
-	&queue_low
+	&queue_low,
+	&queue_idle
 };
 
 static void      eog_job_scheduler_enqueue_job (EogJob         *job,
@@ -137,6 +139,8 @@ eog_job_scheduler (gpointer data)
 static void
 eog_job_process (EogJob *job)
 {
+	gint64 span;
+
 	g_return_if_fail (EOG_IS_JOB (job));
 
 	/* nothing to do if job was cancelled */
@@ -150,15 +154,35 @@ eog_job_process (EogJob *job)
 			   job);
 
 	/* process the current job */
+	span = eog_debug_trace_begin ();
 	eog_job_run (job);
+	eog_debug_trace_end (EOG_GET_TYPE_NAME (job), span);
 }
 
 void
 eog_job_scheduler_init ()
 {
-	g_thread_new ("EogJobScheduler",
-		      eog_job_scheduler,
-		      NULL);
+	eog_job_scheduler_init_with_threads (1);
+}
+
+/* With more than one worker, jobs run concurrently and may finish out
+ * of order. The viewer relies on jobs running one after another, so
+ * this is only used for headless batch processing. */
+void
+eog_job_scheduler_init_with_threads (guint n_threads)
+{
+	guint i;
+
+	g_return_if_fail (n_threads > 0);
+
+	for (i = 0; i < n_threads; i++) {
+		GThread *thread;
+
+		thread = g_thread_new ("EogJobScheduler",
+				       eog_job_scheduler,
+				       NULL);
+		g_thread_unref (thread);
+	}
 }
 
 void
@@ -169,6 +193,8 @@ eog_job_scheduler_add_job (EogJob *job)
 	/* make sure the job isn't destroyed */
 	g_object_ref (job);
 
+	job->priority = EOG_JOB_PRIORITY_LOW;
+
 	/* enqueue the job */
 	eog_job_scheduler_enqueue_job (job, EOG_JOB_PRIORITY_LOW);
 }
@@ -182,6 +208,8 @@ eog_job_scheduler_add_job_with_priority (EogJob         *job,
 	/* make sure the job isn't destroyed */
 	g_object_ref (job);
 
+	job->priority = priority;
+
 	/* enqueue the job */
 	eog_job_scheduler_enqueue_job (job, priority);
 }
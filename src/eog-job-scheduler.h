@@ -28,15 +28,9 @@
 
 G_BEGIN_DECLS
 
-typedef enum {
-	EOG_JOB_PRIORITY_HIGH,
-	EOG_JOB_PRIORITY_MEDIUM,
-	EOG_JOB_PRIORITY_LOW,
-	EOG_JOB_N_PRIORITIES
-} EogJobPriority;
-
 /* initialization */
 void eog_job_scheduler_init                  (void);
+void eog_job_scheduler_init_with_threads     (guint           n_threads);
 
 /* jobs management */
 void eog_job_scheduler_add_job               (EogJob         *job);
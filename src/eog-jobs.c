@@ -22,6 +22,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* for copy_file_range () */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "eog-debug.h"
 #include "eog-jobs.h"
 #include "eog-thumbnail.h"
@@ -29,6 +38,19 @@
 #include "eog-util.h"
 
 #include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#if defined(HAVE_FICLONE) || defined(HAVE_COPY_FILE_RANGE)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FICLONE
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 G_DEFINE_ABSTRACT_TYPE (EogJob, eog_job, G_TYPE_OBJECT);
 G_DEFINE_TYPE (EogJobCopy,      eog_job_copy,      EOG_TYPE_JOB);
@@ -106,6 +128,45 @@ static void eog_job_save_progress_callback (EogImage *image,
 					    gfloat    progress,
 					    gpointer  data);
 
+/* Maximum number of files copied at the same time */
+#define EOG_JOB_COPY_MAX_THREADS 4
+
+/* Bytes copied in the kernel between two progress updates */
+#define EOG_JOB_COPY_CHUNK_SIZE (8 * 1024 * 1024)
+
+typedef struct {
+	EogJobCopy *job;
+	GMutex      mutex;
+	gfloat     *progress;       /* per file */
+	gfloat      total_progress;
+	guint       n_files;
+} EogJobCopyBatch;
+
+typedef struct {
+	EogJobCopyBatch *batch;
+	GFile           *file;
+	guint            position;
+} EogJobCopyItem;
+
+/* Maximum number of images saved at the same time */
+#define EOG_JOB_SAVE_MAX_THREADS 4
+
+typedef struct {
+	EogJobSave *job;
+	GMutex      mutex;
+	gfloat     *progress;       /* per image */
+	gfloat      total_progress;
+	guint       n_images;
+	gboolean    failed;
+} EogJobSaveBatch;
+
+typedef struct {
+	EogJobSaveBatch  *batch;
+	EogImage         *image;
+	guint             position;
+	EogImageSaveInfo *dest_info; /* NULL when saving in place */
+} EogJobSaveItem;
+
 /* --------------------------- notify signal funcs --------------------------- */
 static gboolean
 notify_progress (EogJob *job)
@@ -220,6 +281,7 @@ void eog_job_init (EogJob *job)
 	job->progress    = 0.0;
 	job->cancelled   = FALSE;
 	job->finished    = FALSE;
+	job->priority    = EOG_JOB_PRIORITY_LOW;
 
 	/* NOTE: we need to allocate the mutex here so the ABI stays
 	   the same when it used to use g_mutex_new */
@@ -406,29 +468,277 @@ void eog_job_copy_dispose (GObject *object)
 	G_OBJECT_CLASS (eog_job_copy_parent_class)->dispose (object);
 }
 
+/* Runs in the batch's worker threads */
 static void
 eog_job_copy_progress_callback (goffset  current_num_bytes,
 				goffset  total_num_bytes,
 				gpointer user_data)
 {
-	gfloat      progress;
-	guint       n_images;
-	EogJobCopy *job;
+	EogJobCopyItem  *item = user_data;
+	EogJobCopyBatch *batch = item->batch;
+	gfloat           file_progress;
+	gfloat           progress;
+
+	if (total_num_bytes <= 0)
+		return;
+
+	file_progress = current_num_bytes / (gfloat) total_num_bytes;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&batch->mutex);
+
+	batch->total_progress += file_progress - batch->progress[item->position];
+	batch->progress[item->position] = file_progress;
+	progress = batch->total_progress / batch->n_files;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&batch->mutex);
+
+	eog_job_set_progress (EOG_JOB (batch->job), CLAMP (progress, 0.0, 1.0));
+}
+
+#if defined(HAVE_FICLONE) || defined(HAVE_COPY_FILE_RANGE)
+/* Copies a local file without moving its data through user space: as a
+ * reflink sharing the data blocks where the file system supports it,
+ * with copy_file_range() otherwise. The data goes to a temporary file
+ * next to @dest which only replaces it once complete, so a failure never
+ * leaves a partial file behind. Returns FALSE without setting @error
+ * when neither is possible, so that the caller falls back to GIO, which
+ * also reports errors opening the files. */
+static gboolean
+eog_job_copy_local_file (GFile          *src,
+			 GFile          *dest,
+			 EogJobCopyItem *item,
+			 GError        **error)
+{
+	gchar *src_path, *dest_path, *dest_dir, *tmp_path = NULL;
+	struct stat st;
+	gint src_fd = -1, dest_fd = -1;
+	gboolean copied = FALSE;
+
+	src_path = g_file_get_path (src);
+	dest_path = g_file_get_path (dest);
+
+	src_fd = g_open (src_path, O_RDONLY | O_CLOEXEC, 0);
+	if (src_fd < 0 || fstat (src_fd, &st) != 0 || !S_ISREG (st.st_mode))
+		goto out;
+
+	dest_dir = g_path_get_dirname (dest_path);
+	tmp_path = g_build_filename (dest_dir, ".eog-copy-XXXXXX", NULL);
+	g_free (dest_dir);
+
+	dest_fd = g_mkstemp_full (tmp_path, O_WRONLY | O_CLOEXEC,
+				  st.st_mode & 0777);
+	if (dest_fd < 0) {
+		g_clear_pointer (&tmp_path, g_free);
+		goto out;
+	}
+
+#ifdef HAVE_FICLONE
+	if (ioctl (dest_fd, FICLONE, src_fd) == 0) {
+		eog_debug_message (DEBUG_JOBS, "Cloned %s", dest_path);
+
+		eog_job_copy_progress_callback (st.st_size, st.st_size, item);
+		copied = TRUE;
+		goto out;
+	}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	{
+		goffset done = 0;
+		gint errsv = 0;
+
+		while (done < st.st_size) {
+			gssize n;
+
+			n = copy_file_range (src_fd, NULL, dest_fd, NULL,
+					     MIN (st.st_size - done, EOG_JOB_COPY_CHUNK_SIZE),
+					     0);
+
+			if (n < 0 && errno == EINTR)
+				continue;
+
+			if (n < 0) {
+				errsv = errno;
+				break;
+			}
+
+			/* the source file got shorter meanwhile */
+			if (n == 0)
+				break;
+
+			done += n;
+
+			eog_job_copy_progress_callback (done, st.st_size, item);
+		}
+
+		if (errsv == 0) {
+			copied = TRUE;
+		} else if (done > 0 ||
+			   (errsv != ENOSYS && errsv != EXDEV &&
+			    errsv != EOPNOTSUPP && errsv != EINVAL)) {
+			/* a real I/O error, not a lack of support */
+			g_set_error (error, G_IO_ERROR,
+				     g_io_error_from_errno (errsv),
+				     "%s", g_strerror (errsv));
+		}
+	}
+#endif
+
+out:
+	if (dest_fd >= 0 && !g_close (dest_fd, NULL))
+		copied = FALSE;
+	if (src_fd >= 0)
+		g_close (src_fd, NULL);
+
+	if (copied && g_rename (tmp_path, dest_path) != 0) {
+		gint errsv = errno;
+
+		g_set_error (error, G_IO_ERROR,
+			     g_io_error_from_errno (errsv),
+			     "%s", g_strerror (errsv));
+		copied = FALSE;
+	}
+
+	if (!copied && tmp_path != NULL)
+		g_unlink (tmp_path);
+
+	g_free (tmp_path);
+	g_free (src_path);
+	g_free (dest_path);
+
+	return copied;
+}
+#endif
+
+/* Whether @src and @dest are the same file, also through hard links
+ * and bind mounts, which file names can't tell */
+static gboolean
+eog_job_copy_is_same_file (GFile *src, GFile *dest)
+{
+	GFileInfo *src_info, *dest_info;
+	const gchar *src_id, *dest_id;
+	gboolean same = FALSE;
+
+	if (g_file_equal (src, dest))
+		return TRUE;
+
+	src_info = g_file_query_info (src, G_FILE_ATTRIBUTE_ID_FILE,
+				      G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	dest_info = g_file_query_info (dest, G_FILE_ATTRIBUTE_ID_FILE,
+				       G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+	if (src_info != NULL && dest_info != NULL) {
+		src_id = g_file_info_get_attribute_string (src_info,
+							   G_FILE_ATTRIBUTE_ID_FILE);
+		dest_id = g_file_info_get_attribute_string (dest_info,
+							    G_FILE_ATTRIBUTE_ID_FILE);
+
+		same = (src_id != NULL && g_strcmp0 (src_id, dest_id) == 0);
+	}
+
+	g_clear_object (&src_info);
+	g_clear_object (&dest_info);
+
+	return same;
+}
 
-	job = EOG_JOB_COPY (user_data);
+static gboolean
+eog_job_copy_file (GFile *src, GFile *dest, EogJobCopyItem *item, GError **error)
+{
+	/* Copying a file onto itself would truncate it */
+	if (eog_job_copy_is_same_file (src, dest)) {
+		gchar *name = g_file_get_parse_name (dest);
 
-	n_images = g_list_length (job->images);
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+			     _("Can’t copy “%s” onto itself"), name);
+		g_free (name);
 
-	progress = ((current_num_bytes / (gfloat) total_num_bytes) + job->current_position) / n_images;
+		return FALSE;
+	}
 
-	eog_job_set_progress (EOG_JOB (job), progress);
+#if defined(HAVE_FICLONE) || defined(HAVE_COPY_FILE_RANGE)
+	if (g_file_is_native (src) && g_file_is_native (dest)) {
+		GError *local_error = NULL;
+
+		if (eog_job_copy_local_file (src, dest, item, &local_error))
+			return TRUE;
+
+		if (local_error != NULL) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+	}
+#endif
+
+	return g_file_copy (src, dest,
+			    G_FILE_COPY_OVERWRITE, NULL,
+			    eog_job_copy_progress_callback, item,
+			    error);
+}
+
+/* Copies a single file of the batch, runs in a worker thread */
+static void
+eog_job_copy_item_run (gpointer data, gpointer user_data)
+{
+	EogJobCopyItem  *item = data;
+	EogJobCopyBatch *batch = user_data;
+	EogJobCopy      *copyjob = batch->job;
+	GFile *dest;
+	gchar *filename, *dest_filename;
+	GError *error = NULL;
+
+	if (eog_job_is_cancelled (EOG_JOB (copyjob))) {
+		g_slice_free (EogJobCopyItem, item);
+		return;
+	}
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&batch->mutex);
+
+	copyjob->current_position = item->position;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&batch->mutex);
+
+	filename = g_file_get_basename (item->file);
+	dest_filename = g_build_filename (copyjob->destination, filename, NULL);
+	dest = g_file_new_for_path (dest_filename);
+
+	if (!eog_job_copy_file (item->file, dest, item, &error)) {
+		/* --- enter critical section --- */
+		g_mutex_lock (&batch->mutex);
+
+		/* Only the first error is reported, the other files
+		 * are copied nevertheless */
+		if (EOG_JOB (copyjob)->error == NULL) {
+			EOG_JOB (copyjob)->error = error;
+			error = NULL;
+		}
+
+		/* --- leave critical section --- */
+		g_mutex_unlock (&batch->mutex);
+
+		g_clear_error (&error);
+	}
+
+	g_object_unref (dest);
+	g_free (filename);
+	g_free (dest_filename);
+
+	g_slice_free (EogJobCopyItem, item);
 }
 
 static void
 eog_job_copy_run (EogJob *job)
 {
 	EogJobCopy *copyjob;
+	EogJobCopyBatch batch;
+	GThreadPool *pool = NULL;
 	GList *it;
+	guint n_threads;
+	guint position = 0;
 
 	/* initialization */
 	g_return_if_fail (EOG_IS_JOB_COPY (job));
@@ -450,24 +760,40 @@ eog_job_copy_run (EogJob *job)
 
 	copyjob->current_position = 0;
 
-	for (it = copyjob->images; it != NULL; it = g_list_next (it), copyjob->current_position++) {
-		GFile *src, *dest;
-		gchar *filename, *dest_filename;
-
-		src = (GFile *) it->data;
-		filename = g_file_get_basename (src);
-		dest_filename = g_build_filename (copyjob->destination, filename, NULL);
-		dest = g_file_new_for_path (dest_filename);
-
-		g_file_copy (src, dest,
-					 G_FILE_COPY_OVERWRITE, NULL,
-					 eog_job_copy_progress_callback, job,
-					 &job->error);
-		g_object_unref (dest);
-		g_free (filename);
-		g_free (dest_filename);
+	batch.job = copyjob;
+	batch.n_files = g_list_length (copyjob->images);
+	batch.progress = g_new0 (gfloat, batch.n_files);
+	batch.total_progress = 0.0;
+	g_mutex_init (&batch.mutex);
+
+	/* Copying is bound by I/O, so keep several files in flight */
+	n_threads = MIN (batch.n_files, EOG_JOB_COPY_MAX_THREADS);
+
+	if (n_threads > 1) {
+		pool = g_thread_pool_new (eog_job_copy_item_run, &batch,
+					  n_threads, TRUE, NULL);
+	}
+
+	for (it = copyjob->images; it != NULL; it = g_list_next (it)) {
+		EogJobCopyItem *item;
+
+		item = g_slice_new0 (EogJobCopyItem);
+		item->batch = &batch;
+		item->file = (GFile *) it->data;
+		item->position = position++;
+
+		if (pool != NULL)
+			g_thread_pool_push (pool, item, NULL);
+		else
+			eog_job_copy_item_run (item, &batch);
 	}
 
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	g_mutex_clear (&batch.mutex);
+	g_free (batch.progress);
+
 	/* --- enter critical section --- */
 	g_mutex_lock (job->mutex);
 
@@ -922,28 +1248,224 @@ void eog_job_save_dispose (GObject *object)
 	G_OBJECT_CLASS (eog_job_save_parent_class)->dispose (object);
 }
 
+/* Runs in the batch's worker threads */
 static void
 eog_job_save_progress_callback (EogImage *image,
 				gfloat    progress,
 				gpointer  data)
 {
-	EogJobSave *job;
-	guint       n_images;
-	gfloat      job_progress;
+	EogJobSaveItem  *item = data;
+	EogJobSaveBatch *batch = item->batch;
+	gfloat           job_progress;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&batch->mutex);
+
+	batch->total_progress += progress - batch->progress[item->position];
+	batch->progress[item->position] = progress;
+	job_progress = batch->total_progress / batch->n_images;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&batch->mutex);
+
+	eog_job_set_progress (EOG_JOB (batch->job), CLAMP (job_progress, 0.0, 1.0));
+}
+
+static gboolean
+eog_job_save_load_image (EogImage         *image,
+			 EogImageSaveInfo *target,
+			 GError          **error)
+{
+	EogImageMetadataStatus m_status;
+	gint data2load = 0;
+
+	if (eog_image_has_data (image, EOG_IMAGE_DATA_ALL))
+		return TRUE;
+
+	/* The saved file's type is needed without the pixels too */
+	if (!eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE))
+		eog_image_detect_file_type (image);
+
+	m_status = eog_image_get_metadata_status (image);
+	if (!eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE) &&
+	    !eog_image_can_save_lossless (image, target)) {
+		// Queue full read in this case, a lossless JPEG
+		// transformation only needs the metadata
+		data2load = EOG_IMAGE_DATA_ALL;
+	} else if (m_status == EOG_IMAGE_METADATA_NOT_READ)
+	{
+		// Load only if we haven't read it yet
+		data2load = EOG_IMAGE_DATA_EXIF
+				| EOG_IMAGE_DATA_XMP;
+	}
+
+	if (data2load == 0)
+		return TRUE;
+
+	return eog_image_load (image, data2load, NULL, error);
+}
+
+static void
+eog_job_save_item_free (EogJobSaveItem *item)
+{
+	g_clear_object (&item->dest_info);
+	g_slice_free (EogJobSaveItem, item);
+}
 
-	job = EOG_JOB_SAVE (data);
+/* Saves a single image of the batch, runs in a worker thread */
+static void
+eog_job_save_item_run (gpointer data, gpointer user_data)
+{
+	EogJobSaveItem   *item = data;
+	EogJobSaveBatch  *batch = user_data;
+	EogJobSave       *save_job = batch->job;
+	EogImage         *image = item->image;
+	EogImageSaveInfo *src_info;
+	GError           *error = NULL;
+	gboolean          skip;
+	gboolean          success = FALSE;
+	gulong            handler_id;
 
-	n_images     = g_list_length (job->images);
-	job_progress = (job->current_position / (gfloat) n_images) + (progress / n_images);
+	/* --- enter critical section --- */
+	g_mutex_lock (&batch->mutex);
 
-	eog_job_set_progress (EOG_JOB (job), job_progress);
+	/* Don't start anything new after a failure */
+	skip = batch->failed || eog_job_is_cancelled (EOG_JOB (save_job));
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&batch->mutex);
+
+	if (skip) {
+		eog_job_save_item_free (item);
+		return;
+	}
+
+	/* --- enter critical section --- */
+	g_mutex_lock (EOG_JOB (save_job)->mutex);
+
+	/* Read from the main loop, see eog_job_save_get_current_image() */
+	save_job->current_image = image;
+	save_job->current_position = item->position;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (EOG_JOB (save_job)->mutex);
+
+	/* Make sure the image doesn't go away while saving */
+	eog_image_data_ref (image);
+
+	if (eog_job_save_load_image (image, item->dest_info, &error)) {
+		handler_id = g_signal_connect (G_OBJECT (image),
+					       "save-progress",
+					       G_CALLBACK (eog_job_save_progress_callback),
+					       item);
+
+		src_info = eog_image_save_info_new_from_image (image);
+
+		if (item->dest_info != NULL) {
+			success = eog_image_save_as_by_info (image,
+							     src_info,
+							     item->dest_info,
+							     &error);
+		} else {
+			success = eog_image_save_by_info (image,
+							  src_info,
+							  &error);
+		}
+
+		if (src_info)
+			g_object_unref (src_info);
+
+		g_signal_handler_disconnect (G_OBJECT (image), handler_id);
+	}
+
+	eog_image_data_unref (image);
+
+	if (success) {
+		eog_job_save_progress_callback (image, 1.0, item);
+	} else {
+		/* --- enter critical section --- */
+		g_mutex_lock (&batch->mutex);
+
+		/* Only the first error is reported, a file name
+		 * may have failed to convert already */
+		if (!batch->failed) {
+			batch->failed = TRUE;
+
+			if (EOG_JOB (save_job)->error == NULL) {
+				EOG_JOB (save_job)->error = error;
+				error = NULL;
+			}
+		}
+
+		/* --- leave critical section --- */
+		g_mutex_unlock (&batch->mutex);
+
+		g_clear_error (&error);
+	}
+
+	eog_job_save_item_free (item);
+}
+
+/* Saves @images, which belong to @save_job, up to EOG_JOB_SAVE_MAX_THREADS
+ * at the same time. @dest_infos holds the destination of each image for
+ * EogJobSaveAs and is consumed, it's %NULL to save the images in place. */
+static void
+eog_job_save_run_batch (EogJobSave *save_job, GList *images, GList *dest_infos)
+{
+	EogJobSaveBatch batch;
+	GThreadPool *pool = NULL;
+	GList *it, *dest;
+	guint n_threads;
+	guint position = 0;
+
+	batch.job = save_job;
+	batch.n_images = g_list_length (images);
+	batch.progress = g_new0 (gfloat, batch.n_images);
+	batch.total_progress = 0.0;
+	batch.failed = FALSE;
+	g_mutex_init (&batch.mutex);
+
+	n_threads = MIN (batch.n_images,
+			 MIN (g_get_num_processors (), EOG_JOB_SAVE_MAX_THREADS));
+
+	if (n_threads > 1) {
+		pool = g_thread_pool_new (eog_job_save_item_run, &batch,
+					  n_threads, TRUE, NULL);
+	}
+
+	save_job->current_position = 0;
+
+	for (it = images, dest = dest_infos;
+	     it != NULL;
+	     it = it->next, dest = dest ? dest->next : NULL) {
+		EogJobSaveItem *item;
+
+		item = g_slice_new0 (EogJobSaveItem);
+		item->batch = &batch;
+		item->image = EOG_IMAGE (it->data);
+		item->position = position++;
+		item->dest_info = dest ? dest->data : NULL;
+
+		if (pool != NULL)
+			g_thread_pool_push (pool, item, NULL);
+		else
+			eog_job_save_item_run (item, &batch);
+	}
+
+	g_list_free (dest_infos);
+
+	/* Wait for the queued images, they bail out early after a failure */
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	g_mutex_clear (&batch.mutex);
+	g_free (batch.progress);
 }
 
 static void
 eog_job_save_run (EogJob *job)
 {
 	EogJobSave *save_job;
-	GList *it;
 
 	/* initialization */
 	g_return_if_fail (EOG_IS_JOB_SAVE (job));
@@ -962,64 +1484,7 @@ eog_job_save_run (EogJob *job)
 
 	save_job = EOG_JOB_SAVE (job);
 
-	save_job->current_position = 0;
-
-	for (it = save_job->images; it != NULL; it = it->next, save_job->current_position++) {
-		EogImage *image = EOG_IMAGE (it->data);
-		EogImageSaveInfo *save_info = NULL;
-		gulong handler_id = 0;
-		gboolean success = FALSE;
-
-		save_job->current_image = image;
-
-		/* Make sure the image doesn't go away while saving */
-		eog_image_data_ref (image);
-
-		if (!eog_image_has_data (image, EOG_IMAGE_DATA_ALL)) {
-			EogImageMetadataStatus m_status;
-			gint data2load = 0;
-
-			m_status = eog_image_get_metadata_status (image);
-			if (!eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE)) {
-				// Queue full read in this case
-				data2load = EOG_IMAGE_DATA_ALL;
-			} else if (m_status == EOG_IMAGE_METADATA_NOT_READ)
-			{
-				// Load only if we haven't read it yet
-				data2load = EOG_IMAGE_DATA_EXIF
-						| EOG_IMAGE_DATA_XMP;
-			}
-
-			if (data2load != 0) {
-				eog_image_load (image,
-						data2load,
-						NULL,
-						&job->error);
-			}
-		}
-
-		handler_id = g_signal_connect (G_OBJECT (image),
-						   "save-progress",
-							   G_CALLBACK (eog_job_save_progress_callback),
-						   job);
-
-		save_info = eog_image_save_info_new_from_image (image);
-
-		success = eog_image_save_by_info (image,
-						  save_info,
-						  &job->error);
-
-		if (save_info)
-			g_object_unref (save_info);
-
-		if (handler_id != 0)
-			g_signal_handler_disconnect (G_OBJECT (image), handler_id);
-
-		eog_image_data_unref (image);
-
-		if (!success)
-			break;
-	}
+	eog_job_save_run_batch (save_job, save_job->images, NULL);
 
 	/* --- enter critical section --- */
 	g_mutex_lock (job->mutex);
@@ -1065,6 +1530,39 @@ eog_job_save_new (GList *images)
 	return EOG_JOB (job);
 }
 
+/**
+ * eog_job_save_get_current_image:
+ * @job: an #EogJobSave
+ * @position: (out) (optional): return location for the position of
+ *   the image in the list of images of @job
+ *
+ * Gets the image @job most recently started to save. As images are
+ * saved in worker threads, this is how to get it while @job is running.
+ *
+ * Returns: (transfer full) (nullable): the #EogImage, or %NULL if
+ * none has been started yet.
+ */
+EogImage *
+eog_job_save_get_current_image (EogJobSave *job, guint *position)
+{
+	EogImage *image;
+
+	g_return_val_if_fail (EOG_IS_JOB_SAVE (job), NULL);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (EOG_JOB (job)->mutex);
+
+	image = job->current_image ? g_object_ref (job->current_image) : NULL;
+
+	if (position != NULL)
+		*position = job->current_position;
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (EOG_JOB (job)->mutex);
+
+	return image;
+}
+
 /* ------------------------------- EogJobSaveAs -------------------------------- */
 static void
 eog_job_save_as_class_init (EogJobSaveAsClass *class)
@@ -1114,7 +1612,7 @@ eog_job_save_as_run (EogJob *job)
 {
 	EogJobSave *save_job;
 	EogJobSaveAs *saveas_job;
-	GList *it;
+	GList *it, *images = NULL, *dest_infos = NULL;
 	guint n_images;
 
 	/* initialization */
@@ -1133,52 +1631,14 @@ eog_job_save_as_run (EogJob *job)
 	save_job = EOG_JOB_SAVE (g_object_ref (job));
 	saveas_job = EOG_JOB_SAVE_AS (job);
 
-	save_job->current_position = 0;
 	n_images = g_list_length (save_job->images);
 
-	for (it = save_job->images; it != NULL; it = it->next, save_job->current_position++) {
+	/* The destinations are determined up front, in order, so the
+	 * converter's counter doesn't depend on which save ends first */
+	for (it = save_job->images; it != NULL; it = it->next) {
 		GdkPixbufFormat *format;
-		EogImageSaveInfo *src_info, *dest_info;
+		EogImageSaveInfo *dest_info;
 		EogImage *image = EOG_IMAGE (it->data);
-		gboolean success = FALSE;
-		gulong handler_id = 0;
-
-		save_job->current_image = image;
-
-		eog_image_data_ref (image);
-
-		if (!eog_image_has_data (image, EOG_IMAGE_DATA_ALL)) {
-			EogImageMetadataStatus m_status;
-			gint data2load = 0;
-
-			m_status = eog_image_get_metadata_status (image);
-			if (!eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE)) {
-				// Queue full read in this case
-				data2load = EOG_IMAGE_DATA_ALL;
-			} else if (m_status == EOG_IMAGE_METADATA_NOT_READ)
-			{
-				// Load only if we haven't read it yet
-				data2load = EOG_IMAGE_DATA_EXIF
-						| EOG_IMAGE_DATA_XMP;
-			}
-
-			if (data2load != 0) {
-				eog_image_load (image,
-						data2load,
-						NULL,
-						&job->error);
-			}
-		}
-
-
-		g_assert (job->error == NULL);
-
-		handler_id = g_signal_connect (G_OBJECT (image),
-						   "save-progress",
-							   G_CALLBACK (eog_job_save_progress_callback),
-						   job);
-
-		src_info = eog_image_save_info_new_from_image (image);
 
 		if (n_images == 1) {
 			g_assert (saveas_job->file != NULL);
@@ -1194,40 +1654,38 @@ eog_job_save_as_run (EogJob *job)
 			}
 		} else {
 			GFile *dest_file;
+			GError *error = NULL;
 			gboolean result;
 
 			result = eog_uri_converter_do (saveas_job->converter,
 							   image,
 							   &dest_file,
 							   &format,
-							   NULL);
+							   &error);
+
+			/* Leave the image out, the others are saved */
+			if (!result) {
+				if (job->error == NULL)
+					job->error = error;
+				else
+					g_error_free (error);
 
-			g_assert (result);
+				continue;
+			}
 
 			dest_info = eog_image_save_info_new_from_file (dest_file,
 									   format);
+			g_object_unref (dest_file);
 		}
 
-		success = eog_image_save_as_by_info (image,
-							 src_info,
-							 dest_info,
-							 &job->error);
-
-		if (src_info)
-			g_object_unref (src_info);
-
-		if (dest_info)
-			g_object_unref (dest_info);
-
-		if (handler_id != 0)
-			g_signal_handler_disconnect (G_OBJECT (image), handler_id);
-
-		eog_image_data_unref (image);
-
-		if (!success)
-			break;
+		images = g_list_prepend (images, image);
+		dest_infos = g_list_prepend (dest_infos, dest_info);
 	}
 
+	images = g_list_reverse (images);
+	eog_job_save_run_batch (save_job, images, g_list_reverse (dest_infos));
+	g_list_free (images);
+
 	/* --- enter critical section --- */
 	g_mutex_lock (job->mutex);
 
@@ -1342,48 +1800,10 @@ eog_job_thumbnail_run (EogJob *job)
 		job->error = NULL;
 	}
 
-	/* try to load the image thumbnail from cache */
-	job_thumbnail->thumbnail = eog_thumbnail_load (job_thumbnail->image,
-						       &job->error);
-
-	if (job_thumbnail->thumbnail) {
-		GdkPixbuf *pixbuf;
-		gchar     *original_width;
-		gchar     *original_height;
-		gint       width;
-		gint       height;
-
-		/* create the image thumbnail */
-		original_width  = g_strdup (gdk_pixbuf_get_option
-					    (job_thumbnail->thumbnail,
-					     "tEXt::Thumb::Image::Width"));
-		original_height = g_strdup (gdk_pixbuf_get_option
-					    (job_thumbnail->thumbnail,
-					     "tEXt::Thumb::Image::Height"));
-
-		pixbuf = eog_thumbnail_fit_to_size (job_thumbnail->thumbnail,
-						    EOG_LIST_STORE_THUMB_SIZE);
-
-		g_object_unref (job_thumbnail->thumbnail);
-		job_thumbnail->thumbnail = eog_thumbnail_add_frame (pixbuf);
-		g_object_unref (pixbuf);
-
-		if (original_width) {
-			sscanf (original_width, "%i", &width);
-			g_object_set_data (G_OBJECT (job_thumbnail->thumbnail),
-					   EOG_THUMBNAIL_ORIGINAL_WIDTH,
-					   GINT_TO_POINTER (width));
-			g_free (original_width);
-		}
-
-		if (original_height) {
-			sscanf (original_height, "%i", &height);
-			g_object_set_data (G_OBJECT (job_thumbnail->thumbnail),
-					   EOG_THUMBNAIL_ORIGINAL_HEIGHT,
-					   GINT_TO_POINTER (height));
-			g_free (original_height);
-		}
-	}
+	/* try to load the framed image thumbnail from cache */
+	job_thumbnail->thumbnail = eog_thumbnail_load_framed (job_thumbnail->image,
+							      job_thumbnail->allow_preview,
+							      &job->error);
 
 	/* show info for debugging */
 	if (job->error)
@@ -104,6 +104,14 @@ typedef struct _EogURIConverter EogURIConverter;
 typedef struct _EogJob               EogJob;
 #endif
 
+typedef enum {
+	EOG_JOB_PRIORITY_HIGH,
+	EOG_JOB_PRIORITY_MEDIUM,
+	EOG_JOB_PRIORITY_LOW,
+	EOG_JOB_PRIORITY_IDLE,
+	EOG_JOB_N_PRIORITIES
+} EogJobPriority;
+
 typedef struct _EogJobClass          EogJobClass;
 
 typedef struct _EogJobCopy           EogJobCopy;
@@ -138,6 +146,9 @@ struct _EogJob
 	gfloat        progress;
 	gboolean      cancelled;
 	gboolean      finished;
+
+	/* the one the job was queued with */
+	EogJobPriority priority;
 };
 
 struct _EogJobClass
@@ -227,6 +238,7 @@ struct _EogJobThumbnail
 
 	EogImage        *image;
 	GdkPixbuf       *thumbnail;
+	gboolean         allow_preview;
 };
 
 struct _EogJobThumbnailClass
@@ -278,6 +290,8 @@ EogJob 	*eog_job_model_new          (GSList          *file_list);
 /* EogJobSave */
 GType    eog_job_save_get_type      (void) G_GNUC_CONST;
 EogJob  *eog_job_save_new           (GList           *images);
+EogImage *eog_job_save_get_current_image (EogJobSave     *job,
+					  guint          *position);
 
 /* EogJobSaveAs */
 GType    eog_job_save_as_get_type   (void) G_GNUC_CONST;
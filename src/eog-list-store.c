@@ -26,18 +26,78 @@
 #include "eog-image.h"
 #include "eog-job-scheduler.h"
 #include "eog-jobs.h"
+#include "eog-metadata-index.h"
 #include "eog-util.h"
+#include "eog-config-keys.h"
+#include "eog-debug.h"
 
 #include <string.h>
 
+/* Maximum number of subdirectories enumerated at the same time
+ * in recursive mode, and number of entries fetched per request. */
+#define EOG_LIST_STORE_MAX_CRAWLERS 4
+#define EOG_LIST_STORE_CRAWL_BATCH  32
+
+/* Maximum number of files whose sort key is read at the same time,
+ * and how long to wait for more keys before reordering the store. */
+#define EOG_LIST_STORE_MAX_SCANNERS 4
+#define EOG_LIST_STORE_RESORT_DELAY 250
+
+#define EOG_LIST_STORE_ENUMERATE_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK "," \
+	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_NAME
+
 struct _EogListStorePrivate {
 	GHashTable *monitors;          /* Monitors for the directories */
 	gint initial_image;       /* The image that should be selected firstly by the view. */
 	GdkPixbuf *busy_image;    /* Loading image icon */
 	GdkPixbuf *missing_image; /* Missing image icon */
 	GMutex mutex;             /* Mutex for saving the jobs in the model */
+
+	gboolean recursive;       /* Whether subdirectories are loaded too */
+	gint max_depth;           /* Maximum subdirectory depth in recursive mode */
+	GQueue crawl_queue;       /* Subdirectories waiting to be enumerated */
+	guint n_crawlers;         /* Enumerations currently in flight */
+	guint crawl_idle_id;
+	GCancellable *crawl_cancellable;
+
+	EogListStoreSortKey sort_key;
+	GHashTable *sort_data;    /* EogImage -> EogListStoreSortData */
+	GQueue scan_queue;        /* Images waiting for their sort key */
+	guint n_scanners;         /* Sort key reads currently in flight */
+	guint scan_idle_id;
+	guint resort_id;
+	GCancellable *scan_cancellable;
 };
 
+typedef struct {
+	EogListStore *store;
+	GFile *directory;
+	gint depth;
+	GCancellable *cancellable;
+} EogListStoreCrawl;
+
+typedef struct {
+	gboolean ready;           /* Whether the fields below are known */
+	guint64 size;
+	guint64 mtime;
+	guint64 pixels;
+	gchar *capture_date;
+} EogListStoreSortData;
+
+typedef struct {
+	EogListStore *store;
+	EogImage *image;
+	GFile *file;
+	EogListStoreSortKey sort_key;
+	GCancellable *cancellable;
+	EogListStoreSortData data;
+} EogListStoreScan;
+
 G_DEFINE_TYPE_WITH_PRIVATE (EogListStore, eog_list_store, GTK_TYPE_LIST_STORE);
 
 enum {
@@ -56,6 +116,44 @@ foreach_monitors_free (gpointer data)
 static void
 eog_list_store_remove_thumbnail_job (EogListStore *store, GtkTreeIter *iter);
 
+static void
+eog_list_store_add_thumbnail_job (EogListStore *store,
+				  GtkTreeIter *iter,
+				  EogJobPriority priority,
+				  gboolean allow_preview);
+
+static void
+eog_list_store_scan_queue_image (EogListStore *store,
+				 EogImage *image);
+
+static void
+eog_list_store_crawl_free (EogListStoreCrawl *crawl)
+{
+	g_object_unref (crawl->directory);
+	g_object_unref (crawl->cancellable);
+	g_slice_free (EogListStoreCrawl, crawl);
+}
+
+static void
+eog_list_store_sort_data_free (EogListStoreSortData *data)
+{
+	g_free (data->capture_date);
+	g_slice_free (EogListStoreSortData, data);
+}
+
+static void
+eog_list_store_scan_free (EogListStoreScan *scan)
+{
+	g_object_unref (scan->image);
+	g_object_unref (scan->file);
+	g_object_unref (scan->cancellable);
+	g_free (scan->data.capture_date);
+	g_slice_free (EogListStoreScan, scan);
+}
+
+static void
+eog_list_store_scan_stop (EogListStore *store);
+
 static gboolean
 foreach_model_cancel_job (GtkTreeModel *model, GtkTreePath *path,
 			  GtkTreeIter *iter, gpointer data)
@@ -72,6 +170,26 @@ eog_list_store_dispose (GObject *object)
 	gtk_tree_model_foreach (GTK_TREE_MODEL (store),
 				foreach_model_cancel_job, NULL);
 
+	/* Stop the recursive crawl. Pending callbacks only hold a
+	 * reference to the cancellable, so they bail out without
+	 * touching the store. */
+	if (store->priv->crawl_idle_id != 0) {
+		g_source_remove (store->priv->crawl_idle_id);
+		store->priv->crawl_idle_id = 0;
+	}
+
+	if (store->priv->crawl_cancellable != NULL) {
+		g_cancellable_cancel (store->priv->crawl_cancellable);
+		g_clear_object (&store->priv->crawl_cancellable);
+	}
+
+	g_queue_clear_full (&store->priv->crawl_queue,
+			    (GDestroyNotify) eog_list_store_crawl_free);
+
+	eog_list_store_scan_stop (store);
+	g_clear_object (&store->priv->scan_cancellable);
+	g_clear_pointer (&store->priv->sort_data, g_hash_table_unref);
+
 	if (store->priv->monitors != NULL) {
 		g_hash_table_unref (store->priv->monitors);
 		store->priv->monitors = NULL;
@@ -122,13 +240,53 @@ eog_list_store_class_init (EogListStoreClass *klass)
    Sorting functions
 */
 
+#define CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+/* Images with a known key go first, the rest keep the name order */
+static gint
+eog_list_store_compare_sort_data (EogListStoreSortKey sort_key,
+				  EogListStoreSortData *data_a,
+				  EogListStoreSortData *data_b)
+{
+	gboolean ready_a = (data_a != NULL && data_a->ready);
+	gboolean ready_b = (data_b != NULL && data_b->ready);
+
+	if (!ready_a || !ready_b)
+		return ready_b - ready_a;
+
+	switch (sort_key) {
+	case EOG_LIST_STORE_SORT_KEY_CAPTURE_DATE:
+		if (data_a->capture_date == NULL || data_b->capture_date == NULL)
+			return (data_b->capture_date != NULL) -
+			       (data_a->capture_date != NULL);
+
+		/* "YYYY:MM:DD HH:MM:SS" sorts chronologically as a string */
+		return strcmp (data_a->capture_date, data_b->capture_date);
+	case EOG_LIST_STORE_SORT_KEY_FILE_SIZE:
+		return CMP (data_a->size, data_b->size);
+	case EOG_LIST_STORE_SORT_KEY_MTIME:
+		return CMP (data_a->mtime, data_b->mtime);
+	case EOG_LIST_STORE_SORT_KEY_PIXEL_COUNT:
+		if (data_a->pixels == 0 || data_b->pixels == 0)
+			return (data_b->pixels != 0) - (data_a->pixels != 0);
+
+		return CMP (data_a->pixels, data_b->pixels);
+	case EOG_LIST_STORE_SORT_KEY_NAME:
+	default:
+		return 0;
+	}
+}
+
+#undef CMP
+
 static gint
 eog_list_store_compare_func (GtkTreeModel *model,
 			     GtkTreeIter *a,
 			     GtkTreeIter *b,
 			     gpointer user_data)
 {
-	gint r_value;
+	EogListStore *store = EOG_LIST_STORE (model);
+	gint r_value = 0;
 
 	EogImage *image_a, *image_b;
 
@@ -140,8 +298,16 @@ eog_list_store_compare_func (GtkTreeModel *model,
 			    EOG_LIST_STORE_EOG_IMAGE, &image_b,
 			    -1);
 
-	r_value = strcmp (eog_image_get_collate_key (image_a),
-			  eog_image_get_collate_key (image_b));
+	if (store->priv->sort_key != EOG_LIST_STORE_SORT_KEY_NAME) {
+		r_value = eog_list_store_compare_sort_data (store->priv->sort_key,
+							    g_hash_table_lookup (store->priv->sort_data, image_a),
+							    g_hash_table_lookup (store->priv->sort_data, image_b));
+	}
+
+	if (r_value == 0) {
+		r_value = strcmp (eog_image_get_collate_key (image_a),
+				  eog_image_get_collate_key (image_b));
+	}
 
 	g_object_unref (G_OBJECT (image_a));
 	g_object_unref (G_OBJECT (image_b));
@@ -190,6 +356,16 @@ eog_list_store_init (EogListStore *self)
 	self->priv->monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, foreach_monitors_free);
 	self->priv->initial_image = -1;
 
+	g_queue_init (&self->priv->crawl_queue);
+	self->priv->crawl_cancellable = g_cancellable_new ();
+
+	self->priv->sort_key = EOG_LIST_STORE_SORT_KEY_NAME;
+	self->priv->sort_data = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						       g_object_unref,
+						       (GDestroyNotify) eog_list_store_sort_data_free);
+	g_queue_init (&self->priv->scan_queue);
+	self->priv->scan_cancellable = g_cancellable_new ();
+
 	self->priv->busy_image = eog_list_store_get_icon ("image-loading");
 	self->priv->missing_image = eog_list_store_get_icon ("image-missing");
 
@@ -287,11 +463,14 @@ eog_job_thumbnail_cb (EogJobThumbnail *job, gpointer data)
 	EogImage *image;
 	GdkPixbuf *thumbnail;
 	GFile *file;
+	gint64 span;
 
 	g_return_if_fail (EOG_IS_LIST_STORE (data));
 
 	store = EOG_LIST_STORE (data);
 
+	span = eog_debug_trace_begin ();
+
 	file = eog_image_get_file (job->image);
 
 	if (is_file_in_list_store_file (store, file, &iter)) {
@@ -315,6 +494,16 @@ eog_job_thumbnail_cb (EogJobThumbnail *job, gpointer data)
 				    EOG_LIST_STORE_EOG_JOB, NULL,
 				    -1);
 
+		/* An embedded preview was used, generate the
+		 * real thumbnail once nothing else is pending */
+		if (job->thumbnail &&
+		    g_object_get_data (G_OBJECT (job->thumbnail),
+				       EOG_THUMBNAIL_IS_PREVIEW)) {
+			eog_list_store_add_thumbnail_job (store, &iter,
+							  EOG_JOB_PRIORITY_IDLE,
+							  FALSE);
+		}
+
 		g_object_unref (image);
 		g_object_unref (thumbnail);
 	}
@@ -322,6 +511,8 @@ eog_job_thumbnail_cb (EogJobThumbnail *job, gpointer data)
 	g_object_unref (file);
 
 	g_signal_emit (store, signals[SIGNAL_DRAW_THUMBNAIL], 0);
+
+	eog_debug_trace_end ("Store thumbnail update", span);
 }
 
 static void
@@ -356,6 +547,7 @@ eog_list_store_remove (EogListStore *store, GtkTreeIter *iter)
 			    -1);
 
 	g_signal_handlers_disconnect_by_func (image, on_image_changed, store);
+	g_hash_table_remove (store->priv->sort_data, image);
 	g_object_unref (image);
 
 	gtk_list_store_remove (GTK_LIST_STORE (store), iter);
@@ -431,6 +623,10 @@ eog_list_store_append_image (EogListStore *store, EogImage *image)
 			    EOG_LIST_STORE_THUMBNAIL, store->priv->busy_image,
 			    EOG_LIST_STORE_THUMB_SET, FALSE,
 			    -1);
+
+	/* Only queued here, the scan is started from the main loop */
+	if (store->priv->sort_key != EOG_LIST_STORE_SORT_KEY_NAME)
+		eog_list_store_scan_queue_image (store, image);
 }
 
 static void
@@ -449,6 +645,21 @@ eog_list_store_append_image_from_file (EogListStore *store,
 	g_object_unref (image);
 }
 
+static void
+eog_list_store_queue_directory (EogListStore *store,
+				GFile *directory,
+				gint depth);
+
+static void
+eog_list_store_unqueue_directory (EogListStore *store,
+				  GFile *directory);
+
+static void
+eog_list_store_crawl_start (EogListStore *store);
+
+static void
+eog_list_store_scan_start (EogListStore *store);
+
 static void
 file_monitor_changed_cb (GFileMonitor *monitor,
 			 GFile *file,
@@ -475,10 +686,17 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 		mimetype = eog_util_get_mime_type_with_fallback (file_info);
 
 		if (is_file_in_list_store_file (store, file, &iter)) {
+			eog_metadata_index_invalidate (file);
+
 			if (eog_image_is_supported_mime_type (mimetype)) {
 				gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
 						    EOG_LIST_STORE_EOG_IMAGE, &image,
 						    -1);
+
+				/* Its sort key may have changed too */
+				if (g_hash_table_remove (store->priv->sort_data, image))
+					eog_list_store_scan_queue_image (store, image);
+
 				eog_image_file_changed (image);
 				g_object_unref (image);
 				eog_list_store_thumbnail_refresh (store, &iter);
@@ -501,9 +719,13 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 	case G_FILE_MONITOR_EVENT_MOVED_OUT:
 	case G_FILE_MONITOR_EVENT_DELETED:
 		if (is_file_in_list_store_file (store, file, &iter)) {
+			eog_metadata_index_invalidate (file);
 			eog_list_store_remove (store, &iter);
 		} else {
 			gchar *directory = g_file_get_uri (file);
+
+			eog_list_store_unqueue_directory (store, file);
+
 			if (g_hash_table_contains(store->priv->monitors, directory)) {
 				gint num_directories = g_hash_table_size (store->priv->monitors);
 				if (num_directories > 1)
@@ -519,6 +741,8 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 	case G_FILE_MONITOR_EVENT_CREATED:
 		if (!is_file_in_list_store_file (store, file, NULL)) {
 			file_info = g_file_query_info (file,
+						       G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+						       G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK ","
 						       G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
 						       G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE ","
 						       G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
@@ -526,6 +750,23 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 			if (file_info == NULL) {
 				break;
 			}
+
+			if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY) {
+				gint depth;
+
+				depth = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (monitor),
+									    "eog-directory-depth"));
+
+				if (store->priv->recursive &&
+				    depth < store->priv->max_depth &&
+				    !g_file_info_get_is_symlink (file_info)) {
+					eog_list_store_queue_directory (store, file, depth + 1);
+					eog_list_store_crawl_start (store);
+				}
+				g_object_unref (file_info);
+				break;
+			}
+
 			mimetype = eog_util_get_mime_type_with_fallback (file_info);
 
 			if (eog_image_is_supported_mime_type (mimetype)) {
@@ -579,6 +820,7 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 		}
 
 		if (is_file_in_list_store_file (store, file, &iter)) {
+			eog_metadata_index_invalidate (file);
 			eog_list_store_remove (store, &iter);
 		}
 
@@ -589,30 +831,46 @@ file_monitor_changed_cb (GFileMonitor *monitor,
 	case G_FILE_MONITOR_EVENT_MOVED:
 		break;
 	}
+
+	eog_list_store_scan_start (store);
 }
 
 /*
  * Called for each file in a directory. Checks if the file is some
  * sort of image. If so, it creates an image object and adds it to the
- * list.
+ * list. In recursive mode, subdirectories that are not deeper than
+ * the configured limit are queued for enumeration.
  */
 static void
 directory_visit (GFile *directory,
 		 GFileInfo *children_info,
-		 EogListStore *store)
+		 EogListStore *store,
+		 gint depth)
 {
 	GFile *child;
 	gboolean load_uri = FALSE;
 	const char *name;
 	char *mime_type;
 
-	mime_type = eog_util_get_mime_type_with_fallback (children_info);
 	name = g_file_info_get_name (children_info);
 
-        if (!g_str_has_prefix (name, ".")) {
-		if (eog_image_is_supported_mime_type (mime_type)) {
-			load_uri = TRUE;
+	if (g_str_has_prefix (name, "."))
+		return;
+
+	if (g_file_info_get_file_type (children_info) == G_FILE_TYPE_DIRECTORY) {
+		if (store->priv->recursive &&
+		    depth < store->priv->max_depth &&
+		    !g_file_info_get_is_symlink (children_info)) {
+			child = g_file_get_child (directory, name);
+			eog_list_store_queue_directory (store, child, depth + 1);
+			g_object_unref (child);
 		}
+		return;
+	}
+
+	mime_type = eog_util_get_mime_type_with_fallback (children_info);
+	if (eog_image_is_supported_mime_type (mime_type)) {
+		load_uri = TRUE;
 	}
 	g_free (mime_type);
 
@@ -627,43 +885,449 @@ directory_visit (GFile *directory,
 }
 
 static void
-eog_list_store_append_directory (EogListStore *store,
-				 GFile *file,
-				 GFileType file_type)
+eog_list_store_watch_directory (EogListStore *store,
+				GFile *file,
+				gint depth)
 {
 	GFileMonitor *file_monitor;
-	GFileEnumerator *file_enumerator;
-	GFileInfo *file_info;
-
-	g_return_if_fail (file_type == G_FILE_TYPE_DIRECTORY);
 
 	file_monitor = g_file_monitor_directory (file,
 						 G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
 
 	if (file_monitor != NULL) {
+		g_object_set_data (G_OBJECT (file_monitor), "eog-directory-depth",
+				   GINT_TO_POINTER (depth));
 		g_signal_connect (file_monitor, "changed",
 				  G_CALLBACK (file_monitor_changed_cb), store);
 
 		g_hash_table_insert(store->priv->monitors, g_file_get_uri (file), file_monitor);
 	}
+}
+
+static void
+eog_list_store_append_directory (EogListStore *store,
+				 GFile *file,
+				 GFileType file_type)
+{
+	GFileEnumerator *file_enumerator;
+	GFileInfo *file_info;
+
+	g_return_if_fail (file_type == G_FILE_TYPE_DIRECTORY);
+
+	eog_list_store_watch_directory (store, file, 0);
 
 	file_enumerator = g_file_enumerate_children (file,
-						     G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
-						     G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE ","
-						     G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME ","
-						     G_FILE_ATTRIBUTE_STANDARD_NAME,
+						     EOG_LIST_STORE_ENUMERATE_ATTRIBUTES,
 						     0, NULL, NULL);
+	if (file_enumerator == NULL)
+		return;
+
 	file_info = g_file_enumerator_next_file (file_enumerator, NULL, NULL);
 
 	while (file_info != NULL)
 	{
-		directory_visit (file, file_info, store);
+		directory_visit (file, file_info, store, 0);
 		g_object_unref (file_info);
 		file_info = g_file_enumerator_next_file (file_enumerator, NULL, NULL);
 	}
 	g_object_unref (file_enumerator);
 }
 
+/*
+   Recursive mode
+
+   The top-level directory is enumerated synchronously by the model job,
+   every subdirectory found is queued and enumerated asynchronously in
+   the main loop once the store has been handed over, with at most
+   EOG_LIST_STORE_MAX_CRAWLERS enumerations running at a time. Images
+   are appended in batches as they are discovered and each subdirectory
+   gets its monitor when its enumeration starts.
+*/
+
+static void
+eog_list_store_queue_directory (EogListStore *store,
+				GFile *directory,
+				gint depth)
+{
+	EogListStoreCrawl *crawl;
+	gchar *uri;
+
+	/* Already visited, e.g. reached through a bind mount */
+	uri = g_file_get_uri (directory);
+	if (g_hash_table_contains (store->priv->monitors, uri)) {
+		g_free (uri);
+		return;
+	}
+	g_free (uri);
+
+	crawl = g_slice_new0 (EogListStoreCrawl);
+	crawl->store = store;
+	crawl->directory = g_object_ref (directory);
+	crawl->depth = depth;
+	crawl->cancellable = g_object_ref (store->priv->crawl_cancellable);
+
+	g_queue_push_tail (&store->priv->crawl_queue, crawl);
+}
+
+/* Forgets about @directory and its subdirectories if they are still
+ * waiting to be enumerated, e.g. because they were deleted */
+static void
+eog_list_store_unqueue_directory (EogListStore *store,
+				  GFile *directory)
+{
+	GList *it, *next;
+
+	for (it = store->priv->crawl_queue.head; it != NULL; it = next) {
+		EogListStoreCrawl *crawl = it->data;
+
+		next = it->next;
+
+		if (g_file_equal (crawl->directory, directory) ||
+		    g_file_has_prefix (crawl->directory, directory)) {
+			g_queue_delete_link (&store->priv->crawl_queue, it);
+			eog_list_store_crawl_free (crawl);
+		}
+	}
+}
+
+static void
+eog_list_store_crawl_finished (EogListStoreCrawl *crawl)
+{
+	EogListStore *store = crawl->store;
+
+	eog_list_store_crawl_free (crawl);
+
+	store->priv->n_crawlers--;
+	eog_list_store_crawl_start (store);
+}
+
+static void
+crawl_next_files_cb (GObject *source_object,
+		     GAsyncResult *result,
+		     gpointer user_data)
+{
+	GFileEnumerator *enumerator = G_FILE_ENUMERATOR (source_object);
+	EogListStoreCrawl *crawl = user_data;
+	GList *infos, *it;
+	gint64 span;
+
+	infos = g_file_enumerator_next_files_finish (enumerator, result, NULL);
+
+	if (g_cancellable_is_cancelled (crawl->cancellable)) {
+		g_list_free_full (infos, g_object_unref);
+		g_object_unref (enumerator);
+		eog_list_store_crawl_free (crawl);
+		return;
+	}
+
+	if (infos == NULL) {
+		eog_debug_message (DEBUG_LIST_STORE,
+				   "Finished crawling a directory at depth %d",
+				   crawl->depth);
+		g_object_unref (enumerator);
+		eog_list_store_crawl_finished (crawl);
+		return;
+	}
+
+	span = eog_debug_trace_begin ();
+
+	for (it = infos; it != NULL; it = it->next) {
+		directory_visit (crawl->directory, G_FILE_INFO (it->data),
+				 crawl->store, crawl->depth);
+	}
+	g_list_free_full (infos, g_object_unref);
+
+	eog_debug_trace_end ("Store crawl batch", span);
+
+	eog_list_store_scan_start (crawl->store);
+
+	g_file_enumerator_next_files_async (enumerator,
+					    EOG_LIST_STORE_CRAWL_BATCH,
+					    G_PRIORITY_LOW,
+					    crawl->cancellable,
+					    crawl_next_files_cb,
+					    crawl);
+
+	/* Newly queued subdirectories may use the free slots */
+	eog_list_store_crawl_start (crawl->store);
+}
+
+static void
+crawl_enumerate_cb (GObject *source_object,
+		    GAsyncResult *result,
+		    gpointer user_data)
+{
+	EogListStoreCrawl *crawl = user_data;
+	GFileEnumerator *enumerator;
+
+	enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
+						       result, NULL);
+
+	if (g_cancellable_is_cancelled (crawl->cancellable)) {
+		g_clear_object (&enumerator);
+		eog_list_store_crawl_free (crawl);
+		return;
+	}
+
+	if (enumerator == NULL) {
+		eog_list_store_crawl_finished (crawl);
+		return;
+	}
+
+	g_file_enumerator_next_files_async (enumerator,
+					    EOG_LIST_STORE_CRAWL_BATCH,
+					    G_PRIORITY_LOW,
+					    crawl->cancellable,
+					    crawl_next_files_cb,
+					    crawl);
+}
+
+static void
+eog_list_store_crawl_start (EogListStore *store)
+{
+	EogListStoreCrawl *crawl;
+
+	while (store->priv->n_crawlers < EOG_LIST_STORE_MAX_CRAWLERS &&
+	       (crawl = g_queue_pop_head (&store->priv->crawl_queue)) != NULL) {
+		store->priv->n_crawlers++;
+
+		eog_list_store_watch_directory (store, crawl->directory,
+						crawl->depth);
+
+		g_file_enumerate_children_async (crawl->directory,
+						 EOG_LIST_STORE_ENUMERATE_ATTRIBUTES,
+						 0,
+						 G_PRIORITY_LOW,
+						 crawl->cancellable,
+						 crawl_enumerate_cb,
+						 crawl);
+	}
+}
+
+static gboolean
+eog_list_store_crawl_start_idle (gpointer user_data)
+{
+	EogListStore *store = EOG_LIST_STORE (user_data);
+
+	store->priv->crawl_idle_id = 0;
+	eog_list_store_crawl_start (store);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+   Sort keys
+
+   Sort keys other than the file name are read by a metadata-only scan
+   that runs in worker threads, with at most EOG_LIST_STORE_MAX_SCANNERS
+   files being read at a time. Only the file info and the headers are
+   looked at, and the persistent metadata index is consulted first.
+   Keys are collected as they arrive and the store is reordered in
+   batches, images without a key yet stay at the end.
+*/
+
+static void
+eog_list_store_scan_queue_image (EogListStore *store,
+				 EogImage *image)
+{
+	EogListStoreScan *scan;
+
+	if (g_hash_table_contains (store->priv->sort_data, image))
+		return;
+
+	g_hash_table_insert (store->priv->sort_data, g_object_ref (image),
+			     g_slice_new0 (EogListStoreSortData));
+
+	scan = g_slice_new0 (EogListStoreScan);
+	scan->store = store;
+	scan->image = g_object_ref (image);
+	scan->file = eog_image_get_file (image);
+	scan->sort_key = store->priv->sort_key;
+	scan->cancellable = g_object_ref (store->priv->scan_cancellable);
+
+	g_queue_push_tail (&store->priv->scan_queue, scan);
+}
+
+static gboolean
+foreach_model_queue_scan (GtkTreeModel *model, GtkTreePath *path,
+			  GtkTreeIter *iter, gpointer data)
+{
+	EogImage *image;
+
+	gtk_tree_model_get (model, iter,
+			    EOG_LIST_STORE_EOG_IMAGE, &image,
+			    -1);
+
+	if (image != NULL) {
+		eog_list_store_scan_queue_image (EOG_LIST_STORE (model), image);
+		g_object_unref (image);
+	}
+
+	return FALSE;
+}
+
+static gboolean
+eog_list_store_resort (gpointer user_data)
+{
+	EogListStore *store = EOG_LIST_STORE (user_data);
+	gint64 span;
+
+	store->priv->resort_id = 0;
+
+	span = eog_debug_trace_begin ();
+
+	/* Switching back to the default sort column sorts the store
+	 * again, with a single rows-reordered emission */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+					      GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+
+	eog_debug_trace_end ("Store resort", span);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+eog_list_store_queue_resort (EogListStore *store)
+{
+	if (store->priv->resort_id == 0) {
+		store->priv->resort_id =
+			g_timeout_add (EOG_LIST_STORE_RESORT_DELAY,
+				       eog_list_store_resort, store);
+	}
+}
+
+static void
+eog_list_store_scan_thread (GTask *task,
+			    gpointer source_object,
+			    gpointer task_data,
+			    GCancellable *cancellable)
+{
+	EogListStoreScan *scan = task_data;
+	EogMetadataRecordFields fields = 0;
+	EogMetadataRecord record;
+	gboolean found;
+
+	if (scan->sort_key == EOG_LIST_STORE_SORT_KEY_CAPTURE_DATE)
+		fields = EOG_METADATA_RECORD_EXIF;
+	else if (scan->sort_key == EOG_LIST_STORE_SORT_KEY_PIXEL_COUNT)
+		fields = EOG_METADATA_RECORD_DIMENSION;
+
+	found = eog_metadata_index_query (scan->file, fields, &record,
+					  &scan->data.mtime, &scan->data.size,
+					  cancellable);
+
+	if (found) {
+		if (record.fields & EOG_METADATA_RECORD_DIMENSION)
+			scan->data.pixels = (guint64) record.width * record.height;
+
+		scan->data.capture_date = g_steal_pointer (&record.capture_date);
+		eog_metadata_record_clear (&record);
+	}
+
+	g_task_return_boolean (task, found);
+}
+
+static void
+eog_list_store_scan_cb (GObject *source_object,
+			GAsyncResult *result,
+			gpointer user_data)
+{
+	EogListStoreScan *scan = user_data;
+	EogListStore *store = scan->store;
+	EogListStoreSortData *data = NULL;
+
+	/* Images removed in the meantime have no sort data anymore */
+	if (!g_cancellable_is_cancelled (scan->cancellable))
+		data = g_hash_table_lookup (store->priv->sort_data, scan->image);
+
+	if (data != NULL &&
+	    g_task_propagate_boolean (G_TASK (result), NULL)) {
+		data->size = scan->data.size;
+		data->mtime = scan->data.mtime;
+		data->pixels = scan->data.pixels;
+		g_free (data->capture_date);
+		data->capture_date = g_steal_pointer (&scan->data.capture_date);
+		data->ready = TRUE;
+
+		eog_list_store_queue_resort (store);
+	}
+
+	eog_list_store_scan_free (scan);
+
+	/* Cancelled reads still count until they are done, so that
+	 * reads queued since don't exceed the limit */
+	store->priv->n_scanners--;
+	eog_list_store_scan_start (store);
+
+	g_object_unref (store);
+}
+
+static void
+eog_list_store_scan_start (EogListStore *store)
+{
+	EogListStoreScan *scan;
+	GTask *task;
+
+	while (store->priv->n_scanners < EOG_LIST_STORE_MAX_SCANNERS &&
+	       (scan = g_queue_pop_head (&store->priv->scan_queue)) != NULL) {
+		store->priv->n_scanners++;
+
+		/* Released by the callback, which needs the store to
+		 * drain n_scanners even when cancelled */
+		g_object_ref (store);
+
+		task = g_task_new (NULL, scan->cancellable,
+				   eog_list_store_scan_cb, scan);
+		g_task_set_task_data (task, scan, NULL);
+		g_task_set_priority (task, G_PRIORITY_LOW);
+		g_task_run_in_thread (task, eog_list_store_scan_thread);
+		g_object_unref (task);
+	}
+}
+
+static gboolean
+eog_list_store_scan_start_idle (gpointer user_data)
+{
+	EogListStore *store = EOG_LIST_STORE (user_data);
+
+	store->priv->scan_idle_id = 0;
+	eog_list_store_scan_start (store);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Pending reads bail out on the cancelled cancellable, they are
+ * only taken off n_scanners once done */
+static void
+eog_list_store_scan_stop (EogListStore *store)
+{
+	if (store->priv->scan_idle_id != 0) {
+		g_source_remove (store->priv->scan_idle_id);
+		store->priv->scan_idle_id = 0;
+	}
+
+	if (store->priv->resort_id != 0) {
+		g_source_remove (store->priv->resort_id);
+		store->priv->resort_id = 0;
+	}
+
+	if (store->priv->scan_cancellable != NULL) {
+		g_cancellable_cancel (store->priv->scan_cancellable);
+		g_object_unref (store->priv->scan_cancellable);
+		store->priv->scan_cancellable = g_cancellable_new ();
+	}
+
+	g_queue_clear_full (&store->priv->scan_queue,
+			    (GDestroyNotify) eog_list_store_scan_free);
+
+	if (store->priv->sort_data != NULL)
+		g_hash_table_remove_all (store->priv->sort_data);
+}
+
 /**
  * eog_list_store_add_files:
  * @store: An #EogListStore.
@@ -677,6 +1341,13 @@ eog_list_store_append_directory (EogListStore *store,
  * only one file and this is a regular file, then all the images in the same
  * directory will be added as well to @store.
  *
+ * If the recursive-folders setting is enabled, subdirectories up to
+ * recursive-max-depth levels deep are enumerated asynchronously
+ * afterwards and their images are appended as they are found.
+ *
+ * The images are ordered by the sort-key setting, keys other than the
+ * file name are read in the background once the files are added.
+ *
  **/
 void
 eog_list_store_add_files (EogListStore *store, GList *file_list)
@@ -686,11 +1357,24 @@ eog_list_store_add_files (EogListStore *store, GList *file_list)
 	GFileType file_type;
 	GFile *initial_file = NULL;
 	GtkTreeIter iter;
+	GSettings *settings;
+	gint64 span;
 
 	if (file_list == NULL) {
 		return;
 	}
 
+	span = eog_debug_trace_begin ();
+
+	settings = g_settings_new (EOG_CONF_UI);
+	store->priv->recursive = g_settings_get_boolean (settings,
+							 EOG_CONF_UI_RECURSIVE_FOLDERS);
+	store->priv->max_depth = g_settings_get_int (settings,
+						     EOG_CONF_UI_RECURSIVE_MAX_DEPTH);
+	store->priv->sort_key = g_settings_get_enum (settings,
+						     EOG_CONF_UI_SORT_KEY);
+	g_object_unref (settings);
+
 	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
 					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
 					      GTK_SORT_ASCENDING);
@@ -775,6 +1459,26 @@ eog_list_store_add_files (EogListStore *store, GList *file_list)
 	} else {
 		store->priv->initial_image = 0;
 	}
+
+	/* This usually runs in the model job thread, so the subdirectories
+	 * are only enumerated once we are back in the main loop. */
+	if (!g_queue_is_empty (&store->priv->crawl_queue) &&
+	    store->priv->crawl_idle_id == 0) {
+		store->priv->crawl_idle_id =
+			g_idle_add_full (G_PRIORITY_LOW,
+					 eog_list_store_crawl_start_idle,
+					 store, NULL);
+	}
+
+	if (!g_queue_is_empty (&store->priv->scan_queue) &&
+	    store->priv->scan_idle_id == 0) {
+		store->priv->scan_idle_id =
+			g_idle_add_full (G_PRIORITY_LOW,
+					 eog_list_store_scan_start_idle,
+					 store, NULL);
+	}
+
+	eog_debug_trace_end ("Store add files", span);
 }
 
 /**
@@ -965,7 +1669,10 @@ eog_list_store_remove_thumbnail_job (EogListStore *store,
 }
 
 static void
-eog_list_store_add_thumbnail_job (EogListStore *store, GtkTreeIter *iter)
+eog_list_store_add_thumbnail_job (EogListStore *store,
+				  GtkTreeIter *iter,
+				  EogJobPriority priority,
+				  gboolean allow_preview)
 {
 	EogImage *image;
 	EogJob *job;
@@ -976,11 +1683,18 @@ eog_list_store_add_thumbnail_job (EogListStore *store, GtkTreeIter *iter)
 			    -1);
 
 	if (job != NULL) {
-		g_object_unref (image);
-		return;
+		if (job->priority <= priority) {
+			g_object_unref (image);
+			return;
+		}
+
+		/* The queued job would wait behind everything else
+		 * (e.g. a warming job), replace it with a more urgent one */
+		eog_list_store_remove_thumbnail_job (store, iter);
 	}
 
 	job = eog_job_thumbnail_new (image);
+	EOG_JOB_THUMBNAIL (job)->allow_preview = allow_preview;
 
 	g_signal_connect (job,
 			  "finished",
@@ -991,7 +1705,7 @@ eog_list_store_add_thumbnail_job (EogListStore *store, GtkTreeIter *iter)
 	gtk_list_store_set (GTK_LIST_STORE (store), iter,
 			    EOG_LIST_STORE_EOG_JOB, job,
 			    -1);
-	eog_job_scheduler_add_job (job);
+	eog_job_scheduler_add_job_with_priority (job, priority);
 	g_mutex_unlock (&store->priv->mutex);
 	g_object_unref (job);
 	g_object_unref (image);
@@ -1019,7 +1733,36 @@ eog_list_store_thumbnail_set (EogListStore *store,
 		return;
 	}
 
-	eog_list_store_add_thumbnail_job (store, iter);
+	eog_list_store_add_thumbnail_job (store, iter, EOG_JOB_PRIORITY_LOW, TRUE);
+}
+
+/**
+ * eog_list_store_thumbnail_warm:
+ * @store: An #EogListStore.
+ * @iter: A #GtkTreeIter pointing to an image in @store.
+ *
+ * Like eog_list_store_thumbnail_set(), but the thumbnail is only
+ * generated once the job scheduler has nothing more urgent to do.
+ *
+ * Returns: %TRUE if the thumbnail was already set.
+ **/
+gboolean
+eog_list_store_thumbnail_warm (EogListStore *store,
+			       GtkTreeIter *iter)
+{
+	gboolean thumb_set = FALSE;
+
+	gtk_tree_model_get (GTK_TREE_MODEL (store), iter,
+			    EOG_LIST_STORE_THUMB_SET, &thumb_set,
+			    -1);
+
+	if (thumb_set) {
+		return TRUE;
+	}
+
+	eog_list_store_add_thumbnail_job (store, iter, EOG_JOB_PRIORITY_IDLE, TRUE);
+
+	return FALSE;
 }
 
 /**
@@ -1064,5 +1807,54 @@ eog_list_store_thumbnail_refresh (EogListStore *store,
 				  GtkTreeIter *iter)
 {
 	eog_list_store_remove_thumbnail_job (store, iter);
-	eog_list_store_add_thumbnail_job (store, iter);
+	eog_list_store_add_thumbnail_job (store, iter, EOG_JOB_PRIORITY_LOW, FALSE);
+}
+
+/**
+ * eog_list_store_set_sort_key:
+ * @store: An #EogListStore.
+ * @sort_key: An #EogListStoreSortKey.
+ *
+ * Changes the order of the images in @store. Keys other than
+ * %EOG_LIST_STORE_SORT_KEY_NAME are read from the files in the
+ * background, and @store is reordered as they become known.
+ *
+ **/
+void
+eog_list_store_set_sort_key (EogListStore *store,
+			     EogListStoreSortKey sort_key)
+{
+	g_return_if_fail (EOG_IS_LIST_STORE (store));
+
+	if (store->priv->sort_key == sort_key)
+		return;
+
+	eog_list_store_scan_stop (store);
+
+	store->priv->sort_key = sort_key;
+
+	if (sort_key != EOG_LIST_STORE_SORT_KEY_NAME) {
+		gtk_tree_model_foreach (GTK_TREE_MODEL (store),
+					foreach_model_queue_scan, NULL);
+		eog_list_store_scan_start (store);
+	}
+
+	eog_list_store_resort (store);
+}
+
+/**
+ * eog_list_store_get_sort_key:
+ * @store: An #EogListStore.
+ *
+ * Gets the order of the images in @store.
+ *
+ * Returns: the current #EogListStoreSortKey.
+ **/
+EogListStoreSortKey
+eog_list_store_get_sort_key (EogListStore *store)
+{
+	g_return_val_if_fail (EOG_IS_LIST_STORE (store),
+			      EOG_LIST_STORE_SORT_KEY_NAME);
+
+	return store->priv->sort_key;
 }
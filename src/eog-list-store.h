@@ -47,6 +47,25 @@ typedef struct _EogListStorePrivate EogListStorePrivate;
 
 #define EOG_LIST_STORE_THUMB_SIZE 90
 
+/**
+ * EogListStoreSortKey:
+ * @EOG_LIST_STORE_SORT_KEY_NAME: Sort by file name
+ * @EOG_LIST_STORE_SORT_KEY_CAPTURE_DATE: Sort by EXIF DateTimeOriginal
+ * @EOG_LIST_STORE_SORT_KEY_FILE_SIZE: Sort by file size
+ * @EOG_LIST_STORE_SORT_KEY_MTIME: Sort by modification time
+ * @EOG_LIST_STORE_SORT_KEY_PIXEL_COUNT: Sort by width times height
+ *
+ * The order of the images in an #EogListStore. Images whose key is not
+ * known yet are kept behind the others, ties are ordered by file name.
+ */
+typedef enum {
+	EOG_LIST_STORE_SORT_KEY_NAME,
+	EOG_LIST_STORE_SORT_KEY_CAPTURE_DATE,
+	EOG_LIST_STORE_SORT_KEY_FILE_SIZE,
+	EOG_LIST_STORE_SORT_KEY_MTIME,
+	EOG_LIST_STORE_SORT_KEY_PIXEL_COUNT
+} EogListStoreSortKey;
+
 typedef enum {
 	EOG_LIST_STORE_THUMBNAIL = 0,
 	EOG_LIST_STORE_THUMB_SET,
@@ -103,10 +122,18 @@ gint            eog_list_store_get_initial_pos 	     (EogListStore *store);
 void            eog_list_store_thumbnail_set         (EogListStore *store,
 						      GtkTreeIter *iter);
 
+gboolean        eog_list_store_thumbnail_warm        (EogListStore *store,
+						      GtkTreeIter *iter);
+
 void            eog_list_store_thumbnail_unset       (EogListStore *store,
 						      GtkTreeIter *iter);
 
 void            eog_list_store_thumbnail_refresh     (EogListStore *store,
 						      GtkTreeIter *iter);
 
+void            eog_list_store_set_sort_key          (EogListStore *store,
+						      EogListStoreSortKey sort_key);
+
+EogListStoreSortKey eog_list_store_get_sort_key      (EogListStore *store);
+
 G_END_DECLS
@@ -0,0 +1,910 @@
+/* Eye Of GNOME -- Persistent Metadata Index
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Remembers the dimensions and the most used EXIF fields of images
+ * between sessions, so they don't have to be read from every file
+ * again when a folder is reopened.
+ *
+ * There is one index file per folder in the user's cache directory.
+ * Each is a serialized GVariant which is
+ * mapped into memory and read in place; records are only looked at
+ * when requested. Records are keyed by file name, and only used if
+ * the modification time and size of the file still match.
+ * Changes are kept in memory and written back shortly afterwards,
+ * from a worker thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "eog-metadata-index.h"
+#include "eog-dimension-probe.h"
+#include "eog-metadata-reader.h"
+#include "eog-util.h"
+#include "eog-debug.h"
+
+#ifdef HAVE_EXIF
+#include <libexif/exif-utils.h>
+#endif
+
+#define EOG_METADATA_INDEX_VERSION 1
+
+/* (mtime, size, fields, width, height, orientation, date, model, icc) */
+#define EOG_METADATA_INDEX_RECORD_TYPE "(ttyiiyssb)"
+#define EOG_METADATA_INDEX_FILE_TYPE   "(ua{s" EOG_METADATA_INDEX_RECORD_TYPE "})"
+
+/* Delay before changes are written to disk */
+#define EOG_METADATA_INDEX_FLUSH_DELAY 5
+
+/* Metadata blocks are expected near the start of the file, the limit
+ * only counts bytes read, not those seeked over */
+#define EOG_METADATA_INDEX_READ_BUFFER_SIZE 4096
+#define EOG_METADATA_INDEX_READ_LIMIT       (256 * 1024)
+
+typedef struct {
+	guint64           mtime;
+	guint64           size;
+	EogMetadataRecord record;
+} EogMetadataIndexEntry;
+
+typedef struct {
+	gchar       *path;       /* index file */
+	GMappedFile *mapped;
+	GVariant    *entries;    /* a{s(...)} in the mapped file, or NULL */
+	GHashTable  *positions;  /* file name -> position in entries */
+	GHashTable  *changes;    /* file name -> entry, or NULL if removed */
+} EogMetadataFolder;
+
+typedef struct {
+	gchar  *path;
+	GBytes *contents;
+} EogMetadataIndexWrite;
+
+static GMutex      index_mutex;
+static GCond       write_cond;
+static gchar      *index_dir = NULL;
+static GHashTable *folders = NULL;    /* folder URI -> EogMetadataFolder */
+static guint       flush_id = 0;
+static gboolean    writing = FALSE;   /* index files are being written */
+
+void
+eog_metadata_record_clear (EogMetadataRecord *record)
+{
+	g_clear_pointer (&record->capture_date, g_free);
+	g_clear_pointer (&record->camera_model, g_free);
+	record->fields = 0;
+}
+
+#ifdef HAVE_EXIF
+void
+eog_metadata_record_set_exif (EogMetadataRecord *record,
+			      ExifData *exif)
+{
+	ExifEntry *entry;
+	gchar buffer[64];
+
+	g_free (record->capture_date);
+	g_free (record->camera_model);
+	record->capture_date = record->camera_model = NULL;
+	record->orientation = 0;
+	record->fields |= EOG_METADATA_RECORD_EXIF;
+
+	if (exif == NULL)
+		return;
+
+	entry = exif_data_get_entry (exif, EXIF_TAG_ORIENTATION);
+	if (entry != NULL && entry->data != NULL)
+		record->orientation = exif_get_short (entry->data,
+						      exif_data_get_byte_order (exif));
+
+	if (eog_exif_data_get_value (exif, EXIF_TAG_DATE_TIME_ORIGINAL,
+				     buffer, sizeof (buffer)) != NULL)
+		record->capture_date = g_strdup (buffer);
+
+	if (eog_exif_data_get_value (exif, EXIF_TAG_MODEL,
+				     buffer, sizeof (buffer)) != NULL)
+		record->camera_model = g_utf8_make_valid (buffer, -1);
+}
+#endif
+
+static void
+eog_metadata_index_entry_free (EogMetadataIndexEntry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	eog_metadata_record_clear (&entry->record);
+	g_slice_free (EogMetadataIndexEntry, entry);
+}
+
+static void
+eog_metadata_folder_free (EogMetadataFolder *folder)
+{
+	g_hash_table_unref (folder->changes);
+	g_clear_pointer (&folder->positions, g_hash_table_unref);
+	g_clear_pointer (&folder->entries, g_variant_unref);
+	g_clear_pointer (&folder->mapped, g_mapped_file_unref);
+	g_free (folder->path);
+	g_slice_free (EogMetadataFolder, folder);
+}
+
+/* Must be called with index_mutex held */
+static void
+eog_metadata_folder_set_entries (EogMetadataFolder *folder,
+				 GVariant *index)
+{
+	GVariantIter iter;
+	GVariant *child;
+	guint position = 0;
+
+	g_clear_pointer (&folder->positions, g_hash_table_unref);
+	g_clear_pointer (&folder->entries, g_variant_unref);
+
+	folder->entries = g_variant_get_child_value (index, 1);
+	folder->positions = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   g_free, NULL);
+
+	g_variant_iter_init (&iter, folder->entries);
+	while ((child = g_variant_iter_next_value (&iter)) != NULL) {
+		gchar *key;
+
+		g_variant_get_child (child, 0, "s", &key);
+		g_hash_table_insert (folder->positions, key,
+				     GUINT_TO_POINTER (position++));
+		g_variant_unref (child);
+	}
+}
+
+static EogMetadataFolder *
+eog_metadata_folder_load (const gchar *folder_uri)
+{
+	EogMetadataFolder *folder;
+	GVariant *index;
+	GBytes *bytes;
+	gchar *name;
+	guint32 version;
+
+	folder = g_slice_new0 (EogMetadataFolder);
+	folder->changes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						 (GDestroyNotify) eog_metadata_index_entry_free);
+
+	name = g_compute_checksum_for_string (G_CHECKSUM_MD5, folder_uri, -1);
+	folder->path = g_strconcat (index_dir, G_DIR_SEPARATOR_S, name, ".index", NULL);
+	g_free (name);
+
+	folder->mapped = g_mapped_file_new (folder->path, FALSE, NULL);
+	if (folder->mapped == NULL)
+		return folder;
+
+	bytes = g_mapped_file_get_bytes (folder->mapped);
+	index = g_variant_new_from_bytes (G_VARIANT_TYPE (EOG_METADATA_INDEX_FILE_TYPE),
+					  bytes, FALSE);
+	g_bytes_unref (bytes);
+	g_variant_ref_sink (index);
+
+	g_variant_get_child (index, 0, "u", &version);
+
+	if (version == EOG_METADATA_INDEX_VERSION)
+		eog_metadata_folder_set_entries (folder, index);
+
+	g_variant_unref (index);
+
+	return folder;
+}
+
+/* Must be called with index_mutex held */
+static EogMetadataFolder *
+eog_metadata_index_get_folder (GFile *file, gchar **basename)
+{
+	EogMetadataFolder *folder;
+	GFile *parent;
+	gchar *folder_uri;
+
+	if (folders == NULL)
+		return NULL;
+
+	parent = g_file_get_parent (file);
+	if (parent == NULL)
+		return NULL;
+
+	folder_uri = g_file_get_uri (parent);
+	g_object_unref (parent);
+
+	folder = g_hash_table_lookup (folders, folder_uri);
+
+	if (folder == NULL) {
+		folder = eog_metadata_folder_load (folder_uri);
+		g_hash_table_insert (folders, folder_uri, folder);
+	} else {
+		g_free (folder_uri);
+	}
+
+	*basename = g_file_get_basename (file);
+
+	return folder;
+}
+
+static void
+eog_metadata_record_copy (const EogMetadataRecord *src,
+			  EogMetadataRecord *dest)
+{
+	*dest = *src;
+	dest->capture_date = g_strdup (src->capture_date);
+	dest->camera_model = g_strdup (src->camera_model);
+}
+
+static GVariant *
+eog_metadata_index_entry_to_variant (EogMetadataIndexEntry *entry)
+{
+	const EogMetadataRecord *record = &entry->record;
+
+	return g_variant_new (EOG_METADATA_INDEX_RECORD_TYPE,
+			      entry->mtime,
+			      entry->size,
+			      (guchar) record->fields,
+			      record->width,
+			      record->height,
+			      (guchar) record->orientation,
+			      record->capture_date ? record->capture_date : "",
+			      record->camera_model ? record->camera_model : "",
+			      record->has_icc_profile);
+}
+
+static void
+eog_metadata_index_entry_from_variant (GVariant *value,
+				       EogMetadataIndexEntry *entry)
+{
+	EogMetadataRecord *record = &entry->record;
+	const gchar *date, *model;
+	guchar fields, orientation;
+
+	g_variant_get (value, EOG_METADATA_INDEX_RECORD_TYPE,
+		       &entry->mtime,
+		       &entry->size,
+		       &fields,
+		       &record->width,
+		       &record->height,
+		       &orientation,
+		       &date,
+		       &model,
+		       &record->has_icc_profile);
+
+	record->fields = fields;
+	record->orientation = orientation;
+	record->capture_date = *date ? g_strdup (date) : NULL;
+	record->camera_model = *model ? g_strdup (model) : NULL;
+}
+
+/* Must be called with index_mutex held */
+static gboolean
+eog_metadata_folder_lookup (EogMetadataFolder *folder,
+			    const gchar *basename,
+			    EogMetadataIndexEntry *entry)
+{
+	EogMetadataIndexEntry *changed;
+	gpointer position;
+	GVariant *child, *value;
+
+	if (g_hash_table_lookup_extended (folder->changes, basename,
+					  NULL, (gpointer *) &changed)) {
+		if (changed == NULL)
+			return FALSE;
+
+		entry->mtime = changed->mtime;
+		entry->size = changed->size;
+		eog_metadata_record_copy (&changed->record, &entry->record);
+		return TRUE;
+	}
+
+	if (folder->positions == NULL ||
+	    !g_hash_table_lookup_extended (folder->positions, basename,
+					   NULL, &position))
+		return FALSE;
+
+	child = g_variant_get_child_value (folder->entries,
+					   GPOINTER_TO_UINT (position));
+	value = g_variant_get_child_value (child, 1);
+	eog_metadata_index_entry_from_variant (value, entry);
+	g_variant_unref (value);
+	g_variant_unref (child);
+
+	return TRUE;
+}
+
+/* Must be called with index_mutex held. Merges the changes into the
+ * records of @folder, which then match the returned file contents. */
+static GBytes *
+eog_metadata_folder_serialize (EogMetadataFolder *folder)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	GVariant *index;
+	GBytes *contents;
+	gpointer key, value;
+
+	g_variant_builder_init (&builder,
+				G_VARIANT_TYPE ("a{s" EOG_METADATA_INDEX_RECORD_TYPE "}"));
+
+	/* Unchanged records from the current file */
+	if (folder->positions != NULL) {
+		g_hash_table_iter_init (&iter, folder->positions);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GVariant *child;
+
+			if (g_hash_table_contains (folder->changes, key))
+				continue;
+
+			child = g_variant_get_child_value (folder->entries,
+							   GPOINTER_TO_UINT (value));
+			g_variant_builder_add_value (&builder, child);
+			g_variant_unref (child);
+		}
+	}
+
+	g_hash_table_iter_init (&iter, folder->changes);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (value == NULL)
+			continue;
+
+		g_variant_builder_add (&builder, "{s@" EOG_METADATA_INDEX_RECORD_TYPE "}",
+				       (const gchar *) key,
+				       eog_metadata_index_entry_to_variant (value));
+	}
+
+	index = g_variant_new ("(u@a{s" EOG_METADATA_INDEX_RECORD_TYPE "})",
+			       EOG_METADATA_INDEX_VERSION,
+			       g_variant_builder_end (&builder));
+	g_variant_ref_sink (index);
+
+	contents = g_variant_get_data_as_bytes (index);
+
+	/* The file isn't mapped again, the records are
+	 * read from the serialized index from now on */
+	eog_metadata_folder_set_entries (folder, index);
+	g_hash_table_remove_all (folder->changes);
+	g_clear_pointer (&folder->mapped, g_mapped_file_unref);
+
+	g_variant_unref (index);
+
+	return contents;
+}
+
+static void
+eog_metadata_index_write_free (EogMetadataIndexWrite *write)
+{
+	g_free (write->path);
+	g_bytes_unref (write->contents);
+	g_slice_free (EogMetadataIndexWrite, write);
+}
+
+static void
+eog_metadata_index_writes_free (GList *writes)
+{
+	g_list_free_full (writes, (GDestroyNotify) eog_metadata_index_write_free);
+}
+
+/* Must be called with index_mutex held */
+static GList *
+eog_metadata_index_serialize_changes (void)
+{
+	GHashTableIter iter;
+	EogMetadataFolder *folder;
+	GList *writes = NULL;
+
+	if (folders == NULL)
+		return NULL;
+
+	g_hash_table_iter_init (&iter, folders);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &folder)) {
+		EogMetadataIndexWrite *write;
+
+		if (g_hash_table_size (folder->changes) == 0)
+			continue;
+
+		write = g_slice_new (EogMetadataIndexWrite);
+		write->path = g_strdup (folder->path);
+		write->contents = eog_metadata_folder_serialize (folder);
+
+		writes = g_list_prepend (writes, write);
+	}
+
+	return writes;
+}
+
+static void
+eog_metadata_index_write_files (GList *writes)
+{
+	GList *it;
+
+	for (it = writes; it != NULL; it = it->next) {
+		EogMetadataIndexWrite *write = it->data;
+		GError *error = NULL;
+
+		if (!g_file_set_contents (write->path,
+					  g_bytes_get_data (write->contents, NULL),
+					  g_bytes_get_size (write->contents),
+					  &error)) {
+			eog_debug_message (DEBUG_IMAGE_DATA, "Couldn't write %s: %s",
+					   write->path, error->message);
+			g_clear_error (&error);
+		}
+	}
+}
+
+static void
+eog_metadata_index_write_thread (GTask        *task,
+				 gpointer      source_object,
+				 gpointer      task_data,
+				 GCancellable *cancellable)
+{
+	eog_metadata_index_write_files (task_data);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	writing = FALSE;
+	g_cond_broadcast (&write_cond);
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+}
+
+static void eog_metadata_index_queue_flush (void);
+
+static gboolean
+eog_metadata_index_flush (gpointer user_data)
+{
+	GList *writes;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	flush_id = 0;
+
+	/* Files are written one batch at a time, so an older
+	 * batch can never replace the contents of a newer one */
+	if (writing) {
+		eog_metadata_index_queue_flush ();
+	} else {
+		writes = eog_metadata_index_serialize_changes ();
+
+		if (writes != NULL) {
+			GTask *task;
+
+			writing = TRUE;
+
+			task = g_task_new (NULL, NULL, NULL, NULL);
+			g_task_set_task_data (task, writes,
+					      (GDestroyNotify) eog_metadata_index_writes_free);
+			g_task_run_in_thread (task, eog_metadata_index_write_thread);
+			g_object_unref (task);
+		}
+	}
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Must be called with index_mutex held */
+static void
+eog_metadata_index_queue_flush (void)
+{
+	if (flush_id == 0) {
+		flush_id = g_timeout_add_seconds (EOG_METADATA_INDEX_FLUSH_DELAY,
+						  eog_metadata_index_flush,
+						  NULL);
+	}
+}
+
+/**
+ * eog_metadata_index_init:
+ *
+ * Sets up the metadata index. Must be called from the main thread
+ * before any other eog_metadata_index_* function is used; lookups
+ * just fail until then.
+ **/
+void
+eog_metadata_index_init (void)
+{
+	if (folders != NULL)
+		return;
+
+	/* The index can always be rebuilt from the images, so it
+	 * belongs to the cache and not to eog_util_dot_dir() */
+	index_dir = g_build_filename (g_get_user_cache_dir (),
+				      "eog", "metadata-index", NULL);
+
+	if (g_mkdir_with_parents (index_dir, 0700) != 0) {
+		g_clear_pointer (&index_dir, g_free);
+		return;
+	}
+
+	folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					 (GDestroyNotify) eog_metadata_folder_free);
+}
+
+/**
+ * eog_metadata_index_shutdown:
+ *
+ * Writes pending changes to disk, and waits for them to be written.
+ **/
+void
+eog_metadata_index_shutdown (void)
+{
+	GList *writes;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	if (flush_id != 0) {
+		g_source_remove (flush_id);
+		flush_id = 0;
+	}
+
+	while (writing)
+		g_cond_wait (&write_cond, &index_mutex);
+
+	writes = eog_metadata_index_serialize_changes ();
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+
+	eog_metadata_index_write_files (writes);
+	eog_metadata_index_writes_free (writes);
+}
+
+/**
+ * eog_metadata_index_lookup:
+ * @file: the image file
+ * @mtime: the current modification time of @file
+ * @size: the current size of @file
+ * @record: (out caller-allocates): return location for the record
+ *
+ * Looks up the stored metadata of @file. Stale records, where
+ * @mtime or @size don't match anymore, are ignored.
+ *
+ * Returns: %TRUE if @record was filled, it must be cleared with
+ * eog_metadata_record_clear() afterwards.
+ **/
+gboolean
+eog_metadata_index_lookup (GFile             *file,
+			   guint64            mtime,
+			   guint64            size,
+			   EogMetadataRecord *record)
+{
+	EogMetadataFolder *folder;
+	EogMetadataIndexEntry entry = { 0, };
+	gchar *basename = NULL;
+	gboolean found = FALSE;
+
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (record != NULL, FALSE);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	folder = eog_metadata_index_get_folder (file, &basename);
+
+	if (folder != NULL)
+		found = eog_metadata_folder_lookup (folder, basename, &entry);
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+
+	g_free (basename);
+
+	if (found && (entry.mtime != mtime || entry.size != size)) {
+		eog_metadata_record_clear (&entry.record);
+		found = FALSE;
+	}
+
+	if (found)
+		*record = entry.record;
+
+	return found;
+}
+
+/**
+ * eog_metadata_index_store:
+ * @file: the image file
+ * @mtime: the modification time of @file when @record was read
+ * @size: the size of @file when @record was read
+ * @record: the metadata to remember
+ *
+ * Stores @record for @file. Fields not set in @record are kept
+ * from the previous record, as long as that one is still valid.
+ **/
+void
+eog_metadata_index_store (GFile                   *file,
+			  guint64                  mtime,
+			  guint64                  size,
+			  const EogMetadataRecord *record)
+{
+	EogMetadataFolder *folder;
+	EogMetadataIndexEntry *entry;
+	EogMetadataIndexEntry old = { 0, };
+	gchar *basename = NULL;
+
+	g_return_if_fail (G_IS_FILE (file));
+	g_return_if_fail (record != NULL);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	folder = eog_metadata_index_get_folder (file, &basename);
+
+	if (folder == NULL) {
+		g_mutex_unlock (&index_mutex);
+		return;
+	}
+
+	entry = g_slice_new0 (EogMetadataIndexEntry);
+	entry->mtime = mtime;
+	entry->size = size;
+
+	if (eog_metadata_folder_lookup (folder, basename, &old) &&
+	    old.mtime == mtime && old.size == size) {
+		entry->record = old.record;
+		old.record.capture_date = old.record.camera_model = NULL;
+	}
+	eog_metadata_record_clear (&old.record);
+
+	if (record->fields & EOG_METADATA_RECORD_DIMENSION) {
+		entry->record.width = record->width;
+		entry->record.height = record->height;
+	}
+
+	if (record->fields & EOG_METADATA_RECORD_EXIF) {
+		g_free (entry->record.capture_date);
+		g_free (entry->record.camera_model);
+		entry->record.orientation = record->orientation;
+		entry->record.capture_date = g_strdup (record->capture_date);
+		entry->record.camera_model = g_strdup (record->camera_model);
+		entry->record.has_icc_profile = record->has_icc_profile;
+	}
+
+	entry->record.fields |= record->fields;
+
+	g_hash_table_insert (folder->changes, basename, entry);
+
+	eog_metadata_index_queue_flush ();
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+}
+
+/**
+ * eog_metadata_index_invalidate:
+ * @file: a file that changed or went away
+ *
+ * Forgets the stored metadata of @file.
+ **/
+void
+eog_metadata_index_invalidate (GFile *file)
+{
+	EogMetadataFolder *folder;
+	EogMetadataIndexEntry entry = { 0, };
+	gchar *basename = NULL;
+
+	g_return_if_fail (G_IS_FILE (file));
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&index_mutex);
+
+	folder = eog_metadata_index_get_folder (file, &basename);
+
+	if (folder != NULL &&
+	    eog_metadata_folder_lookup (folder, basename, &entry)) {
+		eog_metadata_record_clear (&entry.record);
+		g_hash_table_insert (folder->changes, basename, NULL);
+		basename = NULL;
+		eog_metadata_index_queue_flush ();
+	}
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&index_mutex);
+
+	g_free (basename);
+}
+
+/* Feeds the start of the stream to a metadata reader, pixel data is
+ * never looked at */
+static void
+eog_metadata_index_read_exif (GInputStream *stream,
+			      EogMetadataRecord *record,
+			      GCancellable *cancellable)
+{
+	EogMetadataReader *md_reader = NULL;
+	guchar *buffer;
+	gssize bytes_read;
+	gsize total = 0;
+
+	buffer = g_malloc (EOG_METADATA_INDEX_READ_BUFFER_SIZE);
+
+	while (total < EOG_METADATA_INDEX_READ_LIMIT) {
+		bytes_read = g_input_stream_read (stream, buffer,
+						  EOG_METADATA_INDEX_READ_BUFFER_SIZE,
+						  cancellable, NULL);
+		if (bytes_read <= 0)
+			break;
+
+		if (total == 0 && bytes_read >= 2) {
+			if (buffer[0] == 0xFF && buffer[1] == 0xD8)
+				md_reader = eog_metadata_reader_new (EOG_METADATA_JPEG);
+			else if (bytes_read >= 8 &&
+				 memcmp (buffer, "\x89PNG\x0D\x0A\x1a\x0A", 8) == 0)
+				md_reader = eog_metadata_reader_new (EOG_METADATA_PNG);
+		}
+
+		if (md_reader == NULL)
+			break;
+
+		eog_metadata_reader_consume (md_reader, buffer, bytes_read);
+		total += bytes_read;
+
+		if (eog_metadata_reader_finished (md_reader))
+			break;
+
+		eog_metadata_reader_seek_ahead (md_reader, stream, cancellable);
+	}
+
+	g_free (buffer);
+
+	/* Formats without a metadata reader have no EXIF data either */
+	record->fields |= EOG_METADATA_RECORD_EXIF;
+
+	if (md_reader == NULL)
+		return;
+
+#ifdef HAVE_EXIF
+	{
+		ExifData *exif;
+
+		exif = eog_metadata_reader_get_exif_data (md_reader);
+		eog_metadata_record_set_exif (record, exif);
+		if (exif != NULL)
+			exif_data_unref (exif);
+	}
+#endif
+
+#ifdef HAVE_LCMS
+	{
+		cmsHPROFILE profile;
+
+		profile = eog_metadata_reader_get_icc_profile (md_reader);
+		record->has_icc_profile = (profile != NULL);
+		if (profile != NULL)
+			cmsCloseProfile (profile);
+	}
+#endif
+
+	g_object_unref (md_reader);
+}
+
+/**
+ * eog_metadata_index_query:
+ * @file: the image file
+ * @fields: the fields that are needed, or 0 for just @mtime and @size
+ * @record: (out caller-allocates): return location for the record
+ * @mtime: (out) (optional): return location for the modification time
+ * @size: (out) (optional): return location for the file size
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ *
+ * Like eog_metadata_index_lookup(), but reads the missing @fields from
+ * the file headers if there is no valid record with all of them, and
+ * updates the index afterwards. Image data is never decoded. This
+ * blocks, so it should only be called from a worker thread.
+ *
+ * Returns: %TRUE if @record was filled, it must be cleared with
+ * eog_metadata_record_clear() afterwards.
+ **/
+gboolean
+eog_metadata_index_query (GFile                   *file,
+			  EogMetadataRecordFields  fields,
+			  EogMetadataRecord       *record,
+			  guint64                 *mtime,
+			  guint64                 *size,
+			  GCancellable            *cancellable)
+{
+	GFileInfo *file_info;
+	GFileInputStream *stream;
+	EogMetadataRecord found = { 0, };
+	guint64 file_mtime, file_size;
+	gchar *mime_type;
+
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (record != NULL, FALSE);
+
+	file_info = g_file_query_info (file,
+				       G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				       G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				       G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+				       G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE,
+				       G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+	if (file_info == NULL)
+		return FALSE;
+
+	file_size = g_file_info_get_size (file_info);
+	file_mtime = g_file_info_get_attribute_uint64 (file_info,
+						       G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	mime_type = eog_util_get_mime_type_with_fallback (file_info);
+	g_object_unref (file_info);
+
+	if (mtime)
+		*mtime = file_mtime;
+	if (size)
+		*size = file_size;
+
+	memset (record, 0, sizeof (EogMetadataRecord));
+
+	if (fields == 0) {
+		g_free (mime_type);
+		return TRUE;
+	}
+
+	if (eog_metadata_index_lookup (file, file_mtime, file_size, &found)) {
+		if ((found.fields & fields) == fields) {
+			g_free (mime_type);
+			*record = found;
+			return TRUE;
+		}
+		eog_metadata_record_clear (&found);
+	}
+
+	stream = g_file_read (file, cancellable, NULL);
+	if (stream == NULL) {
+		g_free (mime_type);
+		return FALSE;
+	}
+
+	if ((fields & EOG_METADATA_RECORD_DIMENSION) &&
+	    eog_dimension_probe_supports_mime_type (mime_type) &&
+	    eog_dimension_probe (G_INPUT_STREAM (stream),
+				 &record->width, &record->height,
+				 cancellable)) {
+		record->fields |= EOG_METADATA_RECORD_DIMENSION;
+	}
+
+	if (fields & EOG_METADATA_RECORD_EXIF) {
+		if (g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET,
+				     cancellable, NULL)) {
+			eog_metadata_index_read_exif (G_INPUT_STREAM (stream),
+						      record, cancellable);
+		}
+	}
+
+	g_object_unref (stream);
+	g_free (mime_type);
+
+	if (record->fields == 0 || g_cancellable_is_cancelled (cancellable)) {
+		eog_metadata_record_clear (record);
+		return FALSE;
+	}
+
+	eog_metadata_index_store (file, file_mtime, file_size, record);
+
+	return TRUE;
+}
@@ -0,0 +1,86 @@
+/* Eye Of GNOME -- Persistent Metadata Index
+ *
+ * Copyright (C) 2026 The Free Software Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#ifdef HAVE_EXIF
+#include <libexif/exif-data.h>
+#endif
+
+G_BEGIN_DECLS
+
+typedef enum {
+	EOG_METADATA_RECORD_DIMENSION = 1 << 0,
+	EOG_METADATA_RECORD_EXIF      = 1 << 1
+} EogMetadataRecordFields;
+
+typedef struct {
+	EogMetadataRecordFields fields;
+
+	/* EOG_METADATA_RECORD_DIMENSION */
+	gint      width;
+	gint      height;
+
+	/* EOG_METADATA_RECORD_EXIF */
+	gint      orientation;
+	gchar    *capture_date;    /* DateTimeOriginal, "YYYY:MM:DD HH:MM:SS" */
+	gchar    *camera_model;
+	gboolean  has_icc_profile;
+} EogMetadataRecord;
+
+G_GNUC_INTERNAL
+void      eog_metadata_index_init       (void);
+
+G_GNUC_INTERNAL
+void      eog_metadata_index_shutdown   (void);
+
+G_GNUC_INTERNAL
+gboolean  eog_metadata_index_lookup     (GFile             *file,
+					 guint64            mtime,
+					 guint64            size,
+					 EogMetadataRecord *record);
+
+G_GNUC_INTERNAL
+void      eog_metadata_index_store      (GFile                   *file,
+					 guint64                  mtime,
+					 guint64                  size,
+					 const EogMetadataRecord *record);
+
+G_GNUC_INTERNAL
+void      eog_metadata_index_invalidate (GFile *file);
+
+G_GNUC_INTERNAL
+gboolean  eog_metadata_index_query      (GFile                   *file,
+					 EogMetadataRecordFields  fields,
+					 EogMetadataRecord       *record,
+					 guint64                 *mtime,
+					 guint64                 *size,
+					 GCancellable            *cancellable);
+
+G_GNUC_INTERNAL
+void      eog_metadata_record_clear     (EogMetadataRecord *record);
+
+#ifdef HAVE_EXIF
+G_GNUC_INTERNAL
+void      eog_metadata_record_set_exif  (EogMetadataRecord *record,
+					 ExifData          *exif);
+#endif
+
+G_END_DECLS
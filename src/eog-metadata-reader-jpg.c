@@ -159,6 +159,24 @@ eog_metadata_reader_jpg_finished (EogMetadataReaderJpg *emr)
 	return (emr->priv->state == EMR_FINISHED);
 }
 
+static gsize
+eog_metadata_reader_jpg_get_skip_length (EogMetadataReaderJpg *emr)
+{
+	EogMetadataReaderJpgPrivate *priv = emr->priv;
+
+	return (priv->state == EMR_SKIP_BYTES) ? priv->size : 0;
+}
+
+static void
+eog_metadata_reader_jpg_skip (EogMetadataReaderJpg *emr, gsize len)
+{
+	EogMetadataReaderJpgPrivate *priv = emr->priv;
+
+	priv->size -= len;
+
+	if (priv->size == 0)
+		priv->state = EMR_READ;
+}
 
 static EogJpegApp1Type
 eog_metadata_identify_app1 (gchar *buf, guint len)
@@ -658,6 +676,12 @@ eog_metadata_reader_jpg_init_emr_iface (gpointer g_iface, gpointer iface_data)
 	iface->finished =
 		(gboolean (*) (EogMetadataReader *self))
 			eog_metadata_reader_jpg_finished;
+	iface->get_skip_length =
+		(gsize (*) (EogMetadataReader *self))
+			eog_metadata_reader_jpg_get_skip_length;
+	iface->skip =
+		(void (*) (EogMetadataReader *self, gsize len))
+			eog_metadata_reader_jpg_skip;
 	iface->get_raw_exif =
 		(void (*) (EogMetadataReader *self, guchar **data, guint *len))
 			eog_metadata_reader_jpg_get_exif_chunk;
@@ -152,6 +152,26 @@ eog_metadata_reader_png_finished (EogMetadataReaderPng *emr)
 	return (emr->priv->state == EMR_FINISHED);
 }
 
+/* IDAT and other chunks without metadata are skipped as a whole,
+ * so a seekable stream doesn't need to be read up to IEND */
+static gsize
+eog_metadata_reader_png_get_skip_length (EogMetadataReaderPng *emr)
+{
+	EogMetadataReaderPngPrivate *priv = emr->priv;
+
+	return (priv->state == EMR_SKIP_BYTES) ? priv->size : 0;
+}
+
+static void
+eog_metadata_reader_png_skip (EogMetadataReaderPng *emr, gsize len)
+{
+	EogMetadataReaderPngPrivate *priv = emr->priv;
+
+	priv->size -= len;
+
+	if (priv->size == 0)
+		priv->state = EMR_READ_SIZE_HIGH_HIGH_BYTE;
+}
 
 static void
 eog_metadata_reader_png_get_next_block (EogMetadataReaderPngPrivate* priv,
@@ -654,6 +674,12 @@ eog_metadata_reader_png_init_emr_iface (gpointer g_iface, gpointer iface_data)
 	iface->finished =
 		(gboolean (*) (EogMetadataReader *self))
 			eog_metadata_reader_png_finished;
+	iface->get_skip_length =
+		(gsize (*) (EogMetadataReader *self))
+			eog_metadata_reader_png_get_skip_length;
+	iface->skip =
+		(void (*) (EogMetadataReader *self, gsize len))
+			eog_metadata_reader_png_skip;
 #ifdef HAVE_LCMS
 	iface->get_icc_profile =
 		(cmsHPROFILE (*) (EogMetadataReader *self))
@@ -28,6 +28,9 @@
 #include "eog-metadata-reader-png.h"
 #include "eog-debug.h"
 
+/* Skipped data shorter than this is read anyway */
+#define EOG_METADATA_READER_SEEK_THRESHOLD 1024
+
 G_DEFINE_INTERFACE (EogMetadataReader, eog_metadata_reader, G_TYPE_INVALID)
 
 EogMetadataReader*
@@ -65,6 +68,84 @@ eog_metadata_reader_consume (EogMetadataReader *self, const guchar *buf, guint l
 	EOG_METADATA_READER_GET_IFACE (self)->consume (self, buf, len);
 }
 
+/**
+ * eog_metadata_reader_get_skip_length:
+ * @self: an #EogMetadataReader
+ *
+ * Gets the number of bytes following the data consumed so far that
+ * @self is going to discard anyway, e.g. the rest of a JPEG segment or
+ * a PNG chunk without metadata. Instead of feeding them to
+ * eog_metadata_reader_consume(), callers can move on in the file and
+ * report that with eog_metadata_reader_skip().
+ *
+ * Returns: the number of bytes that can be skipped, or 0.
+ **/
+gsize
+eog_metadata_reader_get_skip_length (EogMetadataReader *self)
+{
+	g_return_val_if_fail (EOG_IS_METADATA_READER (self), 0);
+
+	return EOG_METADATA_READER_GET_IFACE (self)->get_skip_length (self);
+}
+
+/**
+ * eog_metadata_reader_skip:
+ * @self: an #EogMetadataReader
+ * @len: the number of bytes that were skipped
+ *
+ * Tells @self that the next @len bytes won't be consumed. @len must not
+ * be larger than what eog_metadata_reader_get_skip_length() returned.
+ **/
+void
+eog_metadata_reader_skip (EogMetadataReader *self, gsize len)
+{
+	g_return_if_fail (EOG_IS_METADATA_READER (self));
+	g_return_if_fail (len <= eog_metadata_reader_get_skip_length (self));
+
+	EOG_METADATA_READER_GET_IFACE (self)->skip (self, len);
+}
+
+/**
+ * eog_metadata_reader_seek_ahead:
+ * @self: an #EogMetadataReader
+ * @stream: the stream @self is being fed from
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ *
+ * Seeks @stream past the bytes @self would discard, if there are
+ * enough of them and @stream supports seeking. This must only be used
+ * if nothing else needs to see the skipped data.
+ *
+ * Returns: the number of bytes skipped.
+ **/
+goffset
+eog_metadata_reader_seek_ahead (EogMetadataReader *self,
+				GInputStream      *stream,
+				GCancellable      *cancellable)
+{
+	gsize len;
+
+	g_return_val_if_fail (EOG_IS_METADATA_READER (self), 0);
+	g_return_val_if_fail (G_IS_INPUT_STREAM (stream), 0);
+
+	len = eog_metadata_reader_get_skip_length (self);
+
+	/* Reading small gaps is cheaper than seeking over them */
+	if (len < EOG_METADATA_READER_SEEK_THRESHOLD ||
+	    !G_IS_SEEKABLE (stream) ||
+	    !g_seekable_can_seek (G_SEEKABLE (stream)))
+		return 0;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), len, G_SEEK_CUR,
+			      cancellable, NULL))
+		return 0;
+
+	eog_debug_message (DEBUG_IMAGE_DATA, "Seeked over %" G_GSIZE_FORMAT " bytes", len);
+
+	eog_metadata_reader_skip (self, len);
+
+	return len;
+}
+
 /* Returns the raw exif data. NOTE: The caller of this function becomes
  * the new owner of this piece of memory and is responsible for freeing it!
  */
@@ -85,9 +166,33 @@ eog_metadata_reader_get_exif_data (EogMetadataReader *self)
 #endif
 
 #ifdef HAVE_EXEMPI
+static gsize xmp_initialized = 0;
+
+/* Exempi is set up on first use instead of during startup, as it is
+ * only needed once an image with XMP data is read. This may happen in
+ * any thread. */
+void
+eog_metadata_reader_xmp_init (void)
+{
+	if (g_once_init_enter (&xmp_initialized)) {
+		eog_debug_message (DEBUG_IMAGE_DATA, "Initializing exempi");
+		xmp_init ();
+		g_once_init_leave (&xmp_initialized, 1);
+	}
+}
+
+void
+eog_metadata_reader_xmp_shutdown (void)
+{
+	if (xmp_initialized != 0)
+		xmp_terminate ();
+}
+
 XmpPtr
 eog_metadata_reader_get_xmp_data (EogMetadataReader *self)
 {
+	eog_metadata_reader_xmp_init ();
+
 	return EOG_METADATA_READER_GET_IFACE (self)->get_xmp_ptr (self);
 }
 #endif
@@ -120,6 +225,18 @@ _eog_metadata_reader_default_get_null (EogMetadataReader *self)
 	return NULL;
 }
 
+/* Default vfuncs for readers that never skip data */
+static gsize
+_eog_metadata_reader_default_get_skip_length (EogMetadataReader *self)
+{
+	return 0;
+}
+
+static void
+_eog_metadata_reader_default_skip (EogMetadataReader *self, gsize len)
+{
+}
+
 static void
 eog_metadata_reader_default_init (EogMetadataReaderInterface *iface)
 {
@@ -129,4 +246,6 @@ eog_metadata_reader_default_init (EogMetadataReaderInterface *iface)
 	iface->get_exif_data = _eog_metadata_reader_default_get_null;
 	iface->get_icc_profile = _eog_metadata_reader_default_get_null;
 	iface->get_xmp_ptr = _eog_metadata_reader_default_get_null;
+	iface->get_skip_length = _eog_metadata_reader_default_get_skip_length;
+	iface->skip = _eog_metadata_reader_default_skip;
 }
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #ifdef HAVE_EXIF
 #include "eog-exif-util.h"
 #endif
@@ -47,6 +48,11 @@ struct _EogMetadataReaderInterface {
 
 	gboolean	(*finished)		(EogMetadataReader *self);
 
+	gsize		(*get_skip_length)	(EogMetadataReader *self);
+
+	void		(*skip)			(EogMetadataReader *self,
+						 gsize len);
+
 	void		(*get_raw_exif)		(EogMetadataReader *self,
 						 guchar **data,
 						 guint *len);
@@ -74,6 +80,18 @@ void                 eog_metadata_reader_consume	(EogMetadataReader *self,
 G_GNUC_INTERNAL
 gboolean             eog_metadata_reader_finished	(EogMetadataReader *self);
 
+G_GNUC_INTERNAL
+gsize                eog_metadata_reader_get_skip_length (EogMetadataReader *self);
+
+G_GNUC_INTERNAL
+void                 eog_metadata_reader_skip		(EogMetadataReader *self,
+							 gsize              len);
+
+G_GNUC_INTERNAL
+goffset              eog_metadata_reader_seek_ahead	(EogMetadataReader *self,
+							 GInputStream      *stream,
+							 GCancellable      *cancellable);
+
 G_GNUC_INTERNAL
 void                 eog_metadata_reader_get_exif_chunk (EogMetadataReader  *self,
 							 guchar            **data,
@@ -87,6 +105,12 @@ ExifData*         eog_metadata_reader_get_exif_data	(EogMetadataReader *self);
 #ifdef HAVE_EXEMPI
 G_GNUC_INTERNAL
 XmpPtr	     	     eog_metadata_reader_get_xmp_data	(EogMetadataReader *self);
+
+G_GNUC_INTERNAL
+void                 eog_metadata_reader_xmp_init	(void);
+
+G_GNUC_INTERNAL
+void                 eog_metadata_reader_xmp_shutdown	(void);
 #endif
 
 #ifdef HAVE_LCMS
@@ -27,10 +27,13 @@
 #endif
 
 #include "eog-plugin-engine.h"
+#include "eog-application.h"
 #include "eog-debug.h"
 #include "eog-config-keys.h"
 #include "eog-util.h"
+#include "eog-window.h"
 
+#include <string.h>
 #include <glib/gi18n.h>
 #include <glib.h>
 #include <gio/gio.h>
@@ -38,23 +41,65 @@
 
 #define EOG_PLUGIN_DATA_DIR EOG_DATA_DIR G_DIR_SEPARATOR_S "plugins"
 
+/* Plugins listing triggers under X-Eog-Activate-On in their .plugin
+ * file are only loaded once one of them fires. A trigger is either a
+ * window or application action ("win.name", "app.name"), or a signal
+ * of the window, its image view or its gallery ("window::signal",
+ * "view::signal", "thumbview::signal"). */
+#define EOG_PLUGIN_ACTIVATE_ON_KEY "Eog-Activate-On"
+
 struct _EogPluginEnginePrivate {
     GSettings *plugins_settings;
+
+    /* module name -> PeasPluginInfo, active but not loaded yet */
+    GHashTable *deferred_plugins;
+
+    /* set while loading the plugins from the settings */
+    gboolean syncing;
 };
 
+typedef struct {
+	GClosure         closure;
+	EogPluginEngine *engine;
+	PeasPluginInfo  *info;
+
+	/* set if the trigger is a placeholder for a plugin's action */
+	GActionMap      *stub_map;
+	gchar           *action_name;
+} EogPluginTrigger;
+
 G_DEFINE_TYPE_WITH_PRIVATE (EogPluginEngine, eog_plugin_engine, PEAS_TYPE_ENGINE);
 
+static void on_load_plugin   (PeasEngine      *peas_engine,
+			      PeasPluginInfo  *info,
+			      EogPluginEngine *engine);
+static void on_unload_plugin (PeasEngine      *peas_engine,
+			      PeasPluginInfo  *info,
+			      EogPluginEngine *engine);
+
 static void
 eog_plugin_engine_dispose (GObject *object)
 {
 	EogPluginEngine *engine = EOG_PLUGIN_ENGINE (object);
 
+	/* PeasEngine unloads the plugins when disposed, which must
+	 * neither touch the state cleared below nor be stored as the
+	 * user disabling them */
+	g_signal_handlers_disconnect_by_func (engine, on_load_plugin, engine);
+	g_signal_handlers_disconnect_by_func (engine, on_unload_plugin, engine);
+
 	if (engine->priv->plugins_settings != NULL)
 	{
 		g_object_unref (engine->priv->plugins_settings);
 		engine->priv->plugins_settings = NULL;
 	}
 
+	if (engine->priv->deferred_plugins != NULL)
+	{
+		g_hash_table_destroy (engine->priv->deferred_plugins);
+		engine->priv->deferred_plugins = NULL;
+	}
+
 	G_OBJECT_CLASS (eog_plugin_engine_parent_class)->dispose (object);
 }
 
@@ -74,6 +119,315 @@ eog_plugin_engine_init (EogPluginEngine *engine)
 	engine->priv = eog_plugin_engine_get_instance_private (engine);
 
 	engine->priv->plugins_settings = g_settings_new ("org.gnome.eog.plugins");
+	engine->priv->deferred_plugins = g_hash_table_new (g_str_hash, g_str_equal);
+	engine->priv->syncing = FALSE;
+}
+
+/* Mirrors the plugins set in the settings. Plugins that can be loaded
+ * on demand are only deferred on startup, and stay deferred until
+ * triggered. */
+static void
+eog_plugin_engine_sync_plugins (EogPluginEngine *engine,
+				gboolean         allow_deferral)
+{
+	EogPluginEnginePrivate *priv = engine->priv;
+	const GList *l;
+	gchar **active;
+
+	active = g_settings_get_strv (priv->plugins_settings,
+				      EOG_CONF_PLUGINS_ACTIVE_PLUGINS);
+
+	priv->syncing = TRUE;
+
+	for (l = peas_engine_get_plugin_list (PEAS_ENGINE (engine)); l != NULL; l = l->next) {
+		PeasPluginInfo *info = (PeasPluginInfo *) l->data;
+		const gchar *module = peas_plugin_info_get_module_name (info);
+
+		if (!g_strv_contains ((const gchar * const *) active, module)) {
+			g_hash_table_remove (priv->deferred_plugins, module);
+
+			if (peas_plugin_info_is_loaded (info))
+				peas_engine_unload_plugin (PEAS_ENGINE (engine), info);
+		} else if (!peas_plugin_info_is_loaded (info) &&
+			   !g_hash_table_contains (priv->deferred_plugins, module)) {
+			if (allow_deferral &&
+			    peas_plugin_info_get_external_data (info, EOG_PLUGIN_ACTIVATE_ON_KEY) != NULL) {
+				eog_debug_message (DEBUG_PLUGINS,
+						   "Deferring plugin %s", module);
+				g_hash_table_insert (priv->deferred_plugins,
+						     (gpointer) module, info);
+			} else {
+				peas_engine_load_plugin (PEAS_ENGINE (engine), info);
+			}
+		}
+	}
+
+	priv->syncing = FALSE;
+
+	g_strfreev (active);
+}
+
+static void
+on_active_plugins_changed (GSettings       *settings,
+			   const gchar     *key,
+			   EogPluginEngine *engine)
+{
+	eog_plugin_engine_sync_plugins (engine, FALSE);
+}
+
+/* Keeps the settings up to date when plugins are toggled elsewhere,
+ * e.g. in the plugin manager */
+static void
+eog_plugin_engine_store_plugin (EogPluginEngine *engine,
+				PeasPluginInfo  *info,
+				gboolean         active)
+{
+	EogPluginEnginePrivate *priv = engine->priv;
+	const gchar *module = peas_plugin_info_get_module_name (info);
+	GPtrArray *plugins;
+	gchar **old_plugins;
+	gchar **it;
+
+	if (priv->syncing)
+		return;
+
+	old_plugins = g_settings_get_strv (priv->plugins_settings,
+					   EOG_CONF_PLUGINS_ACTIVE_PLUGINS);
+
+	if (active == g_strv_contains ((const gchar * const *) old_plugins, module)) {
+		g_strfreev (old_plugins);
+		return;
+	}
+
+	plugins = g_ptr_array_new ();
+
+	for (it = old_plugins; *it != NULL; it++) {
+		if (strcmp (*it, module) != 0)
+			g_ptr_array_add (plugins, *it);
+	}
+
+	if (active)
+		g_ptr_array_add (plugins, (gpointer) module);
+
+	g_ptr_array_add (plugins, NULL);
+
+	g_settings_set_strv (priv->plugins_settings,
+			     EOG_CONF_PLUGINS_ACTIVE_PLUGINS,
+			     (const gchar * const *) plugins->pdata);
+
+	g_ptr_array_free (plugins, TRUE);
+	g_strfreev (old_plugins);
+}
+
+static void
+on_load_plugin (PeasEngine      *peas_engine,
+		PeasPluginInfo  *info,
+		EogPluginEngine *engine)
+{
+	g_hash_table_remove (engine->priv->deferred_plugins,
+			     peas_plugin_info_get_module_name (info));
+
+	if (peas_plugin_info_is_loaded (info))
+		eog_plugin_engine_store_plugin (engine, info, TRUE);
+}
+
+static void
+on_unload_plugin (PeasEngine      *peas_engine,
+		  PeasPluginInfo  *info,
+		  EogPluginEngine *engine)
+{
+	eog_plugin_engine_store_plugin (engine, info, FALSE);
+}
+
+static void
+eog_plugin_engine_load_deferred_plugin (EogPluginEngine *engine,
+					PeasPluginInfo  *info)
+{
+	const gchar *module = peas_plugin_info_get_module_name (info);
+
+	if (!g_hash_table_remove (engine->priv->deferred_plugins, module))
+		return;
+
+	eog_debug_message (DEBUG_PLUGINS, "Loading plugin %s on demand", module);
+
+	peas_engine_load_plugin (PEAS_ENGINE (engine), info);
+}
+
+static void
+eog_plugin_trigger_marshal (GClosure     *closure,
+			    GValue       *return_value,
+			    guint         n_param_values,
+			    const GValue *param_values,
+			    gpointer      invocation_hint,
+			    gpointer      marshal_data)
+{
+	EogPluginTrigger *trigger = (EogPluginTrigger *) closure;
+	GObject *instance = g_value_get_object (&param_values[0]);
+
+	/* Triggers only fire once, keep everything alive meanwhile */
+	g_object_ref (instance);
+	g_closure_ref (closure);
+	g_signal_handlers_disconnect_matched (instance,
+					      G_SIGNAL_MATCH_CLOSURE,
+					      0, 0, closure, NULL, NULL);
+
+	eog_plugin_engine_load_deferred_plugin (trigger->engine, trigger->info);
+
+	if (trigger->stub_map != NULL) {
+		GAction *action;
+
+		action = g_action_map_lookup_action (trigger->stub_map,
+						     trigger->action_name);
+
+		if (action == G_ACTION (instance)) {
+			/* the plugin didn't provide the action */
+			g_action_map_remove_action (trigger->stub_map,
+						    trigger->action_name);
+		} else if (action != NULL) {
+			g_action_activate (action,
+					   n_param_values > 1 ?
+					   g_value_get_variant (&param_values[1]) : NULL);
+		}
+	}
+
+	g_closure_unref (closure);
+	g_object_unref (instance);
+}
+
+static void
+eog_plugin_trigger_finalize (gpointer  data,
+			     GClosure *closure)
+{
+	EogPluginTrigger *trigger = (EogPluginTrigger *) closure;
+
+	g_free (trigger->action_name);
+}
+
+static void
+eog_plugin_engine_connect_trigger (EogPluginEngine *engine,
+				   EogWindow       *window,
+				   PeasPluginInfo  *info,
+				   const gchar     *trigger_str)
+{
+	EogPluginTrigger *trigger;
+	GClosure *closure;
+	GActionMap *stub_map = NULL;
+	GObject *target = NULL;
+	const gchar *signal = NULL;
+
+	if (g_str_has_prefix (trigger_str, "win.") ||
+	    g_str_has_prefix (trigger_str, "app.")) {
+		GActionMap *map;
+		GAction *action;
+
+		if (trigger_str[0] == 'w')
+			map = G_ACTION_MAP (window);
+		else
+			map = G_ACTION_MAP (EOG_APP);
+
+		action = g_action_map_lookup_action (map, trigger_str + 4);
+
+		if (action == NULL) {
+			/* The plugin provides this action itself, stand
+			 * in for it until the plugin is loaded */
+			action = G_ACTION (g_simple_action_new (trigger_str + 4, NULL));
+			g_action_map_add_action (map, action);
+			g_object_unref (action);
+			stub_map = map;
+		}
+
+		target = G_OBJECT (action);
+		signal = "activate";
+	} else if (g_str_has_prefix (trigger_str, "window::")) {
+		target = G_OBJECT (window);
+		signal = trigger_str + strlen ("window::");
+	} else if (g_str_has_prefix (trigger_str, "view::")) {
+		target = G_OBJECT (eog_window_get_view (window));
+		signal = trigger_str + strlen ("view::");
+	} else if (g_str_has_prefix (trigger_str, "thumbview::")) {
+		target = G_OBJECT (eog_window_get_thumb_view (window));
+		signal = trigger_str + strlen ("thumbview::");
+	}
+
+	if (target == NULL ||
+	    !g_signal_parse_name (signal, G_OBJECT_TYPE (target), NULL, NULL, TRUE)) {
+		g_warning ("Invalid activation trigger '%s' for plugin %s",
+			   trigger_str, peas_plugin_info_get_module_name (info));
+		return;
+	}
+
+	closure = g_closure_new_simple (sizeof (EogPluginTrigger), NULL);
+	g_closure_set_marshal (closure, eog_plugin_trigger_marshal);
+	g_closure_add_finalize_notifier (closure, NULL, eog_plugin_trigger_finalize);
+
+	trigger = (EogPluginTrigger *) closure;
+	trigger->engine = engine;
+	trigger->info = info;
+	trigger->stub_map = stub_map;
+	trigger->action_name = (stub_map != NULL ? g_strdup (trigger_str + 4) : NULL);
+
+	g_signal_connect_closure (target, signal, closure, FALSE);
+}
+
+/**
+ * eog_plugin_engine_connect_triggers:
+ * @engine: an #EogPluginEngine
+ * @window: a new #EogWindow
+ *
+ * Connects the activation triggers of all deferred plugins to @window,
+ * loading each plugin the first time one of its triggers fires.
+ **/
+void
+eog_plugin_engine_connect_triggers (EogPluginEngine *engine,
+				    EogWindow       *window)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (EOG_IS_PLUGIN_ENGINE (engine));
+	g_return_if_fail (EOG_IS_WINDOW (window));
+
+	g_hash_table_iter_init (&iter, engine->priv->deferred_plugins);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		PeasPluginInfo *info = (PeasPluginInfo *) value;
+		gchar **triggers;
+		gchar **it;
+
+		triggers = g_strsplit (peas_plugin_info_get_external_data (info, EOG_PLUGIN_ACTIVATE_ON_KEY),
+				       ";", -1);
+
+		for (it = triggers; *it != NULL; it++) {
+			g_strstrip (*it);
+
+			if (**it != '\0')
+				eog_plugin_engine_connect_trigger (engine, window, info, *it);
+		}
+
+		g_strfreev (triggers);
+	}
+}
+
+/**
+ * eog_plugin_engine_load_deferred_plugins:
+ * @engine: an #EogPluginEngine
+ *
+ * Loads all active plugins still waiting for a trigger, e.g. before
+ * showing the plugin manager.
+ **/
+void
+eog_plugin_engine_load_deferred_plugins (EogPluginEngine *engine)
+{
+	GList *plugins, *l;
+
+	g_return_if_fail (EOG_IS_PLUGIN_ENGINE (engine));
+
+	plugins = g_hash_table_get_values (engine->priv->deferred_plugins);
+
+	for (l = plugins; l != NULL; l = l->next)
+		eog_plugin_engine_load_deferred_plugin (engine, (PeasPluginInfo *) l->data);
+
+	g_list_free (plugins);
 }
 
 EogPluginEngine *
@@ -155,11 +509,16 @@ eog_plugin_engine_new (void)
 	peas_engine_add_search_path (PEAS_ENGINE (engine),
 				     EOG_PLUGIN_DIR, EOG_PLUGIN_DATA_DIR);
 
-	g_settings_bind (engine->priv->plugins_settings,
-			 EOG_CONF_PLUGINS_ACTIVE_PLUGINS,
-			 engine,
-			 "loaded-plugins",
-			 G_SETTINGS_BIND_DEFAULT);
+	eog_plugin_engine_sync_plugins (engine, TRUE);
+
+	g_signal_connect (engine->priv->plugins_settings,
+			  "changed::" EOG_CONF_PLUGINS_ACTIVE_PLUGINS,
+			  G_CALLBACK (on_active_plugins_changed),
+			  engine);
+	g_signal_connect_after (engine, "load-plugin",
+				G_CALLBACK (on_load_plugin), engine);
+	g_signal_connect_after (engine, "unload-plugin",
+				G_CALLBACK (on_unload_plugin), engine);
 
 	g_free (user_plugin_path);
 
@@ -28,6 +28,8 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include "eog-window.h"
+
 G_BEGIN_DECLS
 
 typedef struct _EogPluginEngine EogPluginEngine;
@@ -56,4 +58,11 @@ GType eog_plugin_engine_get_type (void) G_GNUC_CONST;
 G_GNUC_INTERNAL
 EogPluginEngine* eog_plugin_engine_new (void);
 
+G_GNUC_INTERNAL
+void             eog_plugin_engine_connect_triggers      (EogPluginEngine *engine,
+							  EogWindow       *window);
+
+G_GNUC_INTERNAL
+void             eog_plugin_engine_load_deferred_plugins (EogPluginEngine *engine);
+
 G_END_DECLS
@@ -27,6 +27,7 @@
 #endif
 
 #include "eog-preferences-dialog.h"
+#include "eog-application-internal.h"
 #include "eog-scroll-view.h"
 #include "eog-util.h"
 #include "eog-config-keys.h"
@@ -301,6 +302,10 @@ eog_preferences_dialog_init (EogPreferencesDialog *pref_dlg)
 			 scale_adjustment, "value",
 			 G_SETTINGS_BIND_DEFAULT);
 
+	/* Show the real state of plugins that are still waiting
+	 * to be triggered */
+	eog_plugin_engine_load_deferred_plugins (EOG_APP->priv->plugin_engine);
+
 	gtk_widget_show_all (priv->plugin_manager);
 
 }
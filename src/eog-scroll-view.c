@@ -3,6 +3,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdkkeysyms.h>
@@ -16,6 +17,7 @@
 #include "eog-enum-types.h"
 #include "eog-scroll-view.h"
 #include "eog-debug.h"
+#include "eog-thumbnail.h"
 #include "zoom.h"
 
 /* Maximum zoom factor */
@@ -49,6 +51,13 @@
 /* from cairo-image-surface.c */
 #define MAX_IMAGE_SIZE 32767
 
+/* Rows rendered at once by the high quality pass, between checks
+ * whether the result is still needed */
+#define HQ_RENDER_BAND_HEIGHT 128
+
+/* Number of frames the rolling paint/latency percentiles are computed over */
+#define FRAME_STATS_SAMPLES 240
+
 /* Signal IDs */
 enum {
 	SIGNAL_ZOOM_CHANGED,
@@ -73,6 +82,11 @@ typedef enum {
 	N_EOG_ROTATIONS
 } EogRotationState;
 
+typedef enum {
+	PROGRESSIVE_NONE,
+	PROGRESSIVE_LOADING
+} EogProgressiveState;
+
 typedef enum {
 	EOG_PAN_ACTION_NONE,
 	EOG_PAN_ACTION_NEXT,
@@ -102,6 +116,21 @@ enum {
 	PROP_VSCROLL_POLICY
 };
 
+/* The high quality rendering of the visible part of the image, as done by
+ * a worker thread.  The parameters tell which frame it is valid for. */
+typedef struct {
+	EogScrollView *view;
+	GCancellable *cancellable;
+	cairo_surface_t *source;
+	cairo_surface_t *result;
+	int width, height;
+	int xofs, yofs;
+	int scaled_width, scaled_height;
+	int scale;              /* of the window, result is in device pixels */
+	double zoom;
+	cairo_filter_t filter;
+} EogScrollViewHQRender;
+
 /* Private part of the EogScrollView structure */
 struct _EogScrollViewPrivate {
 	/* some widgets we rely on */
@@ -116,9 +145,22 @@ struct _EogScrollViewPrivate {
 	EogImage *image;
 	guint image_changed_id;
 	guint frame_changed_id;
+	guint area_updated_id;
 	GdkPixbuf *pixbuf;
 	cairo_surface_t *surface;
 
+	/* whether the image is still being decoded */
+	EogProgressiveState progressive_state;
+#ifdef HAVE_LCMS
+	/* owned by the window, the decoded parts are converted to it */
+	cmsHPROFILE display_profile;
+#endif
+
+	/* the image's thumbnail, stretched over the parts not decoded yet */
+	cairo_surface_t *preview;
+	int preview_width, preview_height;
+	int preview_image_width, preview_image_height;
+
 	/* zoom mode, either ZOOM_MODE_FIT or ZOOM_MODE_FREE */
 	EogZoomMode zoom_mode;
 
@@ -182,10 +224,37 @@ struct _EogScrollViewPrivate {
 	/* Two-pass filtering */
 	GSource *hq_redraw_timeout_source;
 	gboolean force_unfiltered;
+	EogScrollViewHQRender *hq_render;
+	EogScrollViewHQRender *hq_result;
+
+	/* The image as last drawn to the visible area, so that redraws and
+	 * small pans can reuse the pixels which were scaled already */
+	cairo_surface_t *viewport;
+	int viewport_width, viewport_height;
+	int viewport_xofs, viewport_yofs;
+	int viewport_scale;
+	double viewport_zoom;
+	cairo_filter_t viewport_filter;
+
+	/* Frame statistics, times in microseconds.  The sample arrays
+	 * are ring buffers indexed by the respective counter. */
+	gint64 paint_samples[FRAME_STATS_SAMPLES];
+	gint64 latency_samples[FRAME_STATS_SAMPLES];
+	guint n_frames;
+	guint n_latencies;
+	guint n_unfiltered;
+	cairo_filter_t last_filter;
+	gint64 input_time;
+	gboolean input_painted;
+	gboolean show_frame_stats;
+	GdkFrameClock *frame_clock;
+	gulong after_paint_id;
 };
 
 static void scroll_by (EogScrollView *view, int xofs, int yofs);
 static void set_zoom_fit (EogScrollView *view);
+static void _clear_hq_render (EogScrollView *view);
+static void _clear_viewport (EogScrollView *view);
 /* static void request_paint_area (EogScrollView *view, GdkRectangle *area); */
 static void set_minimum_zoom_factor (EogScrollView *view);
 static void view_on_drag_begin_cb (GtkWidget *widget, GdkDragContext *context,
@@ -254,6 +323,18 @@ free_image_resources (EogScrollView *view)
 		priv->frame_changed_id = 0;
 	}
 
+	if (priv->area_updated_id > 0) {
+		g_signal_handler_disconnect (G_OBJECT (priv->image), priv->area_updated_id);
+		priv->area_updated_id = 0;
+	}
+
+	priv->progressive_state = PROGRESSIVE_NONE;
+
+	if (priv->preview != NULL) {
+		cairo_surface_destroy (priv->preview);
+		priv->preview = NULL;
+	}
+
 	if (priv->image != NULL) {
 		eog_image_data_unref (priv->image);
 		priv->image = NULL;
@@ -268,21 +349,44 @@ free_image_resources (EogScrollView *view)
 		cairo_surface_destroy (priv->surface);
 		priv->surface = NULL;
 	}
+
+	_clear_hq_render (view);
+	_clear_viewport (view);
 }
 
-/* Computes the size in pixels of the scaled image */
-static void
-compute_scaled_size (EogScrollView *view, double zoom, int *width, int *height)
+/* Gets the size of the image, which is only known from its preview until
+ * the loader got to it.  Returns FALSE if there is nothing to show. */
+static gboolean
+get_image_size (EogScrollView *view, int *width, int *height)
 {
 	EogScrollViewPrivate *priv;
 
 	priv = view->priv;
 
 	if (priv->pixbuf) {
-		*width = floor (gdk_pixbuf_get_width (priv->pixbuf) * zoom + 0.5);
-		*height = floor (gdk_pixbuf_get_height (priv->pixbuf) * zoom + 0.5);
-	} else
+		*width = gdk_pixbuf_get_width (priv->pixbuf);
+		*height = gdk_pixbuf_get_height (priv->pixbuf);
+	} else if (priv->preview) {
+		*width = priv->preview_image_width;
+		*height = priv->preview_image_height;
+	} else {
 		*width = *height = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Computes the size in pixels of the scaled image */
+static void
+compute_scaled_size (EogScrollView *view, double zoom, int *width, int *height)
+{
+	int image_width, image_height;
+
+	get_image_size (view, &image_width, &image_height);
+
+	*width = floor (image_width * zoom + 0.5);
+	*height = floor (image_height * zoom + 0.5);
 }
 
 /* Computes the offsets for the new zoom value so that they keep the image
@@ -535,6 +639,174 @@ create_background_surface (EogScrollView *view)
 	return surface;
 }
 
+/* =======================================
+
+    frame statistics
+
+    --------------------------------------*/
+
+/* Remembers when the first not yet painted scroll or zoom request came in,
+ * so the latency until it reaches the screen can be measured. */
+static void
+frame_stats_note_input (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	if (priv->input_time == 0) {
+		priv->input_time = g_get_monotonic_time ();
+		priv->input_painted = FALSE;
+	}
+}
+
+static void
+frame_stats_add_paint (EogScrollView *view, gint64 duration,
+                       cairo_filter_t filter, gboolean unfiltered)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	priv->paint_samples[priv->n_frames % FRAME_STATS_SAMPLES] = duration;
+	priv->n_frames++;
+	priv->last_filter = filter;
+	if (unfiltered)
+		priv->n_unfiltered++;
+
+	if (priv->input_time != 0)
+		priv->input_painted = TRUE;
+}
+
+/* Called once the frame clock has finished painting a frame; only then has
+ * the pending input actually been drawn to the window. */
+static void
+frame_clock_after_paint_cb (GdkFrameClock *clock, gpointer data)
+{
+	EogScrollViewPrivate *priv = EOG_SCROLL_VIEW (data)->priv;
+
+	if (priv->input_time == 0 || !priv->input_painted)
+		return;
+
+	priv->latency_samples[priv->n_latencies % FRAME_STATS_SAMPLES] =
+		g_get_monotonic_time () - priv->input_time;
+	priv->n_latencies++;
+	priv->input_time = 0;
+	priv->input_painted = FALSE;
+}
+
+static void
+display_realize_cb (GtkWidget *widget, gpointer data)
+{
+	EogScrollViewPrivate *priv = EOG_SCROLL_VIEW (data)->priv;
+
+	priv->frame_clock = gtk_widget_get_frame_clock (widget);
+	if (priv->frame_clock == NULL)
+		return;
+
+	g_object_ref (priv->frame_clock);
+	priv->after_paint_id =
+		g_signal_connect (priv->frame_clock, "after-paint",
+		                  G_CALLBACK (frame_clock_after_paint_cb), data);
+}
+
+static void
+display_unrealize_cb (GtkWidget *widget, gpointer data)
+{
+	EogScrollViewPrivate *priv = EOG_SCROLL_VIEW (data)->priv;
+
+	if (priv->frame_clock == NULL)
+		return;
+
+	g_signal_handler_disconnect (priv->frame_clock, priv->after_paint_id);
+	priv->after_paint_id = 0;
+	g_clear_object (&priv->frame_clock);
+	priv->input_time = 0;
+}
+
+static int
+compare_samples (gconstpointer a, gconstpointer b)
+{
+	gint64 sa = *(const gint64 *) a;
+	gint64 sb = *(const gint64 *) b;
+
+	return (sa > sb) - (sa < sb);
+}
+
+/* Computes the 50th, 95th and 99th percentile in milliseconds */
+static void
+frame_stats_percentiles (const gint64 *samples, guint count,
+                         gdouble *p50, gdouble *p95, gdouble *p99)
+{
+	gint64 sorted[FRAME_STATS_SAMPLES];
+	guint n = MIN (count, FRAME_STATS_SAMPLES);
+
+	if (n == 0) {
+		*p50 = *p95 = *p99 = 0.0;
+		return;
+	}
+
+	memcpy (sorted, samples, n * sizeof (gint64));
+	qsort (sorted, n, sizeof (gint64), compare_samples);
+
+	*p50 = sorted[(n - 1) * 50 / 100] / 1000.0;
+	*p95 = sorted[(n - 1) * 95 / 100] / 1000.0;
+	*p99 = sorted[(n - 1) * 99 / 100] / 1000.0;
+}
+
+static const gchar *
+filter_to_string (cairo_filter_t filter)
+{
+	switch (filter) {
+	case CAIRO_FILTER_FAST:
+		return "fast";
+	case CAIRO_FILTER_GOOD:
+		return "good";
+	case CAIRO_FILTER_BEST:
+		return "best";
+	case CAIRO_FILTER_NEAREST:
+		return "nearest";
+	case CAIRO_FILTER_BILINEAR:
+		return "bilinear";
+	case CAIRO_FILTER_GAUSSIAN:
+		return "gaussian";
+	default:
+		return "unknown";
+	}
+}
+
+static void
+draw_frame_stats (EogScrollView *view, cairo_t *cr)
+{
+	EogScrollViewFrameStats stats;
+	PangoLayout *layout;
+	gchar *text;
+	int width, height;
+
+	eog_scroll_view_get_frame_stats (view, &stats);
+
+	text = g_strdup_printf ("paint  p50 %.1f  p95 %.1f  p99 %.1f ms\n"
+	                        "input  p50 %.1f  p95 %.1f  p99 %.1f ms\n"
+	                        "filter %s, %u of %u frames unfiltered",
+	                        stats.paint_p50, stats.paint_p95,
+	                        stats.paint_p99,
+	                        stats.latency_p50, stats.latency_p95,
+	                        stats.latency_p99,
+	                        filter_to_string (stats.filter),
+	                        stats.n_unfiltered, stats.n_frames);
+
+	layout = pango_cairo_create_layout (cr);
+	pango_layout_set_text (layout, text, -1);
+	pango_layout_get_pixel_size (layout, &width, &height);
+
+	cairo_set_source_rgba (cr, 0.0, 0.0, 0.0, 0.7);
+	cairo_rectangle (cr, 6, 6, width + 12, height + 12);
+	cairo_fill (cr);
+
+	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+	cairo_move_to (cr, 12, 12);
+	pango_cairo_show_layout (cr, layout);
+
+	g_object_unref (layout);
+	g_free (text);
+}
+
 /* =======================================
 
     scrolling stuff
@@ -567,12 +839,19 @@ scroll_to (EogScrollView *view, int x, int y, gboolean change_adjustments)
 	priv->xofs = x;
 	priv->yofs = y;
 
+	_clear_hq_render (view);
+
 	if (!gtk_widget_is_drawable (priv->display))
 		goto out;
 
+	frame_stats_note_input (view);
+
 	gtk_widget_get_allocation (GTK_WIDGET (priv->display), &allocation);
 
-	if (abs (xofs) >= allocation.width || abs (yofs) >= allocation.height) {
+	/* The stats overlay is pinned to the window, so it can't be scrolled
+	 * along with the image. */
+	if (abs (xofs) >= allocation.width || abs (yofs) >= allocation.height
+	    || priv->show_frame_stats) {
 		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 		goto out;
 	}
@@ -655,10 +934,15 @@ drag_to (EogScrollView *view, int x, int y)
 static void
 set_minimum_zoom_factor (EogScrollView *view)
 {
+	int width, height;
+
 	g_return_if_fail (EOG_IS_SCROLL_VIEW (view));
 
-	view->priv->min_zoom = MAX (1.0 / gdk_pixbuf_get_width (view->priv->pixbuf),
-	                            MAX(1.0 / gdk_pixbuf_get_height (view->priv->pixbuf),
+	if (!get_image_size (view, &width, &height))
+		return;
+
+	view->priv->min_zoom = MAX (1.0 / width,
+	                            MAX(1.0 / height,
 	                                MIN_ZOOM_FACTOR) );
 	return;
 }
@@ -689,7 +973,7 @@ set_zoom (EogScrollView *view, double zoom,
 
 	priv = view->priv;
 
-	if (priv->pixbuf == NULL)
+	if (priv->pixbuf == NULL && priv->preview == NULL)
 		return;
 
 	if (zoom > MAX_ZOOM_FACTOR)
@@ -735,10 +1019,13 @@ set_zoom (EogScrollView *view, double zoom,
 	else
 		priv->zoom = zoom;
 
+	_clear_hq_render (view);
+
 	/* we make use of the new values here */
 	update_adjustment_values (view);
 
 	/* repaint the whole image */
+	frame_stats_note_input (view);
 	gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 
 	g_signal_emit (view, view_signals [SIGNAL_ZOOM_CHANGED], 0, priv->zoom);
@@ -751,6 +1038,7 @@ set_zoom_fit (EogScrollView *view)
 	EogScrollViewPrivate *priv;
 	GtkAllocation allocation;
 	double new_zoom;
+	int width, height;
 
 	priv = view->priv;
 
@@ -759,14 +1047,13 @@ set_zoom_fit (EogScrollView *view)
 	if (!gtk_widget_get_mapped (GTK_WIDGET (view)))
 		return;
 
-	if (priv->pixbuf == NULL)
+	if (!get_image_size (view, &width, &height))
 		return;
 
 	gtk_widget_get_allocation (GTK_WIDGET(priv->display), &allocation);
 
 	new_zoom = zoom_fit_scale (allocation.width, allocation.height,
-	                           gdk_pixbuf_get_width (priv->pixbuf),
-	                           gdk_pixbuf_get_height (priv->pixbuf),
+	                           width, height,
 	                           priv->upscale);
 
 	if (new_zoom > MAX_ZOOM_FACTOR)
@@ -1034,14 +1321,348 @@ eog_scroll_view_focus_out_event (GtkWidget     *widget,
 	return FALSE;
 }
 
-static gboolean _hq_redraw_cb (gpointer user_data)
+static void
+hq_render_free (EogScrollViewHQRender *render)
+{
+	g_object_unref (render->cancellable);
+	cairo_surface_destroy (render->source);
+	if (render->result != NULL)
+		cairo_surface_destroy (render->result);
+	g_free (render);
+}
+
+/* Cancels a pending high quality pass and drops the last result, needed
+ * whenever the image or the part of it on screen changes */
+static void
+_clear_hq_render (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	/* Freed by hq_render_cb() once the worker is done with it */
+	if (priv->hq_render != NULL) {
+		g_cancellable_cancel (priv->hq_render->cancellable);
+		priv->hq_render = NULL;
+	}
+
+	if (priv->hq_result != NULL) {
+		hq_render_free (priv->hq_result);
+		priv->hq_result = NULL;
+	}
+}
+
+static void
+_clear_viewport (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	if (priv->viewport != NULL) {
+		cairo_surface_destroy (priv->viewport);
+		priv->viewport = NULL;
+	}
+}
+
+/* Paints the part of the image which ends up in @area.  Only the matching
+ * part of the surface is handed to cairo, instead of letting it go
+ * through the whole of it. */
+static void
+paint_image_area (EogScrollView *view, cairo_t *cr,
+                  const cairo_rectangle_int_t *area,
+                  int xofs, int yofs, cairo_filter_t filter)
 {
-	EogScrollViewPrivate *priv = EOG_SCROLL_VIEW (user_data)->priv;
+	EogScrollViewPrivate *priv = view->priv;
+	cairo_surface_t *sub;
+	double zoom = priv->zoom;
+	int width, height, margin;
+	int x0, y0, x1, y1;
+
+	width = gdk_pixbuf_get_width (priv->pixbuf);
+	height = gdk_pixbuf_get_height (priv->pixbuf);
+
+	/* Filters look at the neighbouring pixels, at a whole
+	 * box of them when scaling down */
+	margin = (int) ceil (1.0 / zoom) + 2;
+
+	x0 = MAX (0, (int) floor ((area->x - xofs) / zoom) - margin);
+	y0 = MAX (0, (int) floor ((area->y - yofs) / zoom) - margin);
+	x1 = MIN (width, (int) ceil ((area->x + area->width - xofs) / zoom) + margin);
+	y1 = MIN (height, (int) ceil ((area->y + area->height - yofs) / zoom) + margin);
+
+	if (x1 <= x0 || y1 <= y0)
+		return;
+
+	/* Images too large for cairo only have a placeholder surface */
+	if (width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE)
+		sub = cairo_surface_reference (priv->surface);
+	else
+		sub = cairo_surface_create_for_rectangle (priv->surface,
+		                                          x0, y0,
+		                                          x1 - x0, y1 - y0);
+
+	cairo_save (cr);
+	cairo_rectangle (cr, area->x, area->y, area->width, area->height);
+	cairo_clip (cr);
+	cairo_scale (cr, zoom, zoom);
+	if (width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE)
+		cairo_set_source_surface (cr, sub, xofs / zoom, yofs / zoom);
+	else
+		cairo_set_source_surface (cr, sub, xofs / zoom + x0, yofs / zoom + y0);
+	cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+	if (is_zoomed_in (view) || is_zoomed_out (view))
+		cairo_pattern_set_filter (cairo_get_source (cr), filter);
+	cairo_paint (cr);
+	cairo_restore (cr);
+
+	cairo_surface_destroy (sub);
+}
+
+static gboolean
+viewport_matches (EogScrollView *view, int xofs, int yofs,
+                  GtkAllocation *allocation)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	return (priv->viewport != NULL &&
+	        DOUBLE_EQUAL (priv->viewport_zoom, priv->zoom) &&
+	        priv->viewport_scale == gtk_widget_get_scale_factor (priv->display) &&
+	        priv->viewport_xofs == xofs && priv->viewport_yofs == yofs &&
+	        priv->viewport_width == allocation->width &&
+	        priv->viewport_height == allocation->height);
+}
+
+/* Renders the current frame into the viewport cache.  When the image was
+ * only panned a bit since the last one, the pixels still visible are moved
+ * over and just the newly exposed strips are scaled. */
+static void
+update_viewport (EogScrollView *view, int xofs, int yofs,
+                 int scaled_width, int scaled_height,
+                 GtkAllocation *allocation, cairo_filter_t filter)
+{
+	EogScrollViewPrivate *priv = view->priv;
+	cairo_rectangle_int_t bounds = { 0, 0, allocation->width, allocation->height };
+	cairo_rectangle_int_t rect;
+	cairo_surface_t *viewport;
+	cairo_region_t *exposed;
+	cairo_t *cr;
+	int dx, dy, i, scale;
+
+	/* Rendered in device pixels, as when painting to the window */
+	scale = gtk_widget_get_scale_factor (priv->display);
+	viewport = gdk_window_create_similar_image_surface (
+	                gtk_widget_get_window (priv->display),
+	                CAIRO_FORMAT_ARGB32,
+	                allocation->width * scale,
+	                allocation->height * scale,
+	                scale);
+	cr = cairo_create (viewport);
+	cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
+	cairo_clip (cr);
+
+	exposed = cairo_region_create_rectangle (&bounds);
+
+	if (priv->viewport != NULL &&
+	    DOUBLE_EQUAL (priv->viewport_zoom, priv->zoom) &&
+	    priv->viewport_scale == scale &&
+	    priv->viewport_width == allocation->width &&
+	    priv->viewport_height == allocation->height) {
+		dx = xofs - priv->viewport_xofs;
+		dy = yofs - priv->viewport_yofs;
+
+		/* Don't mix unfiltered pixels into a high quality frame */
+		if (abs (dx) < allocation->width && abs (dy) < allocation->height &&
+		    (priv->viewport_filter == filter || filter == CAIRO_FILTER_NEAREST)) {
+			cairo_set_source_surface (cr, priv->viewport, dx, dy);
+			cairo_paint (cr);
+
+			rect.x = dx;
+			rect.y = dy;
+			rect.width = allocation->width;
+			rect.height = allocation->height;
+			cairo_region_subtract_rectangle (exposed, &rect);
+
+		}
+	}
+
+	for (i = 0; i < cairo_region_num_rectangles (exposed); i++) {
+		cairo_region_get_rectangle (exposed, i, &rect);
+		paint_image_area (view, cr, &rect, xofs, yofs, filter);
+	}
+
+	cairo_region_destroy (exposed);
+	cairo_destroy (cr);
+
+	_clear_viewport (view);
+	priv->viewport = viewport;
+	priv->viewport_width = allocation->width;
+	priv->viewport_height = allocation->height;
+	priv->viewport_xofs = xofs;
+	priv->viewport_yofs = yofs;
+	priv->viewport_scale = scale;
+	priv->viewport_zoom = priv->zoom;
+	priv->viewport_filter = filter;
+}
+
+static void
+hq_render_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+	EogScrollViewHQRender *render = task_data;
+	cairo_surface_t *source;
+	cairo_t *cr;
+	int y;
+
+	/* Share the pixels, but not the surface the main thread uses */
+	source = cairo_image_surface_create_for_data (
+	                cairo_image_surface_get_data (render->source),
+	                cairo_image_surface_get_format (render->source),
+	                cairo_image_surface_get_width (render->source),
+	                cairo_image_surface_get_height (render->source),
+	                cairo_image_surface_get_stride (render->source));
+
+	render->result = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+	                                             render->width * render->scale,
+	                                             render->height * render->scale);
+	cairo_surface_set_device_scale (render->result,
+	                                render->scale, render->scale);
+
+	cr = cairo_create (render->result);
+	cairo_rectangle (cr, render->xofs, render->yofs,
+	                 render->scaled_width, render->scaled_height);
+	cairo_clip (cr);
+
+	for (y = 0; y < render->height; y += HQ_RENDER_BAND_HEIGHT) {
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+
+		cairo_save (cr);
+		cairo_rectangle (cr, 0, y, render->width, HQ_RENDER_BAND_HEIGHT);
+		cairo_clip (cr);
+		cairo_scale (cr, render->zoom, render->zoom);
+		cairo_set_source_surface (cr, source,
+		                          render->xofs / render->zoom,
+		                          render->yofs / render->zoom);
+		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+		cairo_pattern_set_filter (cairo_get_source (cr), render->filter);
+		cairo_paint (cr);
+		cairo_restore (cr);
+	}
+
+	cairo_destroy (cr);
+	cairo_surface_destroy (source);
+
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	cairo_surface_flush (render->result);
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+hq_render_cb (GObject      *source_object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+	EogScrollViewHQRender *render = user_data;
+	EogScrollViewPrivate *priv;
+
+	/* The view may be gone already */
+	if (g_cancellable_is_cancelled (render->cancellable) ||
+	    !g_task_propagate_boolean (G_TASK (result), NULL)) {
+		hq_render_free (render);
+		return;
+	}
+
+	priv = render->view->priv;
+	priv->hq_render = NULL;
+
+	if (priv->hq_result != NULL)
+		hq_render_free (priv->hq_result);
+	priv->hq_result = render;
 
-	priv->force_unfiltered = FALSE;
 	gtk_widget_queue_draw (GTK_WIDGET (priv->display));
+}
+
+/* Renders the visible part of the image with the high quality filter
+ * in a worker, so the main thread only has to blit the result. */
+static gboolean
+start_hq_render (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+	EogScrollViewHQRender *render;
+	GtkAllocation allocation;
+	GTask *task;
+
+	/* The loader still writes to the surface while decoding */
+	if (priv->surface == NULL ||
+	    priv->progressive_state != PROGRESSIVE_NONE ||
+	    cairo_surface_get_type (priv->surface) != CAIRO_SURFACE_TYPE_IMAGE)
+		return FALSE;
+
+	_clear_hq_render (view);
+
+	gtk_widget_get_allocation (GTK_WIDGET (priv->display), &allocation);
+
+	render = g_new0 (EogScrollViewHQRender, 1);
+	render->view = view;
+	render->cancellable = g_cancellable_new ();
+	render->source = cairo_surface_reference (priv->surface);
+	render->width = allocation.width;
+	render->height = allocation.height;
+	render->scale = gtk_widget_get_scale_factor (priv->display);
+	render->zoom = priv->zoom;
+	render->filter = is_zoomed_in (view) ? priv->interp_type_in
+	                                     : priv->interp_type_out;
+	eog_scroll_view_get_image_coords (view, &render->xofs, &render->yofs,
+	                                  &render->scaled_width,
+	                                  &render->scaled_height);
+
+	cairo_surface_flush (priv->surface);
+
+	task = g_task_new (NULL, render->cancellable, hq_render_cb, render);
+	g_task_set_task_data (task, render, NULL);
+	g_task_run_in_thread (task, hq_render_thread);
+	g_object_unref (task);
+
+	priv->hq_render = render;
+
+	return TRUE;
+}
+
+/* Whether the last high quality pass can be used for the current frame */
+static gboolean
+hq_render_matches (EogScrollView *view, int xofs, int yofs,
+                   GtkAllocation *allocation)
+{
+	EogScrollViewHQRender *render = view->priv->hq_result;
+	cairo_filter_t filter;
+
+	if (render == NULL)
+		return FALSE;
+
+	filter = is_zoomed_in (view) ? view->priv->interp_type_in
+	                             : view->priv->interp_type_out;
+
+	return (DOUBLE_EQUAL (render->zoom, view->priv->zoom) &&
+	        render->xofs == xofs && render->yofs == yofs &&
+	        render->width == allocation->width &&
+	        render->height == allocation->height &&
+	        render->scale == gtk_widget_get_scale_factor (view->priv->display) &&
+	        render->filter == filter);
+}
+
+static gboolean _hq_redraw_cb (gpointer user_data)
+{
+	EogScrollView *view = EOG_SCROLL_VIEW (user_data);
+	EogScrollViewPrivate *priv = view->priv;
 
 	priv->hq_redraw_timeout_source = NULL;
+
+	if (!start_hq_render (view)) {
+		priv->force_unfiltered = FALSE;
+		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
+	}
+
 	return G_SOURCE_REMOVE;
 }
 
@@ -1082,6 +1703,10 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 	GtkAllocation allocation;
 	int scaled_width, scaled_height;
 	int xofs, yofs;
+	gint64 span, paint_start;
+	/* SVGs are rendered by librsvg at the target scale */
+	cairo_filter_t filter = CAIRO_FILTER_BEST;
+	gboolean unfiltered = FALSE;
 
 	g_return_val_if_fail (GTK_IS_DRAWING_AREA (widget), FALSE);
 	g_return_val_if_fail (EOG_IS_SCROLL_VIEW (data), FALSE);
@@ -1090,9 +1715,12 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 
 	priv = view->priv;
 
-	if (priv->pixbuf == NULL)
+	if (priv->pixbuf == NULL && priv->preview == NULL)
 		return TRUE;
 
+	span = eog_debug_trace_begin ();
+	paint_start = g_get_monotonic_time ();
+
 	eog_scroll_view_get_image_coords (view, &xofs, &yofs,
 	                                  &scaled_width, &scaled_height);
 
@@ -1102,7 +1730,9 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 	/* Paint the background */
 	gtk_widget_get_allocation (GTK_WIDGET (priv->display), &allocation);
 	cairo_rectangle (cr, 0, 0, allocation.width, allocation.height);
-	if (priv->transp_style != EOG_TRANSP_BACKGROUND)
+	/* Parts not decoded yet are transparent, keep them clean */
+	if (priv->transp_style != EOG_TRANSP_BACKGROUND &&
+	    priv->progressive_state == PROGRESSIVE_NONE)
 		cairo_rectangle (cr, MAX (0, xofs), MAX (0, yofs),
 		                 scaled_width, scaled_height);
 	if (priv->override_bg_color != NULL)
@@ -1131,7 +1761,7 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 	cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
 	cairo_fill (cr);
 
-	if (gdk_pixbuf_get_has_alpha (priv->pixbuf)) {
+	if (priv->pixbuf != NULL && gdk_pixbuf_get_has_alpha (priv->pixbuf)) {
 		if (priv->background_surface == NULL) {
 			priv->background_surface = create_background_surface (view);
 		}
@@ -1145,11 +1775,13 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 	 * This is especially necessary for SVGs where there might
 	 * be more image data available outside the image boundaries.
 	 */
+	cairo_save (cr);
 	cairo_rectangle (cr, xofs, yofs, scaled_width, scaled_height);
 	cairo_clip (cr);
 
 #ifdef HAVE_RSVG
-	if (eog_image_is_svg (view->priv->image)) {
+	if (priv->progressive_state == PROGRESSIVE_NONE &&
+	    eog_image_is_svg (view->priv->image)) {
 		cairo_matrix_t matrix, translate, scale, original;
 		EogTransform *transform = eog_image_get_transform (priv->image);
 		cairo_matrix_init_identity (&matrix);
@@ -1198,29 +1830,104 @@ display_draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 	{
 		cairo_filter_t interp_type;
 
-		if(!DOUBLE_EQUAL(priv->zoom, 1.0) && priv->force_unfiltered)
-		{
-			interp_type = CAIRO_FILTER_NEAREST;
-			_set_hq_redraw_timeout(view);
+		if (priv->preview != NULL) {
+			cairo_save (cr);
+			cairo_translate (cr, xofs, yofs);
+			cairo_scale (cr,
+			             (double) scaled_width / priv->preview_width,
+			             (double) scaled_height / priv->preview_height);
+			cairo_set_source_surface (cr, priv->preview, 0, 0);
+			cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+			cairo_paint (cr);
+			cairo_restore (cr);
+		}
+
+		if (hq_render_matches (view, xofs, yofs, &allocation)) {
+			/* A worker rendered this frame in high quality,
+			 * it becomes the viewport to build on */
+			_clear_viewport (view);
+			priv->viewport = priv->hq_result->result;
+			priv->viewport_width = priv->hq_result->width;
+			priv->viewport_height = priv->hq_result->height;
+			priv->viewport_xofs = priv->hq_result->xofs;
+			priv->viewport_yofs = priv->hq_result->yofs;
+			priv->viewport_scale = priv->hq_result->scale;
+			priv->viewport_zoom = priv->hq_result->zoom;
+			priv->viewport_filter = priv->hq_result->filter;
+			priv->hq_result->result = NULL;
+			hq_render_free (priv->hq_result);
+			priv->hq_result = NULL;
 		}
+
+		if (is_zoomed_in (view))
+			interp_type = priv->interp_type_in;
 		else
-		{
-			if (is_zoomed_in (view))
-				interp_type = priv->interp_type_in;
-			else
-				interp_type = priv->interp_type_out;
+			interp_type = priv->interp_type_out;
 
+		if (priv->progressive_state == PROGRESSIVE_NONE &&
+		    viewport_matches (view, xofs, yofs, &allocation) &&
+		    (priv->viewport_filter == interp_type ||
+		     !(is_zoomed_in (view) || is_zoomed_out (view)))) {
+			/* Nothing changed since the last frame */
 			_clear_hq_redraw_timeout (view);
 			priv->force_unfiltered = TRUE;
+		} else {
+			if(!DOUBLE_EQUAL(priv->zoom, 1.0) && priv->force_unfiltered)
+			{
+				interp_type = CAIRO_FILTER_NEAREST;
+				unfiltered = TRUE;
+				_set_hq_redraw_timeout(view);
+			}
+			else
+			{
+				_clear_hq_redraw_timeout (view);
+				priv->force_unfiltered = TRUE;
+			}
+
+			/* Unscaled frames are copied 1:1, which is what nearest does */
+			if (!is_zoomed_in (view) && !is_zoomed_out (view))
+				interp_type = CAIRO_FILTER_NEAREST;
+
+			/* Nothing decoded yet when only the preview is there */
+			if (priv->surface != NULL &&
+			    priv->progressive_state != PROGRESSIVE_NONE) {
+				/* The surface keeps changing while loading,
+				 * don't bother caching it */
+				cairo_rectangle_int_t area;
+				double x1, y1, x2, y2;
+
+				cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+				area.x = (int) floor (x1);
+				area.y = (int) floor (y1);
+				area.width = (int) ceil (x2) - area.x;
+				area.height = (int) ceil (y2) - area.y;
+
+				paint_image_area (view, cr, &area, xofs, yofs,
+				                  interp_type);
+				filter = interp_type;
+			} else if (priv->surface != NULL) {
+				update_viewport (view, xofs, yofs,
+				                 scaled_width, scaled_height,
+				                 &allocation, interp_type);
+			}
 		}
-		cairo_scale (cr, priv->zoom, priv->zoom);
-		cairo_set_source_surface (cr, priv->surface, xofs/priv->zoom, yofs/priv->zoom);
-		cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
-		if (is_zoomed_in (view) || is_zoomed_out (view))
-			cairo_pattern_set_filter (cairo_get_source (cr), interp_type);
 
-		cairo_paint (cr);
+		if (priv->viewport != NULL &&
+		    priv->progressive_state == PROGRESSIVE_NONE) {
+			filter = priv->viewport_filter;
+			cairo_set_source_surface (cr, priv->viewport, 0, 0);
+			cairo_paint (cr);
+		}
 	}
+	cairo_restore (cr);
+
+	frame_stats_add_paint (view, g_get_monotonic_time () - paint_start,
+	                       filter, unfiltered);
+
+	if (priv->show_frame_stats)
+		draw_frame_stats (view, cr);
+
+	eog_debug_trace_end ("display_draw", span);
 
 	return TRUE;
 }
@@ -1452,10 +2159,206 @@ update_pixbuf (EogScrollView *view, GdkPixbuf *pixbuf)
 
 	priv->pixbuf = pixbuf;
 
+	_clear_hq_render (view);
+	_clear_viewport (view);
+
 	if (priv->surface) {
 		cairo_surface_destroy (priv->surface);
+		priv->surface = NULL;
+	}
+
+	if (priv->pixbuf != NULL)
+		priv->surface = create_surface_from_pixbuf (view, priv->pixbuf);
+}
+
+/* Converts only @area of the pixbuf into the surface, used while the
+ * pixbuf is still being filled by the loader. */
+static void
+update_surface_area (EogScrollView *view, GdkRectangle *area)
+{
+	EogScrollViewPrivate *priv = view->priv;
+	GdkRectangle bounds;
+	GdkPixbuf *sub;
+	cairo_t *cr;
+
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.width = gdk_pixbuf_get_width (priv->pixbuf);
+	bounds.height = gdk_pixbuf_get_height (priv->pixbuf);
+
+	if (!gdk_rectangle_intersect (area, &bounds, area))
+		return;
+
+	_clear_hq_render (view);
+	_clear_viewport (view);
+
+	sub = gdk_pixbuf_new_subpixbuf (priv->pixbuf, area->x, area->y,
+	                                area->width, area->height);
+
+#ifdef HAVE_LCMS
+	/* The complete image gets converted once loaded, the loader's
+	 * pixbuf must be left alone until then */
+	if (priv->display_profile != NULL) {
+		GdkPixbuf *copy = gdk_pixbuf_copy (sub);
+
+		g_object_unref (sub);
+		sub = copy;
+
+		eog_image_apply_display_profile_to_area (priv->image, sub,
+		                                         priv->display_profile);
+	}
+#endif
+
+	cr = cairo_create (priv->surface);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	gdk_cairo_set_source_pixbuf (cr, sub, area->x, area->y);
+	cairo_rectangle (cr, area->x, area->y, area->width, area->height);
+	cairo_fill (cr);
+	cairo_destroy (cr);
+
+	g_object_unref (sub);
+}
+
+/* Like update_pixbuf(), for a pixbuf the loader is still writing to.
+ * Only @decoded is converted, the rest of the surface stays transparent
+ * so the preview or background shows through. */
+static void
+update_partial_pixbuf (EogScrollView *view, GdkPixbuf *pixbuf,
+                       GdkRectangle *decoded)
+{
+	EogScrollViewPrivate *priv;
+	int width, height;
+
+	priv = view->priv;
+
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+
+	if (width > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE) {
+		update_pixbuf (view, pixbuf);
+		return;
+	}
+
+	if (priv->pixbuf != NULL)
+		g_object_unref (priv->pixbuf);
+	priv->pixbuf = pixbuf;
+
+	_clear_hq_render (view);
+	_clear_viewport (view);
+
+	if (priv->surface != NULL)
+		cairo_surface_destroy (priv->surface);
+	priv->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+	                                            width, height);
+
+	if (decoded->width > 0 && decoded->height > 0)
+		update_surface_area (view, decoded);
+}
+
+/* Shows the image's thumbnail in its place until it is decoded */
+static void
+update_preview (EogScrollView *view, EogImage *image)
+{
+	EogScrollViewPrivate *priv;
+	GdkPixbuf *thumbnail, *content;
+	int width, height;
+
+	priv = view->priv;
+
+	thumbnail = eog_image_get_thumbnail (image);
+	if (thumbnail == NULL)
+		return;
+
+	/* Thumbnails are framed, only the image itself must be
+	 * stretched over the area the decoded image will cover */
+	content = eog_thumbnail_remove_frame (thumbnail,
+	                                      eog_image_get_transform (image));
+
+	priv->preview_width = gdk_pixbuf_get_width (content);
+	priv->preview_height = gdk_pixbuf_get_height (content);
+
+	eog_image_get_size (image, &width, &height);
+	if (width <= 0 || height <= 0) {
+		width = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (thumbnail),
+		                                            EOG_THUMBNAIL_ORIGINAL_WIDTH));
+		height = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (thumbnail),
+		                                             EOG_THUMBNAIL_ORIGINAL_HEIGHT));
+	}
+	if (width <= 0 || height <= 0) {
+		width = priv->preview_width;
+		height = priv->preview_height;
+	}
+
+	/* The size may be the one stored in the file, before
+	 * the thumbnail got rotated to the right orientation */
+	if ((width > height) != (priv->preview_width > priv->preview_height) &&
+	    width != height && priv->preview_width != priv->preview_height) {
+		int tmp = width;
+
+		width = height;
+		height = tmp;
+	}
+
+	priv->preview_image_width = width;
+	priv->preview_image_height = height;
+
+	if (priv->preview != NULL)
+		cairo_surface_destroy (priv->preview);
+	priv->preview = create_surface_from_pixbuf (view, content);
+
+	g_object_unref (content);
+	g_object_unref (thumbnail);
+}
+
+static void
+image_area_updated_cb (EogImage *img, gint x, gint y, gint width, gint height,
+                       gpointer data)
+{
+	EogScrollView *view = EOG_SCROLL_VIEW (data);
+	EogScrollViewPrivate *priv = view->priv;
+	GdkRectangle area = { x, y, width, height };
+	GdkRectangle decoded;
+	GdkPixbuf *partial;
+	int xofs, yofs;
+
+	if (priv->progressive_state != PROGRESSIVE_LOADING)
+		return;
+
+	partial = eog_image_get_partial_pixbuf (img, &decoded);
+	if (partial == NULL)
+		return;
+
+	/* Paint with the unfiltered fast path until the image is complete,
+	 * the high quality pass follows once it stops changing. */
+	priv->force_unfiltered = TRUE;
+
+	if (partial != priv->pixbuf || priv->surface == NULL) {
+		int old_width, old_height;
+		gboolean had_image;
+
+		had_image = get_image_size (view, &old_width, &old_height);
+
+		update_partial_pixbuf (view, partial, &decoded);
+
+		if (!had_image ||
+		    old_width != gdk_pixbuf_get_width (partial) ||
+		    old_height != gdk_pixbuf_get_height (partial))
+			_set_zoom_mode_internal (view,
+			                         EOG_ZOOM_MODE_SHRINK_TO_FIT);
+		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
+		return;
 	}
-	priv->surface = create_surface_from_pixbuf (view, priv->pixbuf);
+
+	g_object_unref (partial);
+
+	update_surface_area (view, &area);
+
+	eog_scroll_view_get_image_coords (view, &xofs, &yofs, NULL, NULL);
+	gtk_widget_queue_draw_area (GTK_WIDGET (priv->display),
+	                            xofs + floor (area.x * priv->zoom) - 1,
+	                            yofs + floor (area.y * priv->zoom) - 1,
+	                            ceil (area.width * priv->zoom) + 2,
+	                            ceil (area.height * priv->zoom) + 2);
 }
 
 static void
@@ -1517,6 +2420,7 @@ eog_scroll_view_set_antialiasing_in (EogScrollView *view, gboolean state)
 
 	if (priv->interp_type_in != new_interp_type) {
 		priv->interp_type_in = new_interp_type;
+		_clear_viewport (view);
 		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 		g_object_notify (G_OBJECT (view), "antialiasing-in");
 	}
@@ -1536,6 +2440,7 @@ eog_scroll_view_set_antialiasing_out (EogScrollView *view, gboolean state)
 
 	if (priv->interp_type_out != new_interp_type) {
 		priv->interp_type_out = new_interp_type;
+		_clear_viewport (view);
 		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 		g_object_notify (G_OBJECT (view), "antialiasing-out");
 	}
@@ -1733,6 +2638,51 @@ display_next_frame_cb (EogImage *image, gint delay, gpointer data)
 	gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 }
 
+static void
+start_animation (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+
+	if (eog_image_is_animation (priv->image) == TRUE ) {
+		eog_image_start_animation (priv->image);
+		priv->frame_changed_id = g_signal_connect (priv->image, "next-frame",
+		                                            (GCallback) display_next_frame_cb, view);
+	}
+}
+
+/* Swaps the partially decoded pixbuf for the final one */
+static void
+finish_progressive_load (EogScrollView *view)
+{
+	EogScrollViewPrivate *priv = view->priv;
+	GdkPixbuf *pixbuf;
+	gboolean resized;
+
+	int width, height;
+
+	priv->progressive_state = PROGRESSIVE_NONE;
+
+	pixbuf = eog_image_get_pixbuf (priv->image);
+
+	resized = (!get_image_size (view, &width, &height) || pixbuf == NULL ||
+	           gdk_pixbuf_get_width (pixbuf) != width ||
+	           gdk_pixbuf_get_height (pixbuf) != height);
+
+	if (priv->preview != NULL) {
+		cairo_surface_destroy (priv->preview);
+		priv->preview = NULL;
+	}
+
+	update_pixbuf (view, pixbuf);
+
+	if (resized)
+		_set_zoom_mode_internal (view, EOG_ZOOM_MODE_SHRINK_TO_FIT);
+
+	gtk_widget_queue_draw (GTK_WIDGET (priv->display));
+
+	start_animation (view);
+}
+
 void
 eog_scroll_view_set_image (EogScrollView *view, EogImage *image)
 {
@@ -1743,6 +2693,11 @@ eog_scroll_view_set_image (EogScrollView *view, EogImage *image)
 	priv = view->priv;
 
 	if (priv->image == image) {
+		/* It was shown while still loading, which is done now */
+		if (image != NULL &&
+		    priv->progressive_state == PROGRESSIVE_LOADING &&
+		    eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE))
+			finish_progressive_load (view);
 		return;
 	}
 
@@ -1752,31 +2707,44 @@ eog_scroll_view_set_image (EogScrollView *view, EogImage *image)
 	g_assert (priv->image == NULL);
 	g_assert (priv->pixbuf == NULL);
 
-	/* priv->progressive_state = PROGRESSIVE_NONE; */
+	priv->progressive_state = PROGRESSIVE_NONE;
 	if (image != NULL) {
 		eog_image_data_ref (image);
 
-		if (priv->pixbuf == NULL) {
-			update_pixbuf (view, eog_image_get_pixbuf (image));
-			/* priv->progressive_state = PROGRESSIVE_NONE; */
-			_set_zoom_mode_internal (view,
-			                         EOG_ZOOM_MODE_SHRINK_TO_FIT);
+		if (!eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE)) {
+			GdkPixbuf *partial;
+			GdkRectangle decoded;
 
+			/* Still decoding, show what's there and
+			 * fill in the rest as it arrives */
+			priv->progressive_state = PROGRESSIVE_LOADING;
+			priv->force_unfiltered = TRUE;
+
+			update_preview (view, image);
+
+			partial = eog_image_get_partial_pixbuf (image, &decoded);
+			if (partial != NULL)
+				update_partial_pixbuf (view, partial, &decoded);
+		} else {
+			update_pixbuf (view, eog_image_get_pixbuf (image));
 		}
 
+		_set_zoom_mode_internal (view, EOG_ZOOM_MODE_SHRINK_TO_FIT);
+
 		priv->image_changed_id = g_signal_connect (image, "changed",
 		                                           (GCallback) image_changed_cb, view);
-		if (eog_image_is_animation (image) == TRUE ) {
-			eog_image_start_animation (image);
-			priv->frame_changed_id = g_signal_connect (image, "next-frame",
-			                                            (GCallback) display_next_frame_cb, view);
-		}
+		priv->area_updated_id = g_signal_connect (image, "area-updated",
+		                                          (GCallback) image_area_updated_cb, view);
 	} else {
 		gtk_widget_queue_draw (GTK_WIDGET (priv->display));
 	}
 
 	priv->image = image;
 
+	if (priv->image != NULL &&
+	    priv->progressive_state == PROGRESSIVE_NONE)
+		start_animation (view);
+
 	g_object_notify (G_OBJECT (view), "image");
 	update_adjustment_values (view);
 }
@@ -1939,13 +2907,15 @@ eog_scroll_view_init (EogScrollView *view)
 	priv->image = NULL;
 	priv->pixbuf = NULL;
 	priv->surface = NULL;
-	/* priv->progressive_state = PROGRESSIVE_NONE; */
+	priv->progressive_state = PROGRESSIVE_NONE;
 	priv->transp_style = EOG_TRANSP_BACKGROUND;
 	g_warn_if_fail (gdk_rgba_parse(&priv->transp_color, CHECK_BLACK));
 	priv->cursor = EOG_SCROLL_VIEW_CURSOR_NORMAL;
 	priv->menu = NULL;
 	priv->override_bg_color = NULL;
 	priv->background_surface = NULL;
+	priv->last_filter = CAIRO_FILTER_GOOD;
+	priv->show_frame_stats = (g_getenv ("EOG_FRAME_STATS") != NULL);
 
 	priv->display = g_object_new (GTK_TYPE_DRAWING_AREA,
 	                              "can-focus", TRUE,
@@ -1964,6 +2934,10 @@ eog_scroll_view_init (EogScrollView *view)
 	                  G_CALLBACK (display_size_change), view);
 	g_signal_connect (G_OBJECT (priv->display), "draw",
 	                  G_CALLBACK (display_draw), view);
+	g_signal_connect (G_OBJECT (priv->display), "realize",
+	                  G_CALLBACK (display_realize_cb), view);
+	g_signal_connect (G_OBJECT (priv->display), "unrealize",
+	                  G_CALLBACK (display_unrealize_cb), view);
 	g_signal_connect (G_OBJECT (priv->display), "map_event",
 	                  G_CALLBACK (display_map_event), view);
 	g_signal_connect (G_OBJECT (priv->display), "button_press_event",
@@ -2220,6 +3194,8 @@ eog_scroll_view_dispose (GObject *object)
 
 	_clear_overlay_timeout (view);
 	_clear_hq_redraw_timeout (view);
+	_clear_hq_render (view);
+	_clear_viewport (view);
 
 	if (priv->idle_id != 0) {
 		g_source_remove (priv->idle_id);
@@ -2891,3 +3867,77 @@ eog_scroll_view_event_is_over_image (EogScrollView *view, const GdkEvent *ev)
 
 	return TRUE;
 }
+
+/**
+ * eog_scroll_view_get_frame_stats:
+ * @view: An #EogScrollView.
+ * @stats: (out caller-allocates): Return location for the statistics.
+ *
+ * Fills @stats with the paint time and input-to-paint latency percentiles
+ * of the most recent frames drawn by @view, and with the filter used for
+ * the last one.  The latency covers the time from a scroll or zoom request
+ * until the frame clock finished painting it.
+ **/
+void
+eog_scroll_view_get_frame_stats (EogScrollView           *view,
+                                 EogScrollViewFrameStats *stats)
+{
+	EogScrollViewPrivate *priv;
+
+	g_return_if_fail (EOG_IS_SCROLL_VIEW (view));
+	g_return_if_fail (stats != NULL);
+
+	priv = view->priv;
+
+	stats->n_frames = priv->n_frames;
+	stats->n_unfiltered = priv->n_unfiltered;
+	stats->filter = priv->last_filter;
+
+	frame_stats_percentiles (priv->paint_samples, priv->n_frames,
+	                         &stats->paint_p50, &stats->paint_p95,
+	                         &stats->paint_p99);
+	frame_stats_percentiles (priv->latency_samples, priv->n_latencies,
+	                         &stats->latency_p50, &stats->latency_p95,
+	                         &stats->latency_p99);
+}
+
+/**
+ * eog_scroll_view_set_show_frame_stats:
+ * @view: An #EogScrollView.
+ * @show: Whether to draw the statistics overlay.
+ *
+ * Draws the numbers returned by eog_scroll_view_get_frame_stats() in the
+ * corner of the view.  This is also enabled by setting the
+ * <envar>EOG_FRAME_STATS</envar> environment variable.
+ **/
+void
+eog_scroll_view_set_show_frame_stats (EogScrollView *view, gboolean show)
+{
+	g_return_if_fail (EOG_IS_SCROLL_VIEW (view));
+
+	if (view->priv->show_frame_stats == show)
+		return;
+
+	view->priv->show_frame_stats = show;
+	gtk_widget_queue_draw (GTK_WIDGET (view->priv->display));
+}
+
+#ifdef HAVE_LCMS
+/**
+ * eog_scroll_view_set_display_profile:
+ * @view: An #EogScrollView.
+ * @profile: (allow-none): the display profile, or %NULL.
+ *
+ * Sets the profile the parts of an image shown while it is still
+ * loading are converted to. Complete images are expected to be
+ * converted with eog_image_apply_display_profile() already. @profile
+ * must stay valid until it is unset again.
+ **/
+void
+eog_scroll_view_set_display_profile (EogScrollView *view, cmsHPROFILE profile)
+{
+	g_return_if_fail (EOG_IS_SCROLL_VIEW (view));
+
+	view->priv->display_profile = profile;
+}
+#endif
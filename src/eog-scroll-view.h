@@ -65,6 +65,33 @@ typedef enum {
 #define EOG_SCROLL_VIEW_MAX_ZOOM_FACTOR (20)
 #define EOG_SCROLL_VIEW_MIN_ZOOM_FACTOR (0.02)
 
+/**
+ * EogScrollViewFrameStats:
+ * @n_frames: Number of frames painted so far
+ * @n_unfiltered: How many of them took the unfiltered fast path
+ * @filter: The cairo filter used for the last frame
+ * @paint_p50: Median paint time in milliseconds
+ * @paint_p95: 95th percentile of the paint time in milliseconds
+ * @paint_p99: 99th percentile of the paint time in milliseconds
+ * @latency_p50: Median input-to-paint latency in milliseconds
+ * @latency_p95: 95th percentile of the input-to-paint latency in milliseconds
+ * @latency_p99: 99th percentile of the input-to-paint latency in milliseconds
+ *
+ * Frame timing of an #EogScrollView, see eog_scroll_view_get_frame_stats().
+ * The percentiles are computed over the most recent frames only.
+ */
+typedef struct {
+	guint n_frames;
+	guint n_unfiltered;
+	cairo_filter_t filter;
+	gdouble paint_p50;
+	gdouble paint_p95;
+	gdouble paint_p99;
+	gdouble latency_p50;
+	gdouble latency_p95;
+	gdouble latency_p99;
+} EogScrollViewFrameStats;
+
 GType    eog_scroll_view_get_type         (void) G_GNUC_CONST;
 GtkWidget* eog_scroll_view_new            (void);
 
@@ -103,6 +130,16 @@ void     eog_scroll_view_hide_cursor      (EogScrollView *view);
 gboolean eog_scroll_view_event_is_over_image	(EogScrollView *view,
 						 const GdkEvent *ev);
 
+void     eog_scroll_view_get_frame_stats  (EogScrollView *view,
+                                           EogScrollViewFrameStats *stats);
+void     eog_scroll_view_set_show_frame_stats (EogScrollView *view,
+                                               gboolean show);
+
+#ifdef HAVE_LCMS
+void     eog_scroll_view_set_display_profile (EogScrollView *view,
+                                              cmsHPROFILE    profile);
+#endif
+
 G_END_DECLS
 
 #endif /* _EOG_SCROLL_VIEW_H_ */
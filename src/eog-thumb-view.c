@@ -46,6 +46,14 @@ enum {
 
 #define EOG_THUMB_VIEW_SPACING 0
 
+/* Rows prefetched beyond the visible range in the scroll direction */
+#define EOG_THUMB_VIEW_PREFETCH_ROWS 2
+/* Thumbnails kept for rows outside the visible and prefetch ranges,
+ * for seen rows and for rows only warmed in the background each */
+#define EOG_THUMB_VIEW_CACHE_SIZE 256
+/* Rows looked at per iteration of the warming idle handler */
+#define EOG_THUMB_VIEW_WARM_STEP 16
+
 static void eog_thumb_view_init (EogThumbView *thumbview);
 
 static EogImage* eog_thumb_view_get_image_from_path (EogThumbView      *thumbview,
@@ -53,6 +61,8 @@ static EogImage* eog_thumb_view_get_image_from_path (EogThumbView      *thumbvie
 
 static void      eog_thumb_view_update_columns      (EogThumbView *view);
 
+static void      eog_thumb_view_cache_clear         (EogThumbView *thumbview);
+
 static gboolean
 thumbview_on_query_tooltip_cb (GtkWidget  *widget,
 			       gint        x,
@@ -83,9 +93,25 @@ struct _EogThumbViewPrivate {
 	gint n_images;
 	gulong image_add_id;
 	gulong image_removed_id;
+	gulong image_reordered_id;
 	gulong image_thumbnail_id;
 
 	gboolean indices_changed;
+
+	gint scroll_direction;  /* 1 when scrolling forward, -1 backwards */
+	gint prefetch_start;    /* range with thumbnails requested, including */
+	gint prefetch_end;      /* the look-ahead beyond the visible range    */
+
+	GQueue cached_images;   /* images outside the range that keep their */
+	GHashTable *cached_links; /* thumbnail, least recently seen first    */
+
+	GQueue warmed_images;   /* never seen images with a thumbnail, */
+	GHashTable *warmed_links; /* oldest warmed first               */
+
+	guint warm_id;
+	gint warm_ahead;        /* next rows to be warmed on each side */
+	gint warm_behind;
+	gint warm_left;         /* rows to warm before stopping */
 };
 
 G_DEFINE_TYPE_WITH_CODE (EogThumbView, eog_thumb_view, GTK_TYPE_ICON_VIEW,
@@ -169,6 +195,15 @@ eog_thumb_view_dispose (GObject *object)
 		priv->visible_range_changed_id = 0;
 	}
 
+	if (priv->warm_id != 0) {
+		g_source_remove (priv->warm_id);
+		priv->warm_id = 0;
+	}
+
+	eog_thumb_view_cache_clear (EOG_THUMB_VIEW (object));
+	g_clear_pointer (&priv->cached_links, g_hash_table_unref);
+	g_clear_pointer (&priv->warmed_links, g_hash_table_unref);
+
 	model = gtk_icon_view_get_model (GTK_ICON_VIEW (object));
 
 	if (model && priv->image_add_id != 0) {
@@ -181,6 +216,11 @@ eog_thumb_view_dispose (GObject *object)
 		priv->image_removed_id = 0;
 	}
 
+	if (model && priv->image_reordered_id) {
+		g_signal_handler_disconnect (model, priv->image_reordered_id);
+		priv->image_reordered_id = 0;
+	}
+
 	if (model && priv->image_thumbnail_id) {
 		g_signal_handler_disconnect (model, priv->image_thumbnail_id);
 		priv->image_thumbnail_id = 0;
@@ -243,6 +283,124 @@ eog_thumb_view_class_init (EogThumbViewClass *class)
 	                                  "orientation");
 }
 
+static void
+eog_thumb_view_cache_clear (EogThumbView *thumbview)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+
+	if (priv->cached_links != NULL)
+		g_hash_table_remove_all (priv->cached_links);
+
+	if (priv->warmed_links != NULL)
+		g_hash_table_remove_all (priv->warmed_links);
+
+	g_queue_clear_full (&priv->cached_images, g_object_unref);
+	g_queue_clear_full (&priv->warmed_images, g_object_unref);
+}
+
+static void
+eog_thumb_view_cache_remove (EogThumbView *thumbview,
+			     EogImage     *image)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+	GList *link;
+
+	link = g_hash_table_lookup (priv->cached_links, image);
+
+	if (link != NULL) {
+		g_hash_table_remove (priv->cached_links, image);
+		g_queue_delete_link (&priv->cached_images, link);
+		g_object_unref (image);
+	}
+
+	link = g_hash_table_lookup (priv->warmed_links, image);
+
+	if (link != NULL) {
+		g_hash_table_remove (priv->warmed_links, image);
+		g_queue_delete_link (&priv->warmed_images, link);
+		g_object_unref (image);
+	}
+}
+
+/* Makes @image the most recently seen entry of the cache */
+static void
+eog_thumb_view_cache_push (EogThumbView *thumbview,
+			   EogImage     *image)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+
+	eog_thumb_view_cache_remove (thumbview, image);
+
+	g_queue_push_tail (&priv->cached_images, g_object_ref (image));
+	g_hash_table_insert (priv->cached_links, image,
+			     g_queue_peek_tail_link (&priv->cached_images));
+}
+
+/* Drops the thumbnail of @image, unless its row came back into the
+ * prefetch range meanwhile. Takes the cache's reference. */
+static void
+eog_thumb_view_cache_evict (EogThumbView *thumbview,
+			    EogImage     *image)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+	EogListStore *store = EOG_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	gint pos;
+
+	pos = eog_list_store_get_pos_by_image (store, image);
+
+	if (pos >= 0 &&
+	    (pos < priv->prefetch_start || pos > priv->prefetch_end)) {
+		path = gtk_tree_path_new_from_indices (pos, -1);
+		if (gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
+			eog_list_store_thumbnail_unset (store, &iter);
+		gtk_tree_path_free (path);
+	}
+
+	g_object_unref (image);
+}
+
+/* Adds @image, whose row was never seen, to the warmed entries of the
+ * cache. These don't take room from the rows the user has seen; the
+ * oldest ones make room for new ones instead. */
+static void
+eog_thumb_view_cache_push_warmed (EogThumbView *thumbview,
+				  EogImage     *image)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+
+	eog_thumb_view_cache_remove (thumbview, image);
+
+	g_queue_push_tail (&priv->warmed_images, g_object_ref (image));
+	g_hash_table_insert (priv->warmed_links, image,
+			     g_queue_peek_tail_link (&priv->warmed_images));
+
+	while (priv->warmed_images.length > EOG_THUMB_VIEW_CACHE_SIZE) {
+		EogImage *oldest = g_queue_pop_head (&priv->warmed_images);
+
+		g_hash_table_remove (priv->warmed_links, oldest);
+		eog_thumb_view_cache_evict (thumbview, oldest);
+	}
+}
+
+/* Drops the thumbnails of the least recently seen rows until the cache
+ * is within its bounds again. */
+static void
+eog_thumb_view_cache_trim (EogThumbView *thumbview)
+{
+	EogThumbViewPrivate *priv = thumbview->priv;
+
+	while (priv->cached_images.length > EOG_THUMB_VIEW_CACHE_SIZE) {
+		EogImage *image = g_queue_pop_head (&priv->cached_images);
+
+		g_hash_table_remove (priv->cached_links, image);
+		eog_thumb_view_cache_evict (thumbview, image);
+	}
+}
+
+/* Moves the rows in the given range to the thumbnail cache instead
+ * of dropping their thumbnails right away. */
 static void
 eog_thumb_view_clear_range (EogThumbView *thumbview,
 			    const gint start_thumb,
@@ -251,6 +409,7 @@ eog_thumb_view_clear_range (EogThumbView *thumbview,
 	GtkTreePath *path;
 	GtkTreeIter iter;
 	EogListStore *store = EOG_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
+	EogImage *image;
 	gint thumb = start_thumb;
 	gboolean result;
 
@@ -260,9 +419,15 @@ eog_thumb_view_clear_range (EogThumbView *thumbview,
 	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
 	     result && thumb <= end_thumb;
 	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
-		eog_list_store_thumbnail_unset (store, &iter);
+		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+				    EOG_LIST_STORE_EOG_IMAGE, &image,
+				    -1);
+		eog_thumb_view_cache_push (thumbview, image);
+		g_object_unref (image);
 	}
 	gtk_tree_path_free (path);
+
+	eog_thumb_view_cache_trim (thumbview);
 }
 
 static void
@@ -273,6 +438,7 @@ eog_thumb_view_add_range (EogThumbView *thumbview,
 	GtkTreePath *path;
 	GtkTreeIter iter;
 	EogListStore *store = EOG_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
+	EogImage *image;
 	gint thumb = start_thumb;
 	gboolean result;
 
@@ -282,11 +448,88 @@ eog_thumb_view_add_range (EogThumbView *thumbview,
 	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
 	     result && thumb <= end_thumb;
 	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter), thumb++) {
+		gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+				    EOG_LIST_STORE_EOG_IMAGE, &image,
+				    -1);
+		eog_thumb_view_cache_remove (thumbview, image);
+		g_object_unref (image);
+
 		eog_list_store_thumbnail_set (store, &iter);
 	}
 	gtk_tree_path_free (path);
 }
 
+/* Number of thumbnails per row in the scroll direction */
+static gint
+eog_thumb_view_get_row_length (EogThumbView *thumbview,
+			       gint          end_thumb)
+{
+	GtkTreePath *path;
+	gint columns;
+
+	if (thumbview->priv->orientation == GTK_ORIENTATION_HORIZONTAL)
+		return 1;
+
+	columns = gtk_icon_view_get_columns (GTK_ICON_VIEW (thumbview));
+
+	if (columns <= 0) {
+		path = gtk_tree_path_new_from_indices (end_thumb, -1);
+		columns = gtk_icon_view_get_item_column (GTK_ICON_VIEW (thumbview), path) + 1;
+		gtk_tree_path_free (path);
+	}
+
+	return MAX (columns, 1);
+}
+
+static gboolean
+eog_thumb_view_warm_cb (gpointer user_data)
+{
+	EogThumbView *thumbview = EOG_THUMB_VIEW (user_data);
+	EogThumbViewPrivate *priv = thumbview->priv;
+	EogListStore *store;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	EogImage *image;
+	gint step, pos;
+
+	store = EOG_LIST_STORE (gtk_icon_view_get_model (GTK_ICON_VIEW (thumbview)));
+
+	for (step = 0; step < EOG_THUMB_VIEW_WARM_STEP; step++) {
+		/* Don't evict what this pass has warmed itself */
+		if (priv->warm_left <= 0)
+			break;
+
+		/* Alternate sides, starting in the scroll direction */
+		if (priv->warm_ahead < priv->n_images &&
+		    (priv->warm_behind < 0 || (step % 2 == 0) == (priv->scroll_direction > 0))) {
+			pos = priv->warm_ahead++;
+		} else if (priv->warm_behind >= 0) {
+			pos = priv->warm_behind--;
+		} else {
+			break;
+		}
+
+		path = gtk_tree_path_new_from_indices (pos, -1);
+		if (gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path) &&
+		    !eog_list_store_thumbnail_warm (store, &iter)) {
+			gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+					    EOG_LIST_STORE_EOG_IMAGE, &image,
+					    -1);
+			eog_thumb_view_cache_push_warmed (thumbview, image);
+			g_object_unref (image);
+			priv->warm_left--;
+		}
+		gtk_tree_path_free (path);
+	}
+
+	if (step < EOG_THUMB_VIEW_WARM_STEP) {
+		priv->warm_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
 static void
 eog_thumb_view_update_visible_range (EogThumbView *thumbview,
 				     const gint start_thumb,
@@ -294,6 +537,7 @@ eog_thumb_view_update_visible_range (EogThumbView *thumbview,
 {
 	EogThumbViewPrivate *priv = thumbview->priv;
 	int old_start_thumb, old_end_thumb;
+	gint lookahead, prefetch_start, prefetch_end;
 
 	old_start_thumb= priv->start_thumb;
 	old_end_thumb = priv->end_thumb;
@@ -304,17 +548,57 @@ eog_thumb_view_update_visible_range (EogThumbView *thumbview,
 		return;
 	}
 
-	if (old_start_thumb < start_thumb)
-		eog_thumb_view_clear_range (thumbview, old_start_thumb, MIN (start_thumb - 1, old_end_thumb));
+	if (start_thumb > old_start_thumb)
+		priv->scroll_direction = 1;
+	else if (start_thumb < old_start_thumb)
+		priv->scroll_direction = -1;
+
+	/* Request thumbnails for a few rows ahead of the visible
+	 * range, so they are likely ready once they scroll in */
+	lookahead = EOG_THUMB_VIEW_PREFETCH_ROWS *
+		eog_thumb_view_get_row_length (thumbview, end_thumb);
+
+	prefetch_start = start_thumb;
+	prefetch_end = end_thumb;
+
+	if (priv->scroll_direction < 0)
+		prefetch_start = MAX (start_thumb - lookahead, 0);
+	else
+		prefetch_end = MIN (end_thumb + lookahead, priv->n_images - 1);
+
+	if (priv->prefetch_start < prefetch_start)
+		eog_thumb_view_clear_range (thumbview, priv->prefetch_start,
+					    MIN (prefetch_start - 1, priv->prefetch_end));
 
-	if (old_end_thumb > end_thumb)
-		eog_thumb_view_clear_range (thumbview, MAX (end_thumb + 1, old_start_thumb), old_end_thumb);
+	if (priv->prefetch_end > prefetch_end)
+		eog_thumb_view_clear_range (thumbview,
+					    MAX (prefetch_end + 1, priv->prefetch_start),
+					    priv->prefetch_end);
 
 	eog_thumb_view_add_range (thumbview, start_thumb, end_thumb);
 
+	if (prefetch_start < start_thumb)
+		eog_thumb_view_add_range (thumbview, prefetch_start, start_thumb - 1);
+
+	if (prefetch_end > end_thumb)
+		eog_thumb_view_add_range (thumbview, end_thumb + 1, prefetch_end);
+
 	priv->start_thumb = start_thumb;
 	priv->end_thumb = end_thumb;
+	priv->prefetch_start = prefetch_start;
+	priv->prefetch_end = prefetch_end;
 	priv->indices_changed = FALSE;
+
+	/* Restart warming the rest of the collection from here */
+	priv->warm_ahead = prefetch_end + 1;
+	priv->warm_behind = prefetch_start - 1;
+	priv->warm_left = EOG_THUMB_VIEW_CACHE_SIZE;
+
+	if (priv->warm_id == 0) {
+		priv->warm_id = g_idle_add_full (G_PRIORITY_LOW,
+						 eog_thumb_view_warm_cb,
+						 thumbview, NULL);
+	}
 }
 
 static gboolean
@@ -649,7 +933,16 @@ eog_thumb_view_init (EogThumbView *thumbview)
 	thumbview->priv->visible_range_changed_id = 0;
 	thumbview->priv->image_add_id = 0;
 	thumbview->priv->image_removed_id = 0;
+	thumbview->priv->image_reordered_id = 0;
 	thumbview->priv->image_thumbnail_id = 0;
+
+	thumbview->priv->scroll_direction = 1;
+	g_queue_init (&thumbview->priv->cached_images);
+	thumbview->priv->cached_links = g_hash_table_new (g_direct_hash,
+							  g_direct_equal);
+	g_queue_init (&thumbview->priv->warmed_images);
+	thumbview->priv->warmed_links = g_hash_table_new (g_direct_hash,
+							  g_direct_equal);
 }
 
 /**
@@ -708,6 +1001,18 @@ eog_thumb_view_row_deleted_cb (GtkTreeModel    *tree_model,
 	eog_thumb_view_update_columns (view);
 }
 
+static void
+eog_thumb_view_rows_reordered_cb (GtkTreeModel    *tree_model,
+                                  GtkTreePath     *path,
+                                  GtkTreeIter     *iter,
+                                  gpointer         new_order,
+                                  EogThumbView    *view)
+{
+	/* Other images may have moved into the visible range */
+	view->priv->indices_changed = TRUE;
+	eog_thumb_view_visible_range_changed (view);
+}
+
 static void
 eog_thumb_view_row_changed_cb (GtkTreeModel *model,
 			       GtkTreePath  *path,
@@ -763,6 +1068,11 @@ eog_thumb_view_set_model (EogThumbView *thumbview, EogListStore *store)
 			g_signal_handler_disconnect (existing,
 			                             priv->image_removed_id);
 
+		}
+		if (priv->image_reordered_id != 0) {
+			g_signal_handler_disconnect (existing,
+			                             priv->image_reordered_id);
+
 		}
 		if (priv->image_thumbnail_id != 0) {
 			g_signal_handler_disconnect (existing,
@@ -783,12 +1093,23 @@ eog_thumb_view_set_model (EogThumbView *thumbview, EogListStore *store)
 	                             "row-deleted",
 	                             G_CALLBACK (eog_thumb_view_row_deleted_cb),
 	                             thumbview);
+	priv->image_reordered_id = g_signal_connect (G_OBJECT (store),
+	                             "rows-reordered",
+	                             G_CALLBACK (eog_thumb_view_rows_reordered_cb),
+	                             thumbview);
 	priv->image_thumbnail_id = g_signal_connect (G_OBJECT (store),
 	                             "draw-thumbnail",
 	                             G_CALLBACK (eog_thumb_view_draw_thumbnail_cb),
 				     thumbview);
 
+	if (priv->warm_id != 0) {
+		g_source_remove (priv->warm_id);
+		priv->warm_id = 0;
+	}
+	eog_thumb_view_cache_clear (thumbview);
+
 	thumbview->priv->start_thumb = thumbview->priv->end_thumb = 0;
+	thumbview->priv->prefetch_start = thumbview->priv->prefetch_end = 0;
 	thumbview->priv->n_images = eog_list_store_length (store);
 
 	index = eog_list_store_get_initial_pos (store);
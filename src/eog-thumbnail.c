@@ -37,12 +37,56 @@
 #include "eog-list-store.h"
 #include "eog-debug.h"
 #include "eog-util.h"
+#include "eog-dimension-probe.h"
+
+#ifdef HAVE_EXIF
+#include "eog-metadata-reader.h"
+#include <libexif/exif-data.h>
+#include <libexif/exif-utils.h>
+#endif
+
+#include <stdio.h>
 
 #define EOG_THUMB_ERROR eog_thumb_error_quark ()
 
+/* The EXIF preview is only looked for in the first bytes of the file,
+ * a single APP1 segment can't be larger than 64 KiB */
+#define EOG_THUMB_EXIF_READ_LIMIT  (68 * 1024)
+#define EOG_THUMB_EXIF_BUFFER_SIZE 4096
+
+/* Upper bound for the memory used by the framed thumbnails cache */
+#define EOG_THUMB_CACHE_MAX_BYTES (32 * 1024 * 1024)
+
+/* Frame borders, see eog_thumbnail_add_frame() */
+#define EOG_THUMB_FRAME_LEFT   3
+#define EOG_THUMB_FRAME_TOP    3
+#define EOG_THUMB_FRAME_RIGHT  6
+#define EOG_THUMB_FRAME_BOTTOM 6
+
+/* Stretched frames kept around; thumbnails are fitted to a fixed
+ * size so only a few frame sizes are usually needed */
+#define EOG_THUMB_FRAME_CACHE_SIZE 64
+
 static GnomeDesktopThumbnailFactory *factory = NULL;
 static GdkPixbuf *frame = NULL;
 
+static GMutex      frame_cache_mutex;
+static GHashTable *frame_cache = NULL;    /* (width << 16 | height) -> GdkPixbuf */
+
+/* Process-wide LRU of framed thumbnails, shared by all windows.
+ * Entries are keyed by URI and modification time, so a changed
+ * file never hits a stale entry; those just age out. */
+typedef struct {
+	gchar     *key;
+	GdkPixbuf *thumbnail;
+	gsize      size;
+} EogThumbCacheEntry;
+
+static GMutex      thumb_cache_mutex;
+static GHashTable *thumb_cache = NULL;     /* key -> GList link in thumb_cache_lru */
+static GQueue      thumb_cache_lru = G_QUEUE_INIT; /* least recently used first */
+static gsize       thumb_cache_size = 0;
+
 typedef enum {
 	EOG_THUMB_ERROR_VFS,
 	EOG_THUMB_ERROR_GENERIC,
@@ -369,6 +413,53 @@ eog_thumbnail_stretch_frame_image (GdkPixbuf *frame_image,
         return result_pixbuf;
 }
 
+/* Returns an empty frame for a thumbnail of the given size, which
+ * is shared and must not be modified. */
+static GdkPixbuf *
+eog_thumbnail_get_frame (gint width, gint height)
+{
+	GdkPixbuf *stretched;
+	gpointer key;
+
+	eog_thumbnail_init ();
+
+	key = GUINT_TO_POINTER (((guint) width << 16) | ((guint) height & 0xffff));
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&frame_cache_mutex);
+
+	if (frame_cache == NULL) {
+		frame_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						     NULL, g_object_unref);
+	}
+
+	stretched = g_hash_table_lookup (frame_cache, key);
+
+	if (stretched == NULL) {
+		stretched = eog_thumbnail_stretch_frame_image (frame,
+							       EOG_THUMB_FRAME_LEFT,
+							       EOG_THUMB_FRAME_TOP,
+							       EOG_THUMB_FRAME_RIGHT,
+							       EOG_THUMB_FRAME_BOTTOM,
+							       width + EOG_THUMB_FRAME_LEFT + EOG_THUMB_FRAME_RIGHT,
+							       height + EOG_THUMB_FRAME_TOP + EOG_THUMB_FRAME_BOTTOM,
+							       FALSE);
+
+		/* Odd sized thumbnails aren't worth an LRU, start over */
+		if (g_hash_table_size (frame_cache) >= EOG_THUMB_FRAME_CACHE_SIZE)
+			g_hash_table_remove_all (frame_cache);
+
+		g_hash_table_insert (frame_cache, key, stretched);
+	}
+
+	g_object_ref (stretched);
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&frame_cache_mutex);
+
+	return stretched;
+}
+
 /**
  * eog_thumbnail_add_frame:
  * @thumbnail: a #GdkPixbuf
@@ -380,32 +471,112 @@ eog_thumbnail_stretch_frame_image (GdkPixbuf *frame_image,
 GdkPixbuf *
 eog_thumbnail_add_frame (GdkPixbuf *thumbnail)
 {
-	GdkPixbuf *result_pixbuf;
+	GdkPixbuf *result_pixbuf, *empty_frame;
 	gint source_width, source_height;
-	gint dest_width, dest_height;
 
 	source_width  = gdk_pixbuf_get_width  (thumbnail);
 	source_height = gdk_pixbuf_get_height (thumbnail);
 
-	dest_width  = source_width  + 9;
-	dest_height = source_height + 9;
-
-	result_pixbuf = eog_thumbnail_stretch_frame_image (frame,
-							   3, 3, 6, 6,
-	                                	           dest_width,
-							   dest_height,
-							   FALSE);
+	empty_frame = eog_thumbnail_get_frame (source_width, source_height);
+	result_pixbuf = gdk_pixbuf_copy (empty_frame);
+	g_object_unref (empty_frame);
 
 	gdk_pixbuf_copy_area (thumbnail,
 			      0, 0,
 			      source_width,
 			      source_height,
 			      result_pixbuf,
-			      3, 3);
+			      EOG_THUMB_FRAME_LEFT, EOG_THUMB_FRAME_TOP);
 
 	return result_pixbuf;
 }
 
+/**
+ * eog_thumbnail_remove_frame:
+ * @thumbnail: a #GdkPixbuf framed by eog_thumbnail_add_frame()
+ * @transform: (allow-none): the #EogTransform applied to @thumbnail
+ * after framing it, or %NULL
+ *
+ * Cuts the frame border and shadow off @thumbnail, leaving only the
+ * image it shows. A rotated or flipped @thumbnail carries its frame
+ * on different sides, so the @transform it went through is needed
+ * to find them.
+ *
+ * Returns: (transfer full): a #GdkPixbuf sharing the pixels of @thumbnail
+ **/
+GdkPixbuf *
+eog_thumbnail_remove_frame (GdkPixbuf *thumbnail, EogTransform *transform)
+{
+	EogTransformType type = EOG_TRANSFORM_NONE;
+	gint left, top, right, bottom;
+	gint width, height;
+
+	g_return_val_if_fail (GDK_IS_PIXBUF (thumbnail), NULL);
+
+	if (transform != NULL)
+		type = eog_transform_get_transform_type (transform);
+
+	switch (type) {
+	case EOG_TRANSFORM_ROT_90:
+		left = EOG_THUMB_FRAME_BOTTOM;
+		top = EOG_THUMB_FRAME_LEFT;
+		right = EOG_THUMB_FRAME_TOP;
+		bottom = EOG_THUMB_FRAME_RIGHT;
+		break;
+	case EOG_TRANSFORM_ROT_180:
+		left = EOG_THUMB_FRAME_RIGHT;
+		top = EOG_THUMB_FRAME_BOTTOM;
+		right = EOG_THUMB_FRAME_LEFT;
+		bottom = EOG_THUMB_FRAME_TOP;
+		break;
+	case EOG_TRANSFORM_ROT_270:
+		left = EOG_THUMB_FRAME_TOP;
+		top = EOG_THUMB_FRAME_RIGHT;
+		right = EOG_THUMB_FRAME_BOTTOM;
+		bottom = EOG_THUMB_FRAME_LEFT;
+		break;
+	case EOG_TRANSFORM_FLIP_HORIZONTAL:
+		left = EOG_THUMB_FRAME_RIGHT;
+		top = EOG_THUMB_FRAME_TOP;
+		right = EOG_THUMB_FRAME_LEFT;
+		bottom = EOG_THUMB_FRAME_BOTTOM;
+		break;
+	case EOG_TRANSFORM_FLIP_VERTICAL:
+		left = EOG_THUMB_FRAME_LEFT;
+		top = EOG_THUMB_FRAME_BOTTOM;
+		right = EOG_THUMB_FRAME_RIGHT;
+		bottom = EOG_THUMB_FRAME_TOP;
+		break;
+	case EOG_TRANSFORM_TRANSPOSE:
+		left = EOG_THUMB_FRAME_TOP;
+		top = EOG_THUMB_FRAME_LEFT;
+		right = EOG_THUMB_FRAME_BOTTOM;
+		bottom = EOG_THUMB_FRAME_RIGHT;
+		break;
+	case EOG_TRANSFORM_TRANSVERSE:
+		left = EOG_THUMB_FRAME_BOTTOM;
+		top = EOG_THUMB_FRAME_RIGHT;
+		right = EOG_THUMB_FRAME_TOP;
+		bottom = EOG_THUMB_FRAME_LEFT;
+		break;
+	case EOG_TRANSFORM_NONE:
+	default:
+		left = EOG_THUMB_FRAME_LEFT;
+		top = EOG_THUMB_FRAME_TOP;
+		right = EOG_THUMB_FRAME_RIGHT;
+		bottom = EOG_THUMB_FRAME_BOTTOM;
+		break;
+	}
+
+	width = gdk_pixbuf_get_width (thumbnail) - left - right;
+	height = gdk_pixbuf_get_height (thumbnail) - top - bottom;
+
+	if (width <= 0 || height <= 0)
+		return g_object_ref (thumbnail);
+
+	return gdk_pixbuf_new_subpixbuf (thumbnail, left, top, width, height);
+}
+
 /**
  * eog_thumbnail_fit_to_size:
  * @thumbnail: a #GdkPixbuf
@@ -443,6 +614,177 @@ eog_thumbnail_fit_to_size (GdkPixbuf *thumbnail, gint dimension)
 	return gdk_pixbuf_copy (thumbnail);
 }
 
+#ifdef HAVE_EXIF
+/*
+ * Camera JPEGs usually embed a small preview in the IFD1 of their EXIF
+ * data. Reading it only needs the APP1 segment at the start of the
+ * file, which is much cheaper than decoding a multi-megapixel image.
+ */
+static GdkPixbuf *
+eog_thumbnail_load_exif_preview (EogThumbData *data)
+{
+	EogMetadataReader *md_reader;
+	GFileInputStream *stream;
+	GdkPixbufLoader *loader;
+	GdkPixbuf *preview = NULL;
+	ExifData *exif;
+	ExifEntry *entry;
+	GFile *file;
+	guchar *buffer;
+	gssize bytes_read;
+	gsize total = 0;
+	gint width, height;
+
+	file = g_file_new_for_uri (data->uri_str);
+	stream = g_file_read (file, NULL, NULL);
+	g_object_unref (file);
+
+	if (stream == NULL)
+		return NULL;
+
+	md_reader = eog_metadata_reader_new (EOG_METADATA_JPEG);
+	buffer = g_malloc (EOG_THUMB_EXIF_BUFFER_SIZE);
+
+	while (!eog_metadata_reader_finished (md_reader) &&
+	       total < EOG_THUMB_EXIF_READ_LIMIT) {
+		bytes_read = g_input_stream_read (G_INPUT_STREAM (stream),
+						  buffer,
+						  EOG_THUMB_EXIF_BUFFER_SIZE,
+						  NULL, NULL);
+		if (bytes_read <= 0)
+			break;
+
+		eog_metadata_reader_consume (md_reader, buffer, bytes_read);
+		total += bytes_read;
+	}
+
+	g_free (buffer);
+
+	exif = eog_metadata_reader_get_exif_data (md_reader);
+	g_object_unref (md_reader);
+
+	if (exif == NULL) {
+		g_object_unref (stream);
+		return NULL;
+	}
+
+	if (exif->data != NULL && exif->size > 0) {
+		loader = gdk_pixbuf_loader_new_with_type ("jpeg", NULL);
+
+		if (loader != NULL) {
+			if (gdk_pixbuf_loader_write (loader, exif->data, exif->size, NULL) &&
+			    gdk_pixbuf_loader_close (loader, NULL)) {
+				preview = gdk_pixbuf_loader_get_pixbuf (loader);
+				if (preview != NULL)
+					g_object_ref (preview);
+			} else {
+				gdk_pixbuf_loader_close (loader, NULL);
+			}
+			g_object_unref (loader);
+		}
+	}
+
+	/* The preview is stored unrotated, just like the main image */
+	entry = exif_data_get_entry (exif, EXIF_TAG_ORIENTATION);
+	if (preview != NULL && entry != NULL && entry->data != NULL) {
+		gshort orientation;
+
+		orientation = exif_get_short (entry->data,
+					      exif_data_get_byte_order (exif));
+
+		if (orientation > 1 && orientation <= 8) {
+			GdkPixbuf *rotated;
+			gchar *value;
+
+			value = g_strdup_printf ("%d", orientation);
+			gdk_pixbuf_set_option (preview, "orientation", value);
+			g_free (value);
+
+			rotated = gdk_pixbuf_apply_embedded_orientation (preview);
+			g_object_unref (preview);
+			preview = rotated;
+		}
+	}
+
+	exif_data_unref (exif);
+
+	/* The size of the image itself is only in the frame header
+	 * following the EXIF data, store it like thumbnails do */
+	if (preview != NULL &&
+	    g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_SET, NULL, NULL) &&
+	    eog_dimension_probe (G_INPUT_STREAM (stream), &width, &height, NULL)) {
+		g_object_set_data (G_OBJECT (preview),
+				   EOG_THUMBNAIL_ORIGINAL_WIDTH,
+				   GINT_TO_POINTER (width));
+		g_object_set_data (G_OBJECT (preview),
+				   EOG_THUMBNAIL_ORIGINAL_HEIGHT,
+				   GINT_TO_POINTER (height));
+	}
+
+	g_object_unref (stream);
+
+	return preview;
+}
+#endif
+
+static GdkPixbuf*
+eog_thumbnail_load_real (EogImage *image, gboolean allow_preview, GError **error);
+
+/**
+ * eog_thumbnail_fit_and_frame:
+ * @thumbnail: a #GdkPixbuf
+ * @dimension: the maximum width or height desired
+ *
+ * Same as eog_thumbnail_add_frame() on the result of
+ * eog_thumbnail_fit_to_size(), but @thumbnail is scaled straight
+ * into the framed pixbuf, without an intermediate copy.
+ *
+ * Returns: (transfer full): a new #GdkPixbuf
+ **/
+GdkPixbuf *
+eog_thumbnail_fit_and_frame (GdkPixbuf *thumbnail, gint dimension)
+{
+	GdkPixbuf *result_pixbuf, *empty_frame;
+	gint src_width, src_height;
+	gint width, height;
+
+	src_width = width = gdk_pixbuf_get_width (thumbnail);
+	src_height = height = gdk_pixbuf_get_height (thumbnail);
+
+	if (width > dimension || height > dimension) {
+		gfloat factor;
+
+		if (width > height) {
+			factor = (gfloat) dimension / (gfloat) width;
+		} else {
+			factor = (gfloat) dimension / (gfloat) height;
+		}
+
+		width  = MAX (width  * factor, 1);
+		height = MAX (height * factor, 1);
+	}
+
+	empty_frame = eog_thumbnail_get_frame (width, height);
+	result_pixbuf = gdk_pixbuf_copy (empty_frame);
+	g_object_unref (empty_frame);
+
+	if (width == src_width && height == src_height) {
+		gdk_pixbuf_copy_area (thumbnail, 0, 0, width, height,
+				      result_pixbuf,
+				      EOG_THUMB_FRAME_LEFT, EOG_THUMB_FRAME_TOP);
+	} else {
+		gdk_pixbuf_scale (thumbnail, result_pixbuf,
+				  EOG_THUMB_FRAME_LEFT, EOG_THUMB_FRAME_TOP,
+				  width, height,
+				  EOG_THUMB_FRAME_LEFT, EOG_THUMB_FRAME_TOP,
+				  (gdouble) width / src_width,
+				  (gdouble) height / src_height,
+				  GDK_INTERP_HYPER);
+	}
+
+	return result_pixbuf;
+}
+
 /**
  * eog_thumbnail_load:
  * @image: a #EogImage
@@ -456,6 +798,12 @@ eog_thumbnail_fit_to_size (GdkPixbuf *thumbnail, gint dimension)
  **/
 GdkPixbuf*
 eog_thumbnail_load (EogImage *image, GError **error)
+{
+	return eog_thumbnail_load_real (image, FALSE, error);
+}
+
+static GdkPixbuf*
+eog_thumbnail_load_real (EogImage *image, gboolean allow_preview, GError **error)
 {
 	GdkPixbuf *thumb = NULL;
 	GFile *file;
@@ -468,6 +816,8 @@ eog_thumbnail_load (EogImage *image, GError **error)
 	g_return_val_if_fail (image != NULL, NULL);
 	g_return_val_if_fail (error != NULL && *error == NULL, NULL);
 
+	eog_thumbnail_init ();
+
 	file = eog_image_get_file (image);
 	data = eog_thumb_data_new (file, error);
 	g_object_unref (file);
@@ -492,6 +842,24 @@ eog_thumbnail_load (EogImage *image, GError **error)
 		if (!eog_image_is_file_changed (image))
 			pixbuf = eog_image_get_pixbuf (image);
 
+#ifdef HAVE_EXIF
+		if (pixbuf == NULL && allow_preview &&
+		    g_strcmp0 (data->mime_type, "image/jpeg") == 0) {
+			thumb = eog_thumbnail_load_exif_preview (data);
+
+			if (thumb != NULL) {
+				/* Not saved, the real thumbnail is
+				 * expected to be requested later on */
+				eog_debug_message (DEBUG_THUMBNAIL, "%s: using EXIF preview",data->uri_str);
+				g_object_set_data (G_OBJECT (thumb),
+						   EOG_THUMBNAIL_IS_PREVIEW,
+						   GINT_TO_POINTER (TRUE));
+				eog_thumb_data_free (data);
+				return thumb;
+			}
+		}
+#endif
+
 		if (pixbuf != NULL) {
 			/* generate a thumbnail from the in-memory image,
 			   if we have already loaded the image */
@@ -544,16 +912,223 @@ eog_thumbnail_load (EogImage *image, GError **error)
 	return thumb;
 }
 
+static gchar *
+eog_thumb_cache_key (const gchar *uri, guint64 mtime)
+{
+	return g_strdup_printf ("%s#%" G_GUINT64_FORMAT, uri, mtime);
+}
+
+static void
+eog_thumb_cache_entry_free (EogThumbCacheEntry *entry)
+{
+	g_free (entry->key);
+	g_object_unref (entry->thumbnail);
+	g_slice_free (EogThumbCacheEntry, entry);
+}
+
+static GdkPixbuf *
+eog_thumb_cache_lookup (const gchar *key)
+{
+	GdkPixbuf *thumbnail = NULL;
+	GList *link;
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&thumb_cache_mutex);
+
+	link = g_hash_table_lookup (thumb_cache, key);
+
+	if (link != NULL) {
+		EogThumbCacheEntry *entry = link->data;
+
+		/* Mark as most recently used */
+		g_queue_unlink (&thumb_cache_lru, link);
+		g_queue_push_tail_link (&thumb_cache_lru, link);
+
+		thumbnail = g_object_ref (entry->thumbnail);
+	}
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&thumb_cache_mutex);
+
+	return thumbnail;
+}
+
+static void
+eog_thumb_cache_insert (const gchar *key, GdkPixbuf *thumbnail)
+{
+	EogThumbCacheEntry *entry;
+	GList *link;
+
+	entry = g_slice_new (EogThumbCacheEntry);
+	entry->key = g_strdup (key);
+	entry->thumbnail = g_object_ref (thumbnail);
+	entry->size = gdk_pixbuf_get_byte_length (thumbnail);
+
+	/* --- enter critical section --- */
+	g_mutex_lock (&thumb_cache_mutex);
+
+	link = g_hash_table_lookup (thumb_cache, key);
+	if (link != NULL) {
+		EogThumbCacheEntry *old = link->data;
+
+		g_hash_table_remove (thumb_cache, key);
+		g_queue_delete_link (&thumb_cache_lru, link);
+		thumb_cache_size -= old->size;
+		eog_thumb_cache_entry_free (old);
+	}
+
+	g_queue_push_tail (&thumb_cache_lru, entry);
+	g_hash_table_insert (thumb_cache, entry->key,
+			     g_queue_peek_tail_link (&thumb_cache_lru));
+	thumb_cache_size += entry->size;
+
+	/* Evict the least recently used thumbnails */
+	while (thumb_cache_size > EOG_THUMB_CACHE_MAX_BYTES &&
+	       thumb_cache_lru.length > 1) {
+		EogThumbCacheEntry *lru = g_queue_pop_head (&thumb_cache_lru);
+
+		g_hash_table_remove (thumb_cache, lru->key);
+		thumb_cache_size -= lru->size;
+		eog_thumb_cache_entry_free (lru);
+	}
+
+	/* --- leave critical section --- */
+	g_mutex_unlock (&thumb_cache_mutex);
+}
+
+static void
+eog_thumbnail_set_original_size (GdkPixbuf *thumbnail,
+				 const gchar *original_width,
+				 const gchar *original_height)
+{
+	gint width, height;
+
+	if (original_width && sscanf (original_width, "%i", &width) == 1) {
+		g_object_set_data (G_OBJECT (thumbnail),
+				   EOG_THUMBNAIL_ORIGINAL_WIDTH,
+				   GINT_TO_POINTER (width));
+	}
+
+	if (original_height && sscanf (original_height, "%i", &height) == 1) {
+		g_object_set_data (G_OBJECT (thumbnail),
+				   EOG_THUMBNAIL_ORIGINAL_HEIGHT,
+				   GINT_TO_POINTER (height));
+	}
+}
+
+/**
+ * eog_thumbnail_load_framed:
+ * @image: a #EogImage
+ * @allow_preview: whether a low quality preview embedded in the file
+ * may be returned when no thumbnail exists yet
+ * @error: location to store the error ocurring or %NULL to ignore
+ *
+ * Loads the thumbnail for @image like eog_thumbnail_load(), fitted
+ * to %EOG_LIST_STORE_THUMB_SIZE and framed, ready to be shown in the
+ * image gallery. Framed thumbnails are kept in an in-memory cache shared
+ * by the whole process, so loading the same unchanged file again only
+ * costs a stat.
+ *
+ * If a preview is returned, it has the %EOG_THUMBNAIL_IS_PREVIEW data
+ * set and the caller should request the real thumbnail afterwards.
+ *
+ * Returns: (transfer full): a #GdkPixbuf that must not be modified,
+ * or %NULL in case of error.
+ **/
+GdkPixbuf*
+eog_thumbnail_load_framed (EogImage *image,
+			   gboolean allow_preview,
+			   GError **error)
+{
+	GdkPixbuf *thumb, *framed;
+	GFileInfo *file_info;
+	GFile *file;
+	gchar *uri, *key = NULL;
+
+	g_return_val_if_fail (image != NULL, NULL);
+	g_return_val_if_fail (error != NULL && *error == NULL, NULL);
+
+	eog_thumbnail_init ();
+
+	file = eog_image_get_file (image);
+	file_info = g_file_query_info (file,
+				       G_FILE_ATTRIBUTE_TIME_MODIFIED,
+				       G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+	if (file_info != NULL) {
+		uri = g_file_get_uri (file);
+		key = eog_thumb_cache_key (uri,
+					   g_file_info_get_attribute_uint64 (file_info,
+									     G_FILE_ATTRIBUTE_TIME_MODIFIED));
+		g_free (uri);
+		g_object_unref (file_info);
+	}
+	g_object_unref (file);
+
+	if (key != NULL) {
+		framed = eog_thumb_cache_lookup (key);
+
+		if (framed != NULL) {
+			eog_debug_message (DEBUG_THUMBNAIL, "%s: loaded from memory", key);
+			g_free (key);
+			return framed;
+		}
+	}
+
+	thumb = eog_thumbnail_load_real (image, allow_preview, error);
+
+	if (thumb == NULL) {
+		g_free (key);
+		return NULL;
+	}
+
+	framed = eog_thumbnail_fit_and_frame (thumb, EOG_LIST_STORE_THUMB_SIZE);
+
+	if (g_object_get_data (G_OBJECT (thumb), EOG_THUMBNAIL_IS_PREVIEW)) {
+		/* Keep previews out of the cache */
+		g_object_set_data (G_OBJECT (framed), EOG_THUMBNAIL_IS_PREVIEW,
+				   GINT_TO_POINTER (TRUE));
+		g_object_set_data (G_OBJECT (framed), EOG_THUMBNAIL_ORIGINAL_WIDTH,
+				   g_object_get_data (G_OBJECT (thumb),
+						      EOG_THUMBNAIL_ORIGINAL_WIDTH));
+		g_object_set_data (G_OBJECT (framed), EOG_THUMBNAIL_ORIGINAL_HEIGHT,
+				   g_object_get_data (G_OBJECT (thumb),
+						      EOG_THUMBNAIL_ORIGINAL_HEIGHT));
+		g_object_unref (thumb);
+		g_free (key);
+		return framed;
+	}
+
+	eog_thumbnail_set_original_size (framed,
+					 gdk_pixbuf_get_option (thumb, "tEXt::Thumb::Image::Width"),
+					 gdk_pixbuf_get_option (thumb, "tEXt::Thumb::Image::Height"));
+	g_object_unref (thumb);
+
+	if (key != NULL) {
+		eog_thumb_cache_insert (key, framed);
+		g_free (key);
+	}
+
+	return framed;
+}
+
+/* The thumbnail factory and the frame are only needed once the
+ * gallery is filled, so this is not done during startup but on first
+ * use, which may happen in any thread. */
 void
 eog_thumbnail_init (void)
 {
-	if (factory == NULL) {
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		thumb_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
 		factory = gnome_desktop_thumbnail_factory_new (GNOME_DESKTOP_THUMBNAIL_SIZE_NORMAL);
-	}
 
-	if (frame == NULL) {
 		frame = gdk_pixbuf_new_from_resource (
 				"/org/gnome/eog/ui/pixmaps/thumbnail-frame.png",
 				NULL);
+
+		g_once_init_leave (&initialized, 1);
 	}
 }
@@ -36,10 +36,21 @@ GdkPixbuf*    eog_thumbnail_fit_to_size (GdkPixbuf *thumbnail,
 
 GdkPixbuf*    eog_thumbnail_add_frame   (GdkPixbuf *thumbnail);
 
+GdkPixbuf*    eog_thumbnail_remove_frame (GdkPixbuf    *thumbnail,
+					  EogTransform *transform);
+
+GdkPixbuf*    eog_thumbnail_fit_and_frame (GdkPixbuf *thumbnail,
+					   gint       dimension);
+
 GdkPixbuf*    eog_thumbnail_load        (EogImage *image,
 					 GError **error);
 
+GdkPixbuf*    eog_thumbnail_load_framed (EogImage *image,
+					 gboolean  allow_preview,
+					 GError **error);
+
 #define EOG_THUMBNAIL_ORIGINAL_WIDTH  "eog-thumbnail-orig-width"
 #define EOG_THUMBNAIL_ORIGINAL_HEIGHT "eog-thumbnail-orig-height"
+#define EOG_THUMBNAIL_IS_PREVIEW      "eog-thumbnail-is-preview"
 
 G_END_DECLS
@@ -3,11 +3,13 @@
 #endif
 
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 
 #include "eog-uri-converter.h"
+#include "eog-metadata-index.h"
 #include "eog-pixbuf-util.h"
 
 enum {
@@ -19,21 +21,27 @@ enum {
 	PROP_N_IMAGES
 };
 
+/* The format string is compiled into a flat array of these. The text of
+ * EOG_UC_STRING operations is kept in a single literal pool. */
 typedef struct {
 	EogUCType  type;
-	union {
-		char    *string;  /* if type == EOG_UC_STRING */
-		gulong  counter;  /* if type == EOG_UC_COUNTER */
-	} data;
-} EogUCToken;
+	guint      offset;  /* if type == EOG_UC_STRING */
+	guint      len;     /* if type == EOG_UC_STRING */
+} EogUCOp;
 
+/* maximum length of a converted file name in bytes, without suffix */
+#define EOG_UC_MAX_NAME_LEN 250
 
 struct _EogURIConverterPrivate {
 	GFile           *base_file;
-	GList           *token_list;
+	GArray          *program;
+	GString         *literals;
+	GString         *buffer;    /* reused by every conversion */
 	char            *suffix;
 	GdkPixbufFormat *img_format;
 	gboolean        requires_exif;
+	gboolean        has_counter;
+	gulong          counter;
 
 	/* options */
 	gboolean convert_spaces;
@@ -54,18 +62,6 @@ static void eog_uri_converter_get_property (GObject    *object,
 
 G_DEFINE_TYPE_WITH_PRIVATE (EogURIConverter, eog_uri_converter, G_TYPE_OBJECT)
 
-static void
-free_token (gpointer data)
-{
-	EogUCToken *token = (EogUCToken*) data;
-
-	if (token->type == EOG_UC_STRING) {
-		g_free (token->data.string);
-	}
-
-	g_slice_free (EogUCToken, token);
-}
-
 static void
 eog_uri_converter_dispose (GObject *object)
 {
@@ -79,10 +75,19 @@ eog_uri_converter_dispose (GObject *object)
 		priv->base_file = NULL;
 	}
 
-	if (priv->token_list) {
-		g_list_foreach (priv->token_list, (GFunc) free_token, NULL);
-		g_list_free (priv->token_list);
-		priv->token_list = NULL;
+	if (priv->program) {
+		g_array_free (priv->program, TRUE);
+		priv->program = NULL;
+	}
+
+	if (priv->literals) {
+		g_string_free (priv->literals, TRUE);
+		priv->literals = NULL;
+	}
+
+	if (priv->buffer) {
+		g_string_free (priv->buffer, TRUE);
+		priv->buffer = NULL;
 	}
 
 	if (priv->suffix) {
@@ -106,6 +111,12 @@ eog_uri_converter_init (EogURIConverter *conv)
 	priv->counter_start    = 0;
 	priv->counter_n_digits = 1;
 	priv->requires_exif     = FALSE;
+	priv->has_counter      = FALSE;
+	priv->counter          = 0;
+
+	priv->program  = g_array_new (FALSE, FALSE, sizeof (EogUCOp));
+	priv->literals = g_string_new (NULL);
+	priv->buffer   = g_string_sized_new (EOG_UC_MAX_NAME_LEN + 16);
 }
 
 static void
@@ -261,206 +272,119 @@ eog_uri_converter_get_property (GObject    *object,
 	}
 }
 
-/* parser states */
-enum {
-	PARSER_NONE,
-	PARSER_STRING,
-	PARSER_TOKEN
-};
-
-static EogUCToken*
-create_token_string (const char *string, int substr_start, int substr_len)
+static EogUCType
+get_token_type (gunichar c)
 {
-	char *start_byte;
-	char *end_byte;
-	int n_bytes;
-	EogUCToken *token;
-
-	if (string == NULL) return NULL;
-	if (substr_len <= 0) return NULL;
-
-	start_byte = g_utf8_offset_to_pointer (string, substr_start);
-	end_byte = g_utf8_offset_to_pointer (string, substr_start + substr_len);
-
-	/* FIXME: is this right? */
-	n_bytes = end_byte - start_byte;
-
-	token = g_slice_new0 (EogUCToken);
-	token->type = EOG_UC_STRING;
-	token->data.string = g_new0 (char, n_bytes);
-	token->data.string = g_utf8_strncpy (token->data.string, start_byte, substr_len);
-
-	return token;
-}
-
-static EogUCToken*
-create_token_counter (int start_counter)
-{
-	EogUCToken *token;
-
-	token = g_slice_new0 (EogUCToken);
-	token->type = EOG_UC_COUNTER;
-	token->data.counter = 0;
-
-	return token;
+	switch (c) {
+	case 'f': return EOG_UC_FILENAME;
+	case 'n': return EOG_UC_COUNTER;
+	case 'c': return EOG_UC_COMMENT;
+	case 'd': return EOG_UC_DATE;
+	case 't': return EOG_UC_TIME;
+	case 'a': return EOG_UC_DAY;
+	case 'm': return EOG_UC_MONTH;
+	case 'y': return EOG_UC_YEAR;
+	case 'h': return EOG_UC_HOUR;
+	case 'i': return EOG_UC_MINUTE;
+	case 's': return EOG_UC_SECOND;
+	default:  return EOG_UC_END;
+	}
 }
 
-static EogUCToken*
-create_token_other (EogUCType type)
+static void
+compile_literal (EogURIConverterPrivate *priv, const char *literal, gsize len)
 {
-	EogUCToken *token;
+	EogUCOp op;
 
-	token = g_slice_new0 (EogUCToken);
-	token->type = type;
+	op.type = EOG_UC_STRING;
+	op.offset = priv->literals->len;
+	op.len = len;
 
-	return token;
+	g_string_append_len (priv->literals, literal, len);
+	g_array_append_val (priv->program, op);
 }
 
-static GList*
-eog_uri_converter_parse_string (EogURIConverter *conv, const char *string)
+/* Compiles the format string once, so that converting an image only
+ * runs through a flat array of operations. Unknown tokens are dropped. */
+static void
+eog_uri_converter_compile (EogURIConverter *conv, const char *string)
 {
 	EogURIConverterPrivate *priv;
-	GList *list = NULL;
-	gulong len;
-	int i;
-	int state = PARSER_NONE;
-	int start = -1;
-	int substr_len = 0;
-	gunichar c;
 	const char *s;
-	EogUCToken *token;
+	const char *literal = NULL;
 
-	g_return_val_if_fail (EOG_IS_URI_CONVERTER (conv), NULL);
+	g_return_if_fail (EOG_IS_URI_CONVERTER (conv));
 
 	priv = conv->priv;
 
-	if (string == NULL) return NULL;
+	if (string == NULL) return;
 
 	if (!g_utf8_validate (string, -1, NULL))
-		return NULL;
+		return;
 
-	len = g_utf8_strlen (string, -1);
-	s = string;
+	for (s = string; *s != '\0'; s = g_utf8_next_char (s)) {
+		EogUCOp op = { EOG_UC_END, 0, 0 };
 
-	for (i = 0; i < len; i++) {
-		c = g_utf8_get_char (s);
-		token = NULL;
-
-		switch (state) {
-		case PARSER_NONE:
-			if (c == '%') {
-				start = -1;
-				state = PARSER_TOKEN;
-			} else {
-				start = i;
-				substr_len = 1;
-				state = PARSER_STRING;
-			}
-			break;
+		if (*s != '%') {
+			if (literal == NULL)
+				literal = s;
+			continue;
+		}
 
-		case PARSER_STRING:
-			if (c == '%') {
-				if (start != -1) {
-					token = create_token_string (string, start, substr_len);
-				}
+		if (literal != NULL) {
+			compile_literal (priv, literal, s - literal);
+			literal = NULL;
+		}
 
-				state = PARSER_TOKEN;
-				start = -1;
-			} else {
-				substr_len++;
-			}
+		/* a trailing '%' is ignored */
+		if (*(++s) == '\0')
 			break;
 
-		case PARSER_TOKEN: {
-			EogUCType type = EOG_UC_END;
-
-			if (c == 'f') {
-				type = EOG_UC_FILENAME;
-			}
-			else if (c == 'n') {
-				type = EOG_UC_COUNTER;
-				token = create_token_counter (priv->counter_start);
-			}
-			else if (c == 'c') {
-				type = EOG_UC_COMMENT;
-			}
-			else if (c == 'd') {
-				type = EOG_UC_DATE;
-			}
-			else if (c == 't') {
-				type = EOG_UC_TIME;
-			}
-			else if (c == 'a') {
-				type = EOG_UC_DAY;
-			}
-			else if (c == 'm') {
-				type = EOG_UC_MONTH;
-			}
-			else if (c == 'y') {
-				type = EOG_UC_YEAR;
-			}
-			else if (c == 'h') {
-				type = EOG_UC_HOUR;
-			}
-			else if (c == 'i') {
-				type = EOG_UC_MINUTE;
-			}
-			else if (c == 's') {
-				type = EOG_UC_SECOND;
-			}
-
-			if (type != EOG_UC_END && token == NULL) {
-				token = create_token_other (type);
-				priv->requires_exif = TRUE;
-			}
-			state = PARSER_NONE;
-			break;
-		}
-		default:
-			g_assert_not_reached ();
-		}
+		op.type = get_token_type (g_utf8_get_char (s));
 
+		if (op.type == EOG_UC_END)
+			continue;
 
-		if (token != NULL) {
-			list = g_list_append (list, token);
-		}
+		if (op.type == EOG_UC_COUNTER)
+			priv->has_counter = TRUE;
+		else if (op.type != EOG_UC_FILENAME)
+			priv->requires_exif = TRUE;
 
-		s = g_utf8_next_char (s);
+		g_array_append_val (priv->program, op);
 	}
 
-	if (state != PARSER_TOKEN && start >= 0) {
-		/* add remaining chars as string token */
-		list = g_list_append (list, create_token_string (string, start, substr_len));
+	if (literal != NULL) {
+		/* add remaining chars as string */
+		compile_literal (priv, literal, s - literal);
 	}
-
-	return list;
 }
 
 void
 eog_uri_converter_print_list (EogURIConverter *conv)
 {
 	EogURIConverterPrivate *priv;
-	GList *it;
+	guint i;
 
 	g_return_if_fail (EOG_URI_CONVERTER (conv));
 
 	priv = conv->priv;
 
-	for (it = priv->token_list; it != NULL; it = it->next) {
-		EogUCToken *token;
+	for (i = 0; i < priv->program->len; i++) {
+		EogUCOp *op;
 		char *str;
 
-		token = (EogUCToken*) it->data;
+		op = &g_array_index (priv->program, EogUCOp, i);
 
-		switch (token->type) {
+		switch (op->type) {
 		case EOG_UC_STRING:
-			str = g_strdup_printf ("string [%s]", token->data.string);
+			str = g_strdup_printf ("string [%.*s]", op->len,
+					       priv->literals->str + op->offset);
 			break;
 		case EOG_UC_FILENAME:
 			str = "filename";
 			break;
 		case EOG_UC_COUNTER:
-			str = g_strdup_printf ("counter [%lu]", token->data.counter);
+			str = g_strdup_printf ("counter [%lu]", priv->counter);
 			break;
 		case EOG_UC_COMMENT:
 			str = "comment";
@@ -496,7 +420,7 @@ eog_uri_converter_print_list (EogURIConverter *conv)
 
 		g_print ("- %s\n", str);
 
-		if (token->type == EOG_UC_STRING || token->type == EOG_UC_COUNTER) {
+		if (op->type == EOG_UC_STRING || op->type == EOG_UC_COUNTER) {
 			g_free (str);
 		}
 	}
@@ -519,39 +443,11 @@ eog_uri_converter_new (GFile *base_file, GdkPixbufFormat *img_format, const char
 		conv->priv->base_file = NULL;
 	}
 	conv->priv->img_format = img_format;
-	conv->priv->token_list = eog_uri_converter_parse_string (conv, format_str);
+	eog_uri_converter_compile (conv, format_str);
 
 	return conv;
 }
 
-static GFile*
-get_file_directory (EogURIConverter *conv, EogImage *image)
-{
-	GFile *file = NULL;
-	EogURIConverterPrivate *priv;
-
-	g_return_val_if_fail (EOG_IS_URI_CONVERTER (conv), NULL);
-	g_return_val_if_fail (EOG_IS_IMAGE (image), NULL);
-
-	priv = conv->priv;
-
-	if (priv->base_file != NULL) {
-		file = g_object_ref (priv->base_file);
-	}
-	else {
-		GFile *img_file;
-
-		img_file = eog_image_get_file (image);
-		g_assert (img_file != NULL);
-
-		file = g_file_get_parent (img_file);
-
-		g_object_unref (img_file);
-	}
-
-	return file;
-}
-
 static void
 split_filename (GFile *file, char **name, char **suffix)
 {
@@ -605,75 +501,6 @@ append_filename (GString *str, EogImage *img)
 	return result;
 }
 
-static GString*
-append_counter (GString *str, gulong counter,  EogURIConverter *conv)
-{
-	EogURIConverterPrivate *priv;
-
-	priv = conv->priv;
-
-	g_string_append_printf (str, "%.*lu", priv->counter_n_digits, counter);
-
-	return str;
-}
-
-
-static void
-build_absolute_file (EogURIConverter *conv, EogImage *image, GString *str,  /* input  */
-		     GFile **file, GdkPixbufFormat **format)                /* output */
-{
-	GFile *dir_file;
-	EogURIConverterPrivate *priv;
-
-	*file = NULL;
-	if (format != NULL)
-		*format = NULL;
-
-	g_return_if_fail (EOG_IS_URI_CONVERTER (conv));
-	g_return_if_fail (EOG_IS_IMAGE (image));
-	g_return_if_fail (file != NULL);
-	g_return_if_fail (str != NULL);
-
-	priv = conv->priv;
-
-	dir_file = get_file_directory (conv, image);
-	g_assert (dir_file != NULL);
-
-	if (priv->img_format == NULL) {
-		/* use same file type/suffix */
-		char *name;
-		char *old_suffix;
-		GFile *img_file;
-
-		img_file = eog_image_get_file (image);
-		split_filename (img_file, &name, &old_suffix);
-
-		g_assert (old_suffix != NULL);
-
-		g_string_append_unichar (str, '.');
-		g_string_append (str, old_suffix);
-
-		if (format != NULL)
-			*format = eog_pixbuf_get_format_by_suffix (old_suffix);
-
-		g_object_unref (img_file);
-	} else {
-		if (priv->suffix == NULL)
-			priv->suffix = eog_pixbuf_get_common_suffix (priv->img_format);
-
-		g_string_append_unichar (str, '.');
-		g_string_append (str, priv->suffix);
-
-		if (format != NULL)
-			*format = priv->img_format;
-	}
-
-	*file = g_file_get_child (dir_file, str->str);
-
-	g_object_unref (dir_file);
-}
-
-
 static GString*
 replace_remove_chars (GString *str, gboolean convert_spaces, gunichar space_char)
 {
@@ -714,21 +541,149 @@ replace_remove_chars (GString *str, gboolean convert_spaces, gunichar space_char
 	return result;
 }
 
+/* Removes slashes and converts white space in place, the result is never
+ * longer than the input as the space character is ASCII. */
+static gboolean
+sanitize_filename (GString *str, gboolean convert_spaces, gchar space_char)
+{
+	const char *s, *next;
+	char *d;
+
+	if (!g_utf8_validate (str->str, str->len, NULL))
+		return FALSE;
+
+	for (s = d = str->str; *s != '\0'; s = next) {
+		gunichar c = g_utf8_get_char (s);
+
+		next = g_utf8_next_char (s);
+
+		if (c == '/') {
+			continue;
+		}
+		else if (g_unichar_isspace (c) && convert_spaces) {
+			*d++ = space_char;
+		}
+		else {
+			memmove (d, s, next - s);
+			d += next - s;
+		}
+	}
+
+	g_string_truncate (str, d - str->str);
+
+	/* ensure maximum length, without splitting a character */
+	if (str->len > EOG_UC_MAX_NAME_LEN) {
+		const char *end;
+
+		end = g_utf8_find_prev_char (str->str,
+					     str->str + EOG_UC_MAX_NAME_LEN + 1);
+		g_string_truncate (str, end - str->str);
+	}
+
+	return TRUE;
+}
+
+/* Gets the capture date of @file from its EXIF data, falling back to the
+ * modification time. Only the file headers are read, and the result is
+ * kept in the metadata index for the next time. */
+static gboolean
+get_capture_date (GFile *file, gint date[6])
+{
+	EogMetadataRecord record;
+	guint64 mtime = 0;
+	gboolean found = FALSE;
+
+	if (eog_metadata_index_query (file, EOG_METADATA_RECORD_EXIF,
+				      &record, &mtime, NULL, NULL)) {
+		if (record.capture_date != NULL) {
+			found = (sscanf (record.capture_date, "%4d:%2d:%2d %2d:%2d:%2d",
+					 &date[0], &date[1], &date[2],
+					 &date[3], &date[4], &date[5]) == 6);
+		}
+
+		eog_metadata_record_clear (&record);
+	}
+
+	if (!found && mtime > 0) {
+		GDateTime *date_time;
+
+		date_time = g_date_time_new_from_unix_local (mtime);
+
+		if (date_time != NULL) {
+			g_date_time_get_ymd (date_time, &date[0], &date[1], &date[2]);
+			date[3] = g_date_time_get_hour (date_time);
+			date[4] = g_date_time_get_minute (date_time);
+			date[5] = g_date_time_get_second (date_time);
+
+			g_date_time_unref (date_time);
+			found = TRUE;
+		}
+	}
+
+	return found;
+}
+
+/* Appends what a date or time token stands for in @date */
+static void
+append_date (GString *str, EogUCType type, const gint date[6])
+{
+	switch (type) {
+	case EOG_UC_DATE:
+		g_string_append_printf (str, "%04d-%02d-%02d",
+					date[0], date[1], date[2]);
+		break;
+	case EOG_UC_TIME:
+		g_string_append_printf (str, "%02d.%02d.%02d",
+					date[3], date[4], date[5]);
+		break;
+	case EOG_UC_YEAR:
+		g_string_append_printf (str, "%04d", date[0]);
+		break;
+	case EOG_UC_MONTH:
+		g_string_append_printf (str, "%02d", date[1]);
+		break;
+	case EOG_UC_DAY:
+		g_string_append_printf (str, "%02d", date[2]);
+		break;
+	case EOG_UC_HOUR:
+		g_string_append_printf (str, "%02d", date[3]);
+		break;
+	case EOG_UC_MINUTE:
+		g_string_append_printf (str, "%02d", date[4]);
+		break;
+	case EOG_UC_SECOND:
+		g_string_append_printf (str, "%02d", date[5]);
+		break;
+	default:
+		break;
+	}
+}
+
 /*
  * This function converts the uri of the EogImage object, according to the
- * EogUCToken list. The absolute uri (converted filename appended to base uri)
- * is returned in uri and the image format will be in the format pointer.
+ * compiled format string. The absolute uri (converted filename appended to
+ * base uri) is returned in uri and the image format will be in the format
+ * pointer. Date and time tokens read the file headers, so this should be
+ * called from a worker thread when they are used. Conversions reuse an
+ * internal buffer and a converter must not be used from several threads.
  */
 gboolean
 eog_uri_converter_do (EogURIConverter *conv, EogImage *image,
 		      GFile **file, GdkPixbufFormat **format, GError **error)
 {
 	EogURIConverterPrivate *priv;
-	GList *it;
 	GString *str;
-	GString *repl_str;
+	GFile *img_file;
+	GFile *dir_file;
+	char *basename;
+	const char *suffix;
+	gsize name_len;
+	gint date[6] = { 0, };
+	gboolean have_date = FALSE;
+	guint i;
 
 	g_return_val_if_fail (EOG_IS_URI_CONVERTER (conv), FALSE);
+	g_return_val_if_fail (EOG_IS_IMAGE (image), FALSE);
 
 	priv = conv->priv;
 
@@ -736,43 +691,103 @@ eog_uri_converter_do (EogURIConverter *conv, EogImage *image,
 	if (format != NULL)
 		*format = NULL;
 
-	str = g_string_new ("");
+	img_file = eog_image_get_file (image);
+	g_assert (img_file != NULL);
+
+	/* split the file name in place, the suffix starts after the last dot */
+	basename = g_file_get_basename (img_file);
+	suffix = strrchr (basename, '.');
+	name_len = (suffix != NULL ? (gsize) (suffix - basename) : strlen (basename));
+	if (suffix != NULL)
+		suffix++;
+
+	if (priv->requires_exif)
+		have_date = get_capture_date (img_file, date);
+
+	if (priv->has_counter && priv->counter < priv->counter_start)
+		priv->counter = priv->counter_start;
 
-	for (it = priv->token_list; it != NULL; it = it->next) {
-		EogUCToken *token = (EogUCToken*) it->data;
+	str = priv->buffer;
+	g_string_truncate (str, 0);
 
-		switch (token->type) {
+	for (i = 0; i < priv->program->len; i++) {
+		const EogUCOp *op = &g_array_index (priv->program, EogUCOp, i);
+
+		switch (op->type) {
 		case EOG_UC_STRING:
-			str = g_string_append (str, token->data.string);
+			g_string_append_len (str, priv->literals->str + op->offset, op->len);
 			break;
 
 		case EOG_UC_FILENAME:
-			str = append_filename (str, image);
+			g_string_append_len (str, basename, name_len);
 			break;
 
-		case EOG_UC_COUNTER: {
-			if (token->data.counter < priv->counter_start)
-				token->data.counter = priv->counter_start;
+		case EOG_UC_COUNTER:
+			g_string_append_printf (str, "%.*lu", priv->counter_n_digits, priv->counter);
+			break;
 
-			str = append_counter (str, token->data.counter++, conv);
+		case EOG_UC_DATE:
+		case EOG_UC_TIME:
+		case EOG_UC_YEAR:
+		case EOG_UC_MONTH:
+		case EOG_UC_DAY:
+		case EOG_UC_HOUR:
+		case EOG_UC_MINUTE:
+		case EOG_UC_SECOND:
+			if (have_date)
+				append_date (str, op->type, date);
 			break;
-		}
-		default:
-		/* skip all others */
 
+		default:
+			/* the EXIF comment isn't part of the header metadata */
 			break;
 		}
 	}
 
-	repl_str = replace_remove_chars (str, priv->convert_spaces, priv->space_character);
+	if (priv->has_counter)
+		priv->counter++;
 
-	if (repl_str->len > 0) {
-		build_absolute_file (conv, image, repl_str, file, format);
-	}
+	if (!sanitize_filename (str, priv->convert_spaces, priv->space_character)) {
+		g_set_error (error, EOG_UC_ERROR,
+			     EOG_UC_ERROR_INVALID_UNICODE,
+			     _("The file name contains invalid characters."));
+	} else if (str->len > 0) {
+		if (priv->img_format == NULL) {
+			/* use same file type/suffix */
+			if (suffix != NULL) {
+				g_string_append_c (str, '.');
+				g_string_append (str, suffix);
 
-	g_string_free (repl_str, TRUE);
-	g_string_free (str, TRUE);
+				if (format != NULL)
+					*format = eog_pixbuf_get_format_by_suffix (suffix);
+			}
+		} else {
+			if (priv->suffix == NULL)
+				priv->suffix = eog_pixbuf_get_common_suffix (priv->img_format);
+
+			g_string_append_c (str, '.');
+			g_string_append (str, priv->suffix);
+
+			if (format != NULL)
+				*format = priv->img_format;
+		}
+
+		if (priv->base_file != NULL)
+			dir_file = g_object_ref (priv->base_file);
+		else
+			dir_file = g_file_get_parent (img_file);
+
+		*file = g_file_get_child (dir_file, str->str);
+
+		g_object_unref (dir_file);
+	} else {
+		g_set_error (error, EOG_UC_ERROR,
+			     EOG_UC_ERROR_UNKNOWN,
+			     _("The file name is empty."));
+	}
 
+	g_free (basename);
+	g_object_unref (img_file);
 
 	return (*file != NULL);
 }
@@ -792,6 +807,9 @@ eog_uri_converter_preview (const char *format_str, EogImage *img, GdkPixbufForma
 	gunichar c;
 	char *filename;
 	gboolean token_next;
+	gint date[6] = { 0, };
+	gboolean have_date = FALSE;
+	gboolean date_read = FALSE;
 
 	g_return_val_if_fail (format_str != NULL, NULL);
 	g_return_val_if_fail (EOG_IS_IMAGE (img), NULL);
@@ -815,14 +833,30 @@ eog_uri_converter_preview (const char *format_str, EogImage *img, GdkPixbufForma
 		c = g_utf8_get_char (s);
 
 		if (token_next) {
-			if (c == 'f') {
+			EogUCType type = get_token_type (c);
+
+			if (type == EOG_UC_FILENAME) {
 				str = append_filename (str, img);
 			}
-			else if (c == 'n') {
+			else if (type == EOG_UC_COUNTER) {
 				g_string_append_printf (str, "%.*lu",
 							n_digits ,counter);
 
 			}
+			else if (type != EOG_UC_END && type != EOG_UC_COMMENT) {
+				/* only read once the format asks for it */
+				if (!date_read) {
+					GFile *img_file;
+
+					img_file = eog_image_get_file (img);
+					have_date = get_capture_date (img_file, date);
+					g_object_unref (img_file);
+					date_read = TRUE;
+				}
+
+				if (have_date)
+					append_date (str, type, date);
+			}
 			token_next = FALSE;
 		}
 		else if (c == '%') {
@@ -837,6 +871,12 @@ eog_uri_converter_preview (const char *format_str, EogImage *img, GdkPixbufForma
 	filename = NULL;
 	repl_str = replace_remove_chars (str, convert_spaces, space_char);
 
+	/* the original file name isn't valid UTF-8 */
+	if (repl_str == NULL) {
+		g_string_free (str, TRUE);
+		return NULL;
+	}
+
 	if (repl_str->len > 0) {
 		if (format == NULL) {
 			/* use same file type/suffix */
@@ -910,6 +950,8 @@ eog_uri_converter_check (EogURIConverter *converter, GList *img_list, GError **e
 		if (result) {
 			file_list = g_list_prepend (file_list, file);
 		}
+
+		g_clear_error (&conv_error);
 	}
 
 	/* check for all different uris */
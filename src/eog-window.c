@@ -505,6 +505,18 @@ update_image_pos (EogWindow *window)
 					pos + 1,
 					n_images);
 
+	/* The sort-key action only changes the setting, the
+	 * store is reordered from its change notification */
+	action = g_settings_create_action (priv->ui_settings,
+					   EOG_CONF_UI_SORT_KEY);
+	g_action_map_add_action (G_ACTION_MAP (window), action);
+	g_object_unref (action);
+
+	g_signal_connect_object (priv->ui_settings, "changed::"EOG_CONF_UI_SORT_KEY,
+				 G_CALLBACK (eog_window_sort_key_changed_cb),
+				 window,
+				 G_CONNECT_DEFAULT);
+
 	action = g_action_map_lookup_action (G_ACTION_MAP (window),
 	                                     "current-image");
 
@@ -971,6 +983,23 @@ image_file_changed_cb (EogImage *img, EogWindow *window)
 			  G_CALLBACK (file_changed_info_bar_response), window);
 }
 
+/* The load job decoded the first part of the image. Show it already, the
+ * view keeps updating it from here on until the job has finished. */
+static void
+image_area_updated_cb (EogImage  *image,
+		       gint       x,
+		       gint       y,
+		       gint       width,
+		       gint       height,
+		       EogWindow *window)
+{
+	g_signal_handlers_disconnect_by_func (image,
+					      image_area_updated_cb,
+					      window);
+
+	eog_scroll_view_set_image (EOG_SCROLL_VIEW (window->priv->view), image);
+}
+
 static void
 eog_window_display_image (EogWindow *window, EogImage *image)
 {
@@ -1151,6 +1180,10 @@ eog_window_clear_load_job (EogWindow *window)
 						      eog_job_load_cb,
 						      window);
 
+		g_signal_handlers_disconnect_by_func (EOG_JOB_LOAD (priv->load_job)->image,
+						      image_area_updated_cb,
+						      window);
+
 		eog_image_cancel_load (EOG_JOB_LOAD (priv->load_job)->image);
 
 		g_object_unref (priv->load_job);
@@ -1181,6 +1214,8 @@ eog_job_save_progress_cb (EogJobSave *job, float progress, gpointer user_data)
 	EogWindow *window;
 
 	static EogImage *image = NULL;
+	EogImage *current;
+	guint position;
 
 	g_return_if_fail (EOG_IS_WINDOW (user_data));
 
@@ -1190,11 +1225,14 @@ eog_job_save_progress_cb (EogJobSave *job, float progress, gpointer user_data)
 	eog_statusbar_set_progress (EOG_STATUSBAR (priv->statusbar),
 				    progress);
 
-	if (image != job->current_image) {
+	/* The images are saved in worker threads */
+	current = eog_job_save_get_current_image (job, &position);
+
+	if (current != NULL && image != current) {
 		gchar *str_image, *status_message;
 		guint n_images;
 
-		image = job->current_image;
+		image = current;
 
 		n_images = g_list_length (job->images);
 
@@ -1207,7 +1245,7 @@ eog_job_save_progress_cb (EogJobSave *job, float progress, gpointer user_data)
 		 * - the total number of images queued for saving */
 		status_message = g_strdup_printf (_("Saving image “%s” (%u/%u)"),
 					          str_image,
-						  job->current_position + 1,
+						  position + 1,
 						  n_images);
 		g_free (str_image);
 
@@ -1221,6 +1259,8 @@ eog_job_save_progress_cb (EogJobSave *job, float progress, gpointer user_data)
 		g_free (status_message);
 	}
 
+	g_clear_object (&current);
+
 	if (progress == 1.0)
 		image = NULL;
 }
@@ -1605,7 +1645,10 @@ handle_image_selection_changed_cb (EogThumbView *thumbview, EogWindow *window)
 		return;
 	}
 
-	if (eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE)) {
+	/* A first image that was preloaded during startup still goes
+	 * through the load job, which sizes and sets up the window */
+	if (priv->status != EOG_WINDOW_STATUS_INIT &&
+	    eog_image_has_data (image, EOG_IMAGE_DATA_IMAGE)) {
 		if (priv->image != NULL)
 			g_object_unref (priv->image);
 		priv->image = image;
@@ -1618,6 +1661,23 @@ handle_image_selection_changed_cb (EogThumbView *thumbview, EogWindow *window)
 				  "size-prepared",
 				  G_CALLBACK (eog_window_obtain_desired_size),
 				  window);
+	} else {
+		GdkPixbuf *thumbnail;
+
+		/* With a thumbnail there's something to show right away,
+		 * otherwise wait until the loader decoded the first bit */
+		thumbnail = eog_image_get_thumbnail (image);
+
+		if (thumbnail != NULL) {
+			eog_scroll_view_set_image (EOG_SCROLL_VIEW (priv->view),
+						   image);
+			g_object_unref (thumbnail);
+		} else {
+			g_signal_connect (image,
+					  "area-updated",
+					  G_CALLBACK (image_area_updated_cb),
+					  window);
+		}
 	}
 
 	priv->load_job = eog_job_load_new (image, EOG_IMAGE_DATA_ALL);
@@ -4143,6 +4203,20 @@ eog_window_ui_settings_changed_cb (GSettings *settings,
 	g_variant_unref (new_state);
 }
 
+static void
+eog_window_sort_key_changed_cb (GSettings *settings,
+				gchar     *key,
+				gpointer   user_data)
+{
+	EogWindow *window = EOG_WINDOW (user_data);
+
+	if (window->priv->store == NULL)
+		return;
+
+	eog_list_store_set_sort_key (window->priv->store,
+				     g_settings_get_enum (settings, key));
+}
+
 static void
 eog_window_drag_data_received (GtkWidget *widget,
                                GdkDragContext *context,
@@ -4403,6 +4477,10 @@ eog_window_construct_ui (EogWindow *window)
 	priv->overlay = gtk_overlay_new();
 
  	priv->view = eog_scroll_view_new ();
+#ifdef HAVE_LCMS
+	eog_scroll_view_set_display_profile (EOG_SCROLL_VIEW (priv->view),
+					     priv->display_profile);
+#endif
 	g_signal_connect (priv->view,
 			  "rotation-changed",
 			  G_CALLBACK (eog_window_view_rotation_changed_cb),
@@ -4704,6 +4782,9 @@ eog_window_dispose (GObject *object)
 
 #ifdef HAVE_LCMS
 	if (priv->display_profile != NULL) {
+		if (priv->view != NULL)
+			eog_scroll_view_set_display_profile (EOG_SCROLL_VIEW (priv->view),
+							     NULL);
 		cmsCloseProfile (priv->display_profile);
 		priv->display_profile = NULL;
 	}
@@ -5010,6 +5091,9 @@ eog_window_constructor (GType type,
 	g_signal_connect (priv->extensions, "extension-removed",
 			  G_CALLBACK (on_extension_removed), object);
 
+	eog_plugin_engine_connect_triggers (EOG_APP->priv->plugin_engine,
+					    EOG_WINDOW (object));
+
 	return object;
 }
 
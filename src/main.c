@@ -32,6 +32,7 @@
 
 #include "eog-application.h"
 #include "eog-application-internal.h"
+#include "eog-batch.h"
 #include "eog-plugin-engine.h"
 #include "eog-util.h"
 
@@ -101,6 +102,7 @@ main (int argc, char **argv)
 	/* Option groups are free'd together with the context 
 	 * Using gtk_get_option_group here initializes gtk during parsing */
 	g_option_context_add_group (ctx, gtk_get_option_group (FALSE));
+	g_option_context_add_group (ctx, eog_batch_get_option_group ());
 #ifdef HAVE_INTROSPECTION
 	g_option_context_add_group (ctx, gi_repository_get_option_group ());
 #endif
@@ -121,6 +123,10 @@ main (int argc, char **argv)
         }
 	g_option_context_free (ctx);
 
+	/* Batch processing runs without a display or the application */
+	if (eog_batch_is_requested ())
+		return eog_batch_run (argv + 1);
+
 	set_startup_flags ();
 
 	EOG_APP->priv->flags = flags;
@@ -0,0 +1,13 @@
+Feature: Batch processing
+
+  @batch_rotate @batch_rotate_auto
+  Scenario: Automatic rotation resets the EXIF orientation
+    * Create "/tmp/eog-batch/photo.jpg" sized 64x32 with EXIF orientation 6
+    * Run eog in batch mode with "--rotate=auto --output-dir=/tmp/eog-batch/out" on "/tmp/eog-batch/photo.jpg"
+    Then "/tmp/eog-batch/out/photo.jpg" is sized 32x64 with EXIF orientation 1
+
+  @batch_rotate @batch_rotate_in_place
+  Scenario: Rotating in place resets the EXIF orientation
+    * Create "/tmp/eog-batch/photo.jpg" sized 64x32 with EXIF orientation 6
+    * Run eog in batch mode with "--rotate=90" on "/tmp/eog-batch/photo.jpg"
+    Then "/tmp/eog-batch/photo.jpg" is sized 32x64 with EXIF orientation 1
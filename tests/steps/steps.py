@@ -6,6 +6,10 @@ from time import sleep
 from dogtail.rawinput import keyCombo
 from subprocess import Popen, PIPE
 from dogtail import i18n
+from gi.repository import GdkPixbuf
+import os
+import shlex
+import struct
 
 
 @step(u'Open About dialog')
@@ -162,3 +166,74 @@ def select_hamburger_and_close_it(context):
 def select_name_window(context, name):
     context.app = context.app.child(roleName='frame', name=translate(name))
     context.app.grab_focus()
+
+
+def exif_orientation_segment(orientation):
+    """APP1 segment with a big endian TIFF holding only the Orientation tag"""
+    tiff = b'MM\x00\x2a' + struct.pack('>I', 8)
+    tiff += struct.pack('>H', 1)
+    tiff += struct.pack('>HHIHH', 0x0112, 3, 1, orientation, 0)
+    tiff += struct.pack('>I', 0)
+    payload = b'Exif\x00\x00' + tiff
+    return b'\xff\xe1' + struct.pack('>H', len(payload) + 2) + payload
+
+
+def read_exif_orientation(path):
+    """Orientation tag of the JPEG at path, None if there is none"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    pos = 2
+    while pos + 4 <= len(data) and data[pos] == 0xff:
+        marker = data[pos + 1]
+        length = struct.unpack('>H', data[pos + 2:pos + 4])[0]
+        if marker == 0xda:
+            break
+        if marker == 0xe1 and data[pos + 4:pos + 10] == b'Exif\x00\x00':
+            tiff = data[pos + 10:pos + 2 + length]
+            bo = '<' if tiff[:2] == b'II' else '>'
+            ifd = struct.unpack(bo + 'I', tiff[4:8])[0]
+            n_entries = struct.unpack(bo + 'H', tiff[ifd:ifd + 2])[0]
+            for i in range(n_entries):
+                entry = tiff[ifd + 2 + 12 * i:ifd + 14 + 12 * i]
+                tag = struct.unpack(bo + 'H', entry[:2])[0]
+                if tag == 0x0112:
+                    return struct.unpack(bo + 'H', entry[8:10])[0]
+            return None
+        pos += 2 + length
+    return None
+
+
+@step(u'Create "{filename}" sized {width:d}x{height:d} with EXIF orientation {orientation:d}')
+def create_oriented_jpeg(context, filename, width, height, orientation):
+    pixbuf = GdkPixbuf.Pixbuf.new(GdkPixbuf.Colorspace.RGB, False, 8, width, height)
+    pixbuf.fill(0x3465a4ff)
+    saved, data = pixbuf.save_to_bufferv('jpeg', [], [])
+    assert saved, "Could not encode the test image"
+
+    # Put the EXIF segment right after the JFIF one
+    data = bytes(data)
+    end = 4 + struct.unpack('>H', data[4:6])[0]
+    data = data[:end] + exif_orientation_segment(orientation) + data[end:]
+
+    if not os.path.isdir(os.path.dirname(filename)):
+        os.makedirs(os.path.dirname(filename))
+    with open(filename, 'wb') as f:
+        f.write(data)
+
+
+@step(u'Run eog in batch mode with "{options}" on "{filename}"')
+def run_batch(context, options, filename):
+    process = Popen(['eog', '--batch'] + shlex.split(options) + [filename],
+                    stdout=PIPE, stderr=PIPE)
+    out, err = process.communicate()
+    assert process.returncode == 0, "eog --batch failed: %s" % err
+
+
+@then(u'"{filename}" is sized {width:d}x{height:d} with EXIF orientation {orientation:d}')
+def image_has_orientation(context, filename, width, height, orientation):
+    pixbuf = GdkPixbuf.Pixbuf.new_from_file(filename)
+    actual = (pixbuf.get_width(), pixbuf.get_height())
+    assert actual == (width, height), "Expected %dx%d, but was %dx%d" % ((width, height) + actual)
+    actual_orientation = read_exif_orientation(filename)
+    assert actual_orientation == orientation, \
+        "Expected orientation %d, but was %s" % (orientation, actual_orientation)